@@ -0,0 +1,133 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockfilter.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <consensus/validation.h>
+#include <index/blockfilterindex.h>
+#include <interfaces/chain.h>
+#include <node/blockstorage.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <test/util/setup_common.h>
+#include <undo.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+/** Number of blocks in the chain whose filters are served. */
+static constexpr int NUM_BLOCKS{3000};
+/** Number of outputs, each with its own script, in every block. */
+static constexpr int OUTPUTS_PER_BLOCK{100};
+/** Number of filters a light client asks for at once, the maximum of a getcfilters message. */
+static constexpr int FILTERS_PER_REQUEST{1000};
+
+/** Extend the active chain with blocks and undo data on disk, without validating them. */
+static void BuildChain(ChainstateManager& chainman, CTxMemPool* mempool)
+{
+    LOCK(::cs_main);
+    const CChainParams& params{chainman.GetParams()};
+    Chainstate& chainstate{chainman.InitializeChainstate(mempool)};
+    node::BlockManager& blockman{chainman.m_blockman};
+
+    CBlockIndex* best_header{nullptr};
+    CBlock block{params.GenesisBlock()};
+    for (int height = 0; height <= NUM_BLOCKS; ++height) {
+        if (height > 0) {
+            CMutableTransaction coinbase;
+            coinbase.vin.resize(1);
+            coinbase.vin[0].scriptSig = CScript{} << height << OP_0;
+            for (int i = 0; i < OUTPUTS_PER_BLOCK; ++i) {
+                coinbase.vout.emplace_back(1, CScript{} << (int64_t{height} * OUTPUTS_PER_BLOCK + i) << OP_EQUAL);
+            }
+            block.hashPrevBlock = block.GetHash();
+            block.nTime += 1;
+            block.vtx.assign(1, MakeTransactionRef(std::move(coinbase)));
+            block.hashMerkleRoot = BlockMerkleRoot(block);
+            while (!CheckProofOfWork(block.GetHash(), block.nBits, params.GetConsensus())) {
+                ++block.nNonce;
+            }
+        }
+        CBlockIndex* pindex{blockman.AddToBlockIndex(block, best_header)};
+        const FlatFilePos pos{blockman.SaveBlockToDisk(block, height, chainstate.m_chain, params, nullptr)};
+        assert(!pos.IsNull());
+        pindex->nFile = pos.nFile;
+        pindex->nDataPos = pos.nPos;
+        pindex->nStatus |= BLOCK_HAVE_DATA;
+        if (height > 0) {
+            BlockValidationState state;
+            const bool ok{blockman.WriteUndoDataForBlock(CBlockUndo{}, state, pindex, params)};
+            assert(ok);
+        }
+        chainstate.m_chain.SetTip(*pindex);
+    }
+}
+
+/** Ask for all filters of the chain in batches, as a light client syncing from scratch does. */
+static void SyncFilters(const BlockFilterIndex& filter_index, const CChain& chain)
+{
+    std::vector<BlockFilter> filters;
+    for (int start_height = 0; start_height <= chain.Height(); start_height += FILTERS_PER_REQUEST) {
+        const CBlockIndex* stop_index{chain[std::min(start_height + FILTERS_PER_REQUEST - 1, chain.Height())]};
+        const bool ok{filter_index.LookupFilterRange(start_height, stop_index, filters)};
+        assert(ok && filters.size() == size_t(stop_index->nHeight - start_height + 1));
+    }
+}
+
+// Light clients syncing all filters of the chain, served from the filter files
+// by an index that has not served them before.
+static void BlockFilterIndexSyncFromDisk(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<ChainTestingSetup>()};
+    ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    BuildChain(chainman, testing_setup->m_node.mempool.get());
+    {
+        BlockFilterIndex filter_index{interfaces::MakeChain(testing_setup->m_node), BlockFilterType::BASIC, 1 << 20};
+        const bool ok{filter_index.Start()};
+        assert(ok);
+        while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+            UninterruptibleSleep(std::chrono::milliseconds{10});
+        }
+        filter_index.Stop();
+    }
+
+    const CChain& chain{*WITH_LOCK(::cs_main, return &chainman.ActiveChain())};
+    bench.batch(NUM_BLOCKS + 1).unit("filter").run([&] {
+        const BlockFilterIndex filter_index{interfaces::MakeChain(testing_setup->m_node), BlockFilterType::BASIC, 1 << 20};
+        SyncFilters(filter_index, chain);
+    });
+}
+
+// Light clients syncing all filters of the chain one after the other, served
+// from the cache of recently served filters.
+static void BlockFilterIndexSyncCached(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<ChainTestingSetup>()};
+    ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    BuildChain(chainman, testing_setup->m_node.mempool.get());
+    BlockFilterIndex filter_index{interfaces::MakeChain(testing_setup->m_node), BlockFilterType::BASIC, 1 << 20};
+    const bool ok{filter_index.Start()};
+    assert(ok);
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        UninterruptibleSleep(std::chrono::milliseconds{10});
+    }
+
+    const CChain& chain{*WITH_LOCK(::cs_main, return &chainman.ActiveChain())};
+    SyncFilters(filter_index, chain);
+    bench.batch(NUM_BLOCKS + 1).unit("filter").run([&] {
+        SyncFilters(filter_index, chain);
+    });
+    filter_index.Stop();
+}
+
+BENCHMARK(BlockFilterIndexSyncFromDisk, benchmark::PriorityLevel::HIGH);
+BENCHMARK(BlockFilterIndexSyncCached, benchmark::PriorityLevel::HIGH);
@@ -8,6 +8,7 @@
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
 
+#include <unordered_map>
 #include <vector>
 
 // Microbenchmark for simple accesses to a CCoinsViewCache database. Note from
@@ -50,4 +51,41 @@ static void CCoinsCaching(benchmark::Bench& bench)
     ECC_Stop();
 }
 
+/** Fill a coins map with num_coins fresh entries, then erase them all again. */
+template <typename Map>
+static void FillAndClearCoinsMap(Map& map, size_t num_coins)
+{
+    COutPoint outpoint{uint256::ONE, 0};
+    for (uint32_t i = 0; i < num_coins; ++i) {
+        outpoint.n = i;
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple());
+    }
+    for (auto it = map.begin(); it != map.end();) {
+        it = map.erase(it);
+    }
+}
+
+// Churn through the node-based coins map with the default allocator, every
+// node is a separate malloc/free. Compare with CCoinsMapPoolAllocator below.
+static void CCoinsMapStdAllocator(benchmark::Bench& bench)
+{
+    std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> map;
+    bench.batch(10000).unit("coin").run([&] {
+        FillAndClearCoinsMap(map, 10000);
+    });
+}
+
+// Same churn as CCoinsMapStdAllocator, but nodes are carved out of the
+// CCoinsMapMemoryResource chunks and recycled through its freelist.
+static void CCoinsMapPoolAllocator(benchmark::Bench& bench)
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+    bench.batch(10000).unit("coin").run([&] {
+        FillAndClearCoinsMap(map, 10000);
+    });
+}
+
 BENCHMARK(CCoinsCaching, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsMapStdAllocator, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsMapPoolAllocator, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,126 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat/compat.h>
+#include <httpserver.h>
+#include <rpc/protocol.h>
+#include <test/util/setup_common.h>
+#include <util/string.h>
+#include <util/system.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+
+/** Port the benchmark server listens on, on the loopback interface. */
+static constexpr uint16_t BENCH_HTTP_PORT{29470};
+/** Number of keep-alive client connections sending requests at the same time. */
+static constexpr int NUM_CLIENTS{16};
+/** Number of requests each client sends per benchmark iteration. */
+static constexpr int REQUESTS_PER_CLIENT{50};
+
+/** A keep-alive client connection that sends one request at a time. */
+class BenchHTTPClient
+{
+public:
+    BenchHTTPClient()
+    {
+        m_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        assert(m_socket >= 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(BENCH_HTTP_PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const int ret{connect(m_socket, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))};
+        assert(ret == 0);
+    }
+    ~BenchHTTPClient() { close(m_socket); }
+
+    BenchHTTPClient(const BenchHTTPClient&) = delete;
+    BenchHTTPClient& operator=(const BenchHTTPClient&) = delete;
+
+    /** Send a request and wait for the whole reply. */
+    void Request()
+    {
+        static const std::string request{"GET /bench HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n"};
+        const ssize_t sent{send(m_socket, request.data(), request.size(), MSG_NOSIGNAL)};
+        assert(sent == ssize_t(request.size()));
+
+        std::string reply;
+        size_t body_start{std::string::npos};
+        size_t content_length{0};
+        while (body_start == std::string::npos || reply.size() < body_start + content_length) {
+            char buf[4096];
+            const ssize_t received{recv(m_socket, buf, sizeof(buf), 0)};
+            assert(received > 0);
+            reply.append(buf, received);
+            if (body_start == std::string::npos) {
+                const size_t headers_end{reply.find("\r\n\r\n")};
+                if (headers_end == std::string::npos) continue;
+                body_start = headers_end + 4;
+                const size_t length_pos{reply.find("Content-Length: ")};
+                assert(length_pos < headers_end);
+                content_length = std::strtoul(reply.c_str() + length_pos + 16, nullptr, 10);
+            }
+        }
+        assert(reply.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    }
+
+private:
+    int m_socket;
+};
+
+// Many local clients sending small requests over keep-alive connections, as
+// indexers do, served by the given number of HTTP event threads.
+static void HTTPServerLoad(benchmark::Bench& bench, int event_threads)
+{
+    const auto testing_setup{MakeNoLogFileContext<const BasicTestingSetup>()};
+    gArgs.ForceSetArg("-rpcport", ToString(BENCH_HTTP_PORT));
+    gArgs.ForceSetArg("-rpceventthreads", ToString(event_threads));
+    gArgs.ForceSetArg("-rpcthreads", ToString(DEFAULT_HTTP_THREADS));
+    gArgs.ForceSetArg("-rpcworkqueue", ToString(NUM_CLIENTS));
+    const bool ok{InitHTTPServer()};
+    assert(ok);
+    RegisterHTTPHandler("/bench", /*exactMatch=*/true, [](HTTPRequest* req, const std::string&) {
+        req->WriteReply(HTTP_OK, "ok");
+        return true;
+    });
+    StartHTTPServer();
+
+    {
+        std::vector<BenchHTTPClient> clients(NUM_CLIENTS);
+        bench.batch(NUM_CLIENTS * REQUESTS_PER_CLIENT).unit("request").run([&] {
+            std::vector<std::thread> threads;
+            for (auto& client : clients) {
+                threads.emplace_back([&client] {
+                    for (int i = 0; i < REQUESTS_PER_CLIENT; ++i) {
+                        client.Request();
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+    }
+
+    InterruptHTTPServer();
+    StopHTTPServer();
+    UnregisterHTTPHandler("/bench", /*exactMatch=*/true);
+}
+
+static void HTTPServerLoad1EventThread(benchmark::Bench& bench) { HTTPServerLoad(bench, 1); }
+static void HTTPServerLoad2EventThreads(benchmark::Bench& bench) { HTTPServerLoad(bench, 2); }
+static void HTTPServerLoad4EventThreads(benchmark::Bench& bench) { HTTPServerLoad(bench, 4); }
+
+BENCHMARK(HTTPServerLoad1EventThread, benchmark::PriorityLevel::HIGH);
+BENCHMARK(HTTPServerLoad2EventThreads, benchmark::PriorityLevel::HIGH);
+BENCHMARK(HTTPServerLoad4EventThreads, benchmark::PriorityLevel::HIGH);
+
+#endif // WIN32
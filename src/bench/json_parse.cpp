@@ -0,0 +1,45 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <util/strencodings.h>
+#include <util/string.h>
+
+#include <univalue.h>
+
+#include <cassert>
+#include <string>
+
+// Parse a submitblock request, where almost all of the JSON is one hex string.
+static void JsonParseSubmitBlock(benchmark::Bench& bench)
+{
+    const std::string request{"{\"method\":\"submitblock\",\"params\":[\"" + HexStr(benchmark::data::block413567) + "\"],\"id\":1}"};
+    bench.batch(request.size()).unit("byte").run([&] {
+        UniValue value;
+        const bool ok{value.read(request)};
+        assert(ok && value["params"][0].get_str().size() == 2 * benchmark::data::block413567.size());
+    });
+}
+
+// Parse a batch of many small requests, with short keys, strings and numbers.
+static void JsonParseBatchRequests(benchmark::Bench& bench)
+{
+    constexpr int NUM_REQUESTS{1000};
+    std::string request{"["};
+    for (int i = 0; i < NUM_REQUESTS; ++i) {
+        if (i > 0) request += ",";
+        request += "{\"jsonrpc\":\"2.0\",\"method\":\"getblockheader\",\"params\":[\"" +
+                   std::string(64, "0123456789abcdef"[i % 16]) + "\",true],\"id\":" + ToString(i) + "}";
+    }
+    request += "]";
+    bench.batch(request.size()).unit("byte").run([&] {
+        UniValue value;
+        const bool ok{value.read(request)};
+        assert(ok && value.size() == NUM_REQUESTS);
+    });
+}
+
+BENCHMARK(JsonParseSubmitBlock, benchmark::PriorityLevel::HIGH);
+BENCHMARK(JsonParseBatchRequests, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,67 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <dbwrapper.h>
+#include <kernel/cs_main.h>
+#include <node/blockstorage.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <txdb.h>
+#include <util/system.h>
+
+#include <cassert>
+#include <memory>
+#include <utility>
+
+using node::BlockManager;
+
+/** Number of headers in the block index that is loaded. */
+static constexpr int NUM_HEADERS{20000};
+
+// Startup cost of the block index: read, deserialize and check every entry of
+// the block tree database, link the entries and compute their chain work.
+static void LoadBlockIndex(benchmark::Bench& bench)
+{
+    ArgsManager bench_args;
+    const auto chain_params{CreateChainParams(bench_args, CBaseChainParams::REGTEST)};
+    const Consensus::Params& consensus{chain_params->GetConsensus()};
+
+    auto block_tree_db{std::make_unique<CBlockTreeDB>(DBParams{
+        .path = "",
+        .cache_bytes = 1 << 20,
+        .memory_only = true})};
+    {
+        LOCK(::cs_main);
+        BlockManager blockman{BlockManager::Options{}};
+        blockman.m_block_tree_db = std::move(block_tree_db);
+        CBlockIndex* best_header{nullptr};
+        CBlockHeader header{chain_params->GenesisBlock()};
+        for (int i = 0; i < NUM_HEADERS; ++i) {
+            blockman.AddToBlockIndex(header, best_header);
+            header.hashPrevBlock = header.GetHash();
+            header.nTime += 1;
+            while (!CheckProofOfWork(header.GetHash(), header.nBits, consensus)) {
+                ++header.nNonce;
+            }
+        }
+        const bool ok{blockman.WriteBlockIndexDB()};
+        assert(ok);
+        block_tree_db = std::move(blockman.m_block_tree_db);
+    }
+
+    bench.batch(NUM_HEADERS).unit("header").run([&] {
+        LOCK(::cs_main);
+        BlockManager blockman{BlockManager::Options{}};
+        blockman.m_block_tree_db = std::move(block_tree_db);
+        const bool ok{blockman.LoadBlockIndexDB(consensus)};
+        assert(ok && blockman.m_block_index.size() == size_t{NUM_HEADERS});
+        block_tree_db = std::move(blockman.m_block_tree_db);
+    });
+}
+
+BENCHMARK(LoadBlockIndex, benchmark::PriorityLevel::HIGH);
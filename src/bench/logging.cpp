@@ -6,6 +6,14 @@
 #include <logging.h>
 #include <test/util/setup_common.h>
 
+#include <thread>
+#include <vector>
+
+/** Number of threads logging at the same time in the contended benchmarks. */
+static constexpr int NUM_LOGGING_THREADS{8};
+/** Number of messages each thread logs per benchmark iteration. */
+static constexpr int MESSAGES_PER_THREAD{1000};
+
 // All but 2 of the benchmarks should have roughly similar performance:
 //
 // LogPrintWithoutCategory should be ~3 orders of magnitude faster, as nothing is logged.
@@ -17,7 +25,7 @@ static void Logging(benchmark::Bench& bench, const std::vector<const char*>& ext
     // Reset any enabled logging categories from a previous benchmark run.
     LogInstance().DisableCategory(BCLog::LogFlags::ALL);
 
-    TestingSetup test_setup{
+    BasicTestingSetup test_setup{
         CBaseChainParams::REGTEST,
         extra_args,
     };
@@ -25,6 +33,32 @@ static void Logging(benchmark::Bench& bench, const std::vector<const char*>& ext
     bench.run([&] { log(); });
 }
 
+// Several threads logging at the same time, as the message handler, validation
+// and scheduler threads do on a node running with -debug=net,mempool,validation.
+static void LoggingContended(benchmark::Bench& bench, const std::vector<const char*>& extra_args, const std::function<void(int)>& log)
+{
+    LogInstance().DisableCategory(BCLog::LogFlags::ALL);
+
+    BasicTestingSetup test_setup{
+        CBaseChainParams::REGTEST,
+        extra_args,
+    };
+
+    bench.batch(NUM_LOGGING_THREADS * MESSAGES_PER_THREAD).unit("message").run([&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_LOGGING_THREADS; ++t) {
+            threads.emplace_back([&log] {
+                for (int i = 0; i < MESSAGES_PER_THREAD; ++i) {
+                    log(i);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    });
+}
+
 static void LogPrintLevelWithThreadNames(benchmark::Bench& bench)
 {
     Logging(bench, {"-logthreadnames=1", "-debug=net"}, [] {
@@ -80,6 +114,30 @@ static void LogWithoutWriteToFile(benchmark::Bench& bench)
     });
 }
 
+static void LogPrintContendedAsync(benchmark::Bench& bench)
+{
+    LoggingContended(bench, {"-logasync=1", "-debug=net"}, [](int i) { LogPrint(BCLog::NET, "%s %d\n", "test", i); });
+}
+
+static void LogPrintContendedSync(benchmark::Bench& bench)
+{
+    LoggingContended(bench, {"-logasync=0", "-debug=net"}, [](int i) { LogPrint(BCLog::NET, "%s %d\n", "test", i); });
+}
+
+static void LogPrintfContendedAsync(benchmark::Bench& bench)
+{
+    LoggingContended(bench, {"-logasync=1"}, [](int i) { LogPrintf("%s %d\n", "test", i); });
+}
+
+static void LogPrintfContendedSync(benchmark::Bench& bench)
+{
+    LoggingContended(bench, {"-logasync=0"}, [](int i) { LogPrintf("%s %d\n", "test", i); });
+}
+
+BENCHMARK(LogPrintContendedAsync, benchmark::PriorityLevel::HIGH);
+BENCHMARK(LogPrintContendedSync, benchmark::PriorityLevel::HIGH);
+BENCHMARK(LogPrintfContendedAsync, benchmark::PriorityLevel::HIGH);
+BENCHMARK(LogPrintfContendedSync, benchmark::PriorityLevel::HIGH);
 BENCHMARK(LogPrintLevelWithThreadNames, benchmark::PriorityLevel::HIGH);
 BENCHMARK(LogPrintLevelWithoutThreadNames, benchmark::PriorityLevel::HIGH);
 BENCHMARK(LogPrintWithCategory, benchmark::PriorityLevel::HIGH);
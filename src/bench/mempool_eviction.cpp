@@ -8,6 +8,7 @@
 #include <test/util/setup_common.h>
 #include <txmempool.h>
 
+#include <vector>
 
 static void AddTx(const CTransactionRef& tx, const CAmount& nFee, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
@@ -133,4 +134,40 @@ static void MempoolEviction(benchmark::Bench& bench)
     });
 }
 
+// Eviction from a mempool of long chains, where every evicted package walks
+// the descendants and, for each of them, the ancestors of the transaction.
+static void MempoolEvictionChains(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>();
+    FastRandomContext det_rand{true};
+
+    std::vector<CTransactionRef> txs;
+    std::vector<CAmount> fees;
+    for (int chain = 0; chain < 40; ++chain) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(det_rand.rand256(), 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 10 * COIN;
+        for (int depth = 0; depth < 25; ++depth) {
+            txs.push_back(MakeTransactionRef(tx));
+            fees.push_back(1000 + det_rand.randrange(10000));
+            tx.vin[0].prevout = COutPoint(txs.back()->GetHash(), 0);
+        }
+    }
+
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    LOCK2(cs_main, pool.cs);
+    bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (size_t i = 0; i < txs.size(); ++i) {
+            AddTx(txs[i], fees[i], pool);
+        }
+        pool.TrimToSize(pool.DynamicMemoryUsage() / 2);
+        pool.TrimToSize(0);
+    });
+}
+
 BENCHMARK(MempoolEviction, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolEvictionChains, benchmark::PriorityLevel::HIGH);
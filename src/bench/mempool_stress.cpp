@@ -9,6 +9,7 @@
 #include <txmempool.h>
 #include <validation.h>
 
+#include <cassert>
 #include <vector>
 
 static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
@@ -115,5 +116,97 @@ static void MempoolCheck(benchmark::Bench& bench)
     });
 }
 
+// Ancestor walks of the kind every transaction entering the mempool takes.
+static void MempoolAncestors(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    const std::vector<CTransactionRef> ordered_coins{CreateOrderedCoins(det_rand, /*childTxs=*/800, /*min_ancestors=*/1)};
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *testing_setup.get()->m_node.mempool;
+    LOCK2(cs_main, pool.cs);
+    std::vector<CTxMemPool::txiter> entries;
+    for (const auto& tx : ordered_coins) {
+        AddTx(tx, pool);
+        entries.push_back(*pool.GetIter(tx->GetHash()));
+    }
+    bench.batch(entries.size()).unit("tx").run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (const auto& entry : entries) {
+            const auto ancestors{pool.CalculateMemPoolAncestors(*entry, CTxMemPool::Limits::NoLimits(), /*fSearchForParents=*/false)};
+            assert(ancestors);
+        }
+    });
+}
+
+// What a reorg does to the mempool: the transactions of the disconnected
+// block are added back while their descendants are still in the mempool, and
+// UpdateTransactionsFromBlock links them up.
+static void MempoolReorgUpdate(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    const std::vector<CTransactionRef> ordered_coins{CreateOrderedCoins(det_rand, /*childTxs=*/800, /*min_ancestors=*/1)};
+    // The first 100 transactions have no parents, they play the disconnected block.
+    const std::vector<CTransactionRef> block_txs(ordered_coins.begin(), ordered_coins.begin() + 100);
+    std::vector<uint256> block_hashes;
+    for (const auto& tx : block_txs) {
+        block_hashes.push_back(tx->GetHash());
+    }
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *testing_setup.get()->m_node.mempool;
+    LOCK2(cs_main, pool.cs);
+    bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (auto it = ordered_coins.begin() + block_txs.size(); it != ordered_coins.end(); ++it) {
+            AddTx(*it, pool);
+        }
+        for (const auto& tx : block_txs) {
+            AddTx(tx, pool);
+        }
+        pool.UpdateTransactionsFromBlock(block_hashes);
+        pool.removeForBlock(ordered_coins, /*nBlockHeight=*/1);
+    });
+}
+
+// Accepting a transaction into a cluster of more than 10k transactions, and
+// removing it again.
+static void MempoolLargeCluster(benchmark::Bench& bench)
+{
+    constexpr uint32_t n_children{10000};
+    CMutableTransaction root;
+    root.vin.resize(1);
+    root.vout.resize(n_children);
+    for (auto& out : root.vout) {
+        out.scriptPubKey = CScript() << OP_TRUE;
+        out.nValue = COIN;
+    }
+    const CTransactionRef root_ref{MakeTransactionRef(root)};
+    std::vector<CTransactionRef> children;
+    std::vector<CTransactionRef> grandchildren;
+    for (uint32_t i = 0; i < n_children; ++i) {
+        CMutableTransaction child;
+        child.vin.emplace_back(COutPoint(root_ref->GetHash(), i));
+        child.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        children.push_back(MakeTransactionRef(child));
+        CMutableTransaction grandchild;
+        grandchild.vin.emplace_back(COutPoint(children.back()->GetHash(), 0));
+        grandchild.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        grandchildren.push_back(MakeTransactionRef(grandchild));
+    }
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *testing_setup.get()->m_node.mempool;
+    LOCK2(cs_main, pool.cs);
+    AddTx(root_ref, pool);
+    for (const auto& child : children) {
+        AddTx(child, pool);
+    }
+    size_t next{0};
+    bench.unit("tx").run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        const CTransactionRef& tx{grandchildren[next++ % grandchildren.size()]};
+        AddTx(tx, pool);
+        pool.removeRecursive(*tx, MemPoolRemovalReason::REPLACED);
+    });
+}
+
 BENCHMARK(ComplexMemPool, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolAncestors, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MempoolCheck, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolLargeCluster, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolReorgUpdate, benchmark::PriorityLevel::HIGH);
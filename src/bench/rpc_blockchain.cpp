@@ -12,10 +12,12 @@
 
 #include <univalue.h>
 
+#include <cassert>
+
 namespace {
 
 struct TestBlockAndIndex {
-    const std::unique_ptr<const TestingSetup> testing_setup{MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN)};
+    const std::unique_ptr<const ChainTestingSetup> testing_setup{MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN)};
     CBlock block{};
     uint256 blockHash{};
     CBlockIndex blockindex{};
@@ -58,3 +60,17 @@ static void BlockToJsonVerboseWrite(benchmark::Bench& bench)
 }
 
 BENCHMARK(BlockToJsonVerboseWrite, benchmark::PriorityLevel::HIGH);
+
+// What verbose getblock does now: write the JSON text directly, without the UniValue tree.
+static void BlockToJsonVerboseStream(benchmark::Bench& bench)
+{
+    TestBlockAndIndex data;
+    const size_t expected_size{blockToJSON(data.testing_setup->m_node.chainman->m_blockman, data.block, &data.blockindex, &data.blockindex, TxVerbosity::SHOW_DETAILS_AND_PREVOUT).write().size()};
+    bench.run([&] {
+        JSONWriter out;
+        blockToJSON(data.testing_setup->m_node.chainman->m_blockman, data.block, &data.blockindex, &data.blockindex, TxVerbosity::SHOW_DETAILS_AND_PREVOUT, out);
+        assert(out.Text().size() == expected_size);
+    });
+}
+
+BENCHMARK(BlockToJsonVerboseStream, benchmark::PriorityLevel::HIGH);
@@ -12,6 +12,8 @@
 
 #include <univalue.h>
 
+#include <cassert>
+#include <string>
 
 static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
@@ -19,12 +21,8 @@ static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& poo
     pool.addUnchecked(CTxMemPoolEntry(tx, fee, /*time=*/0, /*entry_height=*/1, /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
 }
 
-static void RpcMempool(benchmark::Bench& bench)
+static void FillMempool(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
-    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
-    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
-    LOCK2(cs_main, pool.cs);
-
     for (int i = 0; i < 1000; ++i) {
         CMutableTransaction tx = CMutableTransaction();
         tx.vin.resize(1);
@@ -36,10 +34,38 @@ static void RpcMempool(benchmark::Bench& bench)
         const CTransactionRef tx_r{MakeTransactionRef(tx)};
         AddTx(tx_r, /*fee=*/i, pool);
     }
+}
+
+static void RpcMempool(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
 
     bench.run([&] {
         (void)MempoolToJSON(pool, /*verbose=*/true);
     });
 }
 
+// Same as RpcMempool including the serialization, but written in chunks like
+// verbose getrawmempool does for HTTP clients.
+static void RpcMempoolStream(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    {
+        LOCK2(cs_main, pool.cs);
+        FillMempool(pool);
+    }
+    const size_t expected_size{MempoolToJSON(pool, /*verbose=*/true).write().size()};
+
+    bench.run([&] {
+        size_t size{0};
+        MempoolToJSONStream(pool, [&](const std::string& chunk) { size += chunk.size(); });
+        assert(size == expected_size);
+    });
+}
+
 BENCHMARK(RpcMempool, benchmark::PriorityLevel::HIGH);
+BENCHMARK(RpcMempoolStream, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,67 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <pubkey.h>
+#include <random.h>
+#include <span.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <vector>
+
+static std::vector<SchnorrSignatureCheck> CreateSchnorrChecks(size_t num_sigs)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<SchnorrSignatureCheck> checks;
+    checks.reserve(num_sigs);
+    for (size_t i = 0; i < num_sigs; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        SchnorrSignatureCheck check{XOnlyPubKey{key.GetPubKey()}, rng.rand256(), {}};
+        const bool ok{key.SignSchnorr(check.msg, check.sig, nullptr, rng.rand256())};
+        assert(ok);
+        checks.push_back(check);
+    }
+    return checks;
+}
+
+// Verify num_sigs BIP340 signatures one by one, for comparison with the batch.
+static void SchnorrVerifyIndividual(benchmark::Bench& bench, size_t num_sigs)
+{
+    ECC_Start();
+    const auto checks{CreateSchnorrChecks(num_sigs)};
+    bench.batch(num_sigs).unit("sig").run([&] {
+        for (const auto& check : checks) {
+            const bool ok{check.pubkey.VerifySchnorr(check.msg, check.sig)};
+            assert(ok);
+        }
+    });
+    ECC_Stop();
+}
+
+// Verify num_sigs BIP340 signatures as a single batch.
+static void SchnorrVerifyBatch(benchmark::Bench& bench, size_t num_sigs)
+{
+    ECC_Start();
+    const auto checks{CreateSchnorrChecks(num_sigs)};
+    bench.batch(num_sigs).unit("sig").run([&] {
+        const bool ok{VerifySchnorrBatch(checks)};
+        assert(ok);
+    });
+    ECC_Stop();
+}
+
+static void SchnorrVerifyIndividual1000(benchmark::Bench& bench) { SchnorrVerifyIndividual(bench, 1000); }
+static void SchnorrVerifyBatch1(benchmark::Bench& bench) { SchnorrVerifyBatch(bench, 1); }
+static void SchnorrVerifyBatch10(benchmark::Bench& bench) { SchnorrVerifyBatch(bench, 10); }
+static void SchnorrVerifyBatch100(benchmark::Bench& bench) { SchnorrVerifyBatch(bench, 100); }
+static void SchnorrVerifyBatch1000(benchmark::Bench& bench) { SchnorrVerifyBatch(bench, 1000); }
+
+BENCHMARK(SchnorrVerifyIndividual1000, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SchnorrVerifyBatch1, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SchnorrVerifyBatch10, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SchnorrVerifyBatch100, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SchnorrVerifyBatch1000, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,76 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat/compat.h>
+#include <util/fs_helpers.h>
+#include <util/sock.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#ifndef WIN32 // Windows does not have socketpair(2).
+
+/** Number of connections the net thread waits on in the benchmarks, one of which is active. */
+static constexpr int NUM_CONNECTIONS{1000};
+
+/** Create up to NUM_CONNECTIONS connected socket pairs, as many as the file descriptor limit allows. */
+static std::vector<std::shared_ptr<const Sock>> CreateConnections(std::vector<std::unique_ptr<Sock>>& peers)
+{
+    const int num_connections{std::min(NUM_CONNECTIONS, (RaiseFileDescriptorLimit(2 * NUM_CONNECTIONS + 100) - 100) / 2)};
+    std::vector<std::shared_ptr<const Sock>> socks;
+    for (int i = 0; i < num_connections; ++i) {
+        int s[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, s) != 0) break;
+        socks.push_back(std::make_shared<const Sock>(s[0]));
+        peers.push_back(std::make_unique<Sock>(s[1]));
+    }
+    assert(!peers.empty());
+    // Make a single connection readable, all others stay idle.
+    const char byte{0};
+    const auto sent{peers.front()->Send(&byte, 1, 0)};
+    assert(sent == 1);
+    return socks;
+}
+
+// What the net thread does with poll(2): hand all connections to the kernel on every iteration.
+static void SockWaitManyIdle(benchmark::Bench& bench)
+{
+    std::vector<std::unique_ptr<Sock>> peers;
+    const auto socks{CreateConnections(peers)};
+    bench.run([&] {
+        Sock::EventsPerSock events_per_sock;
+        for (const auto& sock : socks) {
+            events_per_sock.emplace(sock, Sock::Events{Sock::RECV});
+        }
+        const bool ok{socks.front()->WaitMany(std::chrono::milliseconds{0}, events_per_sock)};
+        assert(ok);
+    });
+}
+
+// What the net thread does with epoll(7): check the requested events, then wait for the ready sockets only.
+static void SockWaitSetIdle(benchmark::Bench& bench)
+{
+    const auto wait_set{SockWaitSet::Create()};
+    if (!wait_set) return;
+    std::vector<std::unique_ptr<Sock>> peers;
+    const auto socks{CreateConnections(peers)};
+    bench.run([&] {
+        for (const auto& sock : socks) {
+            const bool ok{wait_set->Set(sock, Sock::RECV)};
+            assert(ok);
+        }
+        Sock::EventsPerSock events_per_sock;
+        const bool ok{wait_set->Wait(std::chrono::milliseconds{0}, events_per_sock)};
+        assert(ok && events_per_sock.size() == 1);
+    });
+}
+
+BENCHMARK(SockWaitManyIdle, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SockWaitSetIdle, benchmark::PriorityLevel::HIGH);
+
+#endif // WIN32
@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include <iterator>
+#include <string>
+#include <utility>
 #include <vector>
 
 template <typename T>
@@ -63,6 +65,10 @@ private:
     //! The maximum number of elements to be processed in one batch
     const unsigned int nBatchSize;
 
+    //! Name prefix and syscall sandbox policy of the worker threads
+    const std::string m_thread_name;
+    const SyscallSandboxPolicy m_sandbox_policy;
+
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
@@ -131,8 +137,9 @@ public:
     Mutex m_control_mutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn)
-        : nBatchSize(nBatchSizeIn)
+    explicit CCheckQueue(unsigned int nBatchSizeIn, std::string thread_name = "scriptch",
+                         SyscallSandboxPolicy sandbox_policy = SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK)
+        : nBatchSize(nBatchSizeIn), m_thread_name(std::move(thread_name)), m_sandbox_policy(sandbox_policy)
     {
     }
 
@@ -148,8 +155,8 @@ public:
         assert(m_worker_threads.empty());
         for (int n = 0; n < threads_num; ++n) {
             m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                SetSyscallSandboxPolicy(SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK);
+                util::ThreadRename(strprintf("%s.%i", m_thread_name, n));
+                SetSyscallSandboxPolicy(m_sandbox_policy);
                 Loop(false /* worker thread */);
             });
         }
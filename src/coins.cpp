@@ -34,7 +34,7 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 CCoinsViewCache::CCoinsViewCache(CCoinsView* baseIn, bool deterministic) :
     CCoinsViewBacked(baseIn), m_deterministic(deterministic),
-    cacheCoins(0, SaltedOutpointHasher(/*deterministic=*/deterministic))
+    cacheCoins{0, SaltedOutpointHasher{/*deterministic=*/deterministic}, CCoinsMap::key_equal{}, &m_cache_coins_memory_resource}
 {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
@@ -115,6 +115,15 @@ void CCoinsViewCache::EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coi
         std::forward_as_tuple(std::move(coin), CCoinsCacheEntry::DIRTY));
 }
 
+void CCoinsViewCache::AddPrefetchedCoin(const COutPoint& outpoint, Coin&& coin)
+{
+    assert(!coin.IsSpent());
+    auto [it, inserted] = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (inserted) {
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    }
+}
+
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check_for_overwrite) {
     bool fCoinbase = tx.IsCoinBase();
     const uint256& txid = tx.GetHash();
@@ -278,6 +287,41 @@ bool CCoinsViewCache::Sync()
     return fOk;
 }
 
+void CCoinsViewCache::MoveDirtyCoins(CCoinsMap& coins, size_t max_usage)
+{
+    for (auto it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+            continue;
+        }
+        cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+        if (!(it->second.flags & CCoinsCacheEntry::FRESH) || !it->second.coin.IsSpent()) {
+            coins.insert_or_assign(it->first, CCoinsCacheEntry{std::move(it->second.coin), CCoinsCacheEntry::DIRTY});
+        }
+        it = cacheCoins.erase(it);
+    }
+    if (DynamicMemoryUsage() <= max_usage) return;
+
+    // The memory resource does not give back the memory of erased entries.
+    // Keep as many unmodified entries as fit, then start with a fresh one.
+    CCoinsMapMemoryResource kept_resource{};
+    CCoinsMap kept{0, SaltedOutpointHasher{/*deterministic=*/m_deterministic}, CCoinsMap::key_equal{}, &kept_resource};
+    size_t kept_coins_usage{0};
+    for (auto& [outpoint, entry] : cacheCoins) {
+        const size_t coin_usage{entry.coin.DynamicMemoryUsage()};
+        if (memusage::DynamicUsage(kept) + kept_coins_usage + coin_usage > max_usage) break;
+        kept_coins_usage += coin_usage;
+        kept.try_emplace(outpoint, std::move(entry));
+    }
+    cacheCoins.clear();
+    ReallocateCache();
+    cacheCoins.reserve(kept.size());
+    for (auto& [outpoint, entry] : kept) {
+        cacheCoins.try_emplace(outpoint, std::move(entry));
+    }
+    cachedCoinsUsage = kept_coins_usage;
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -314,7 +358,9 @@ void CCoinsViewCache::ReallocateCache()
     // Cache should be empty when we're calling this.
     assert(cacheCoins.size() == 0);
     cacheCoins.~CCoinsMap();
-    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(/*deterministic=*/m_deterministic));
+    m_cache_coins_memory_resource.~CCoinsMapMemoryResource();
+    ::new (&m_cache_coins_memory_resource) CCoinsMapMemoryResource{};
+    ::new (&cacheCoins) CCoinsMap{0, SaltedOutpointHasher{/*deterministic=*/m_deterministic}, CCoinsMap::key_equal{}, &m_cache_coins_memory_resource};
 }
 
 void CCoinsViewCache::SanityCheck() const
@@ -11,6 +11,7 @@
 #include <memusage.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 #include <util/hasher.h>
 
@@ -131,7 +132,22 @@ struct CCoinsCacheEntry
     CCoinsCacheEntry(Coin&& coin_, unsigned char flag) : coin(std::move(coin_)), flags(flag) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * PoolAllocator's MAX_BLOCK_SIZE_BYTES parameter here uses sizeof the data, and adds the size
+ * of 4 pointers. We do not know the exact node size used in the std::unordered_node implementation
+ * because it is implementation defined. Most implementations have an overhead of 1 or 2 pointers,
+ * so nodes can be connected in a linked list, and in some cases the hash value is stored as well.
+ * Using an additional sizeof(void*)*4 for MAX_BLOCK_SIZE_BYTES should thus be sufficient so that
+ * all implementations can allocate the nodes from the PoolAllocator.
+ */
+using CCoinsMap = std::unordered_map<COutPoint,
+                                     CCoinsCacheEntry,
+                                     SaltedOutpointHasher,
+                                     std::equal_to<COutPoint>,
+                                     PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                                   sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4>>;
+
+using CCoinsMapMemoryResource = CCoinsMap::allocator_type::ResourceType;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -220,6 +236,7 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource{};
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -277,6 +294,17 @@ public:
      */
     void EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin);
 
+    /**
+     * Insert an unspent coin that was read from the backing view ahead of time
+     * (e.g. by the coins prefetch workers), exactly as FetchCoin() would have
+     * cached it. The entry is neither DIRTY nor FRESH. Has no effect if the
+     * outpoint is already present in the cache.
+     *
+     * The caller must ensure the backing view has not been modified since the
+     * coin was read from it.
+     */
+    void AddPrefetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -301,6 +329,16 @@ public:
      */
     bool Sync();
 
+    /**
+     * Move the modified entries of this cache into coins, marked DIRTY, so that
+     * they can be written to the base while this cache keeps being used. The
+     * base must serve the moved entries until they are written. Spent entries
+     * that the base does not have are dropped. Unmodified entries stay cached;
+     * if the cache uses more than max_usage bytes afterwards, its memory is
+     * released and only as many of them are kept as fit into max_usage.
+     */
+    void MoveDirtyCoins(CCoinsMap& coins, size_t max_usage);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
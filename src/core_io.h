@@ -6,8 +6,12 @@
 #define MYTHERRA_CORE_IO_H
 
 #include <consensus/amount.h>
+#include <span.h>
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class CBlock;
@@ -29,6 +33,54 @@ enum class TxVerbosity {
     SHOW_DETAILS_AND_PREVOUT  //!< The same as previous option with information about prevouts if available
 };
 
+/**
+ * Writes JSON text straight into a buffer, without building a UniValue tree
+ * first. The text is the same as UniValue::write() without indentation would
+ * produce for the same values.
+ *
+ * With a sink, the buffer is handed to it whenever an object or array ends
+ * and the buffer has grown past FLUSH_SIZE, and on Flush().
+ */
+class JSONWriter
+{
+public:
+    static constexpr size_t FLUSH_SIZE{1 << 16};
+
+    explicit JSONWriter(std::function<void(const std::string&)> sink = {}) : m_sink{std::move(sink)} {}
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write the key of the next object member. */
+    void Key(std::string_view key);
+    void String(std::string_view str);
+    /** Write bytes as a hex string. */
+    void Hex(Span<const unsigned char> bytes);
+    void Int(int64_t value);
+    void Bool(bool value);
+    /** Write an amount the way ValueFromAmount() does. */
+    void Amount(CAmount amount);
+    void Value(const UniValue& value);
+
+    /** Hand the buffered text to the sink. */
+    void Flush();
+    /** The buffered text, for writers without a sink. */
+    const std::string& Text() const { return m_buf; }
+
+private:
+    /** Separate the next value from the previous one, if needed. */
+    void Separate()
+    {
+        if (m_need_comma) m_buf += ',';
+    }
+    void MaybeFlush();
+
+    std::function<void(const std::string&)> m_sink;
+    std::string m_buf;
+    bool m_need_comma{false};
+};
+
 // core_read.cpp
 CScript ParseScript(const std::string& s);
 std::string ScriptToAsmStr(const CScript& script, const bool fAttemptSighashDecode = false);
@@ -55,5 +107,7 @@ std::string EncodeHexTx(const CTransaction& tx, const int serializeFlags = 0);
 std::string SighashToStr(unsigned char sighash_type);
 void ScriptToUniv(const CScript& script, UniValue& out, bool include_hex = true, bool include_address = false, const SigningProvider* provider = nullptr);
 void TxToUniv(const CTransaction& tx, const uint256& block_hash, UniValue& entry, bool include_hex = true, int serialize_flags = 0, const CTxUndo* txundo = nullptr, TxVerbosity verbosity = TxVerbosity::SHOW_DETAILS);
+/** Same as TxToUniv, but written as a JSON object to out. */
+void TxToJSON(const CTransaction& tx, const uint256& block_hash, JSONWriter& out, bool include_hex = true, int serialize_flags = 0, const CTxUndo* txundo = nullptr, TxVerbosity verbosity = TxVerbosity::SHOW_DETAILS);
 
 #endif // MYTHERRA_CORE_IO_H
@@ -15,10 +15,12 @@
 #include <streams.h>
 #include <undo.h>
 #include <univalue.h>
+#include <univalue_escapes.h>
 #include <util/check.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 
+#include <charconv>
 #include <map>
 #include <string>
 #include <vector>
@@ -172,6 +174,8 @@ void TxToUniv(const CTransaction& tx, const uint256& block_hash, UniValue& entry
 {
     CHECK_NONFATAL(verbosity >= TxVerbosity::SHOW_DETAILS);
 
+    // Keep in sync with TxToJSON, the output must be the same.
+
     entry.pushKV("txid", tx.GetHash().GetHex());
     entry.pushKV("hash", tx.GetWitnessHash().GetHex());
     // Transaction version is actually unsigned in consensus checks, just signed in memory,
@@ -267,3 +271,280 @@ void TxToUniv(const CTransaction& tx, const uint256& block_hash, UniValue& entry
         entry.pushKV("hex", EncodeHexTx(tx, serialize_flags)); // The hex-encoded transaction. Used the name "hex" to be consistent with the verbose output of "getrawtransaction".
     }
 }
+
+void JSONWriter::BeginObject()
+{
+    Separate();
+    m_buf += '{';
+    m_need_comma = false;
+}
+
+void JSONWriter::EndObject()
+{
+    m_buf += '}';
+    m_need_comma = true;
+    MaybeFlush();
+}
+
+void JSONWriter::BeginArray()
+{
+    Separate();
+    m_buf += '[';
+    m_need_comma = false;
+}
+
+void JSONWriter::EndArray()
+{
+    m_buf += ']';
+    m_need_comma = true;
+    MaybeFlush();
+}
+
+/** Append str as the contents of a JSON string, escaped like UniValue does. */
+static void AppendEscaped(std::string& buf, std::string_view str)
+{
+    for (const char c : str) {
+        const char* escaped{escapes[static_cast<unsigned char>(c)]};
+        if (escaped) {
+            buf += escaped;
+        } else {
+            buf += c;
+        }
+    }
+}
+
+void JSONWriter::Key(std::string_view key)
+{
+    Separate();
+    m_buf += '"';
+    AppendEscaped(m_buf, key);
+    m_buf += "\":";
+    m_need_comma = false;
+}
+
+void JSONWriter::String(std::string_view str)
+{
+    Separate();
+    m_buf += '"';
+    AppendEscaped(m_buf, str);
+    m_buf += '"';
+    m_need_comma = true;
+}
+
+void JSONWriter::Hex(Span<const unsigned char> bytes)
+{
+    static constexpr char HEX_DIGITS[]{"0123456789abcdef"};
+    Separate();
+    m_buf += '"';
+    size_t pos{m_buf.size()};
+    m_buf.resize(pos + bytes.size() * 2);
+    for (const unsigned char b : bytes) {
+        m_buf[pos++] = HEX_DIGITS[b >> 4];
+        m_buf[pos++] = HEX_DIGITS[b & 15];
+    }
+    m_buf += '"';
+    m_need_comma = true;
+}
+
+void JSONWriter::Int(int64_t value)
+{
+    Separate();
+    char digits[24];
+    const auto res{std::to_chars(std::begin(digits), std::end(digits), value)};
+    m_buf.append(digits, res.ptr);
+    m_need_comma = true;
+}
+
+void JSONWriter::Bool(bool value)
+{
+    Separate();
+    m_buf += value ? "true" : "false";
+    m_need_comma = true;
+}
+
+void JSONWriter::Amount(CAmount amount)
+{
+    Separate();
+    int64_t quotient = amount / COIN;
+    int64_t remainder = amount % COIN;
+    if (amount < 0) {
+        quotient = -quotient;
+        remainder = -remainder;
+        m_buf += '-';
+    }
+    char digits[24];
+    const auto res{std::to_chars(std::begin(digits), std::end(digits), quotient)};
+    m_buf.append(digits, res.ptr);
+    m_buf += '.';
+    // Eight digits, with leading zeros.
+    const size_t pos{m_buf.size()};
+    m_buf.append(8, '0');
+    for (size_t i = 8; remainder > 0; remainder /= 10) {
+        m_buf[pos + --i] = '0' + remainder % 10;
+    }
+    m_need_comma = true;
+}
+
+void JSONWriter::Value(const UniValue& value)
+{
+    Separate();
+    m_buf += value.write();
+    m_need_comma = true;
+}
+
+void JSONWriter::Flush()
+{
+    if (m_sink && !m_buf.empty()) {
+        m_sink(m_buf);
+        m_buf.clear();
+    }
+}
+
+void JSONWriter::MaybeFlush()
+{
+    if (m_sink && m_buf.size() >= FLUSH_SIZE) Flush();
+}
+
+/** ScriptToUniv with include_hex and include_address, written to out. */
+static void ScriptToJSON(const CScript& script, JSONWriter& out)
+{
+    out.BeginObject();
+    out.Key("asm");
+    out.String(ScriptToAsmStr(script));
+    out.Key("desc");
+    out.String(InferDescriptor(script, DUMMY_SIGNING_PROVIDER)->ToString());
+    out.Key("hex");
+    out.Hex(script);
+
+    std::vector<std::vector<unsigned char>> solns;
+    const TxoutType type{Solver(script, solns)};
+
+    CTxDestination address;
+    if (ExtractDestination(script, address) && type != TxoutType::PUBKEY) {
+        out.Key("address");
+        out.String(EncodeDestination(address));
+    }
+    out.Key("type");
+    out.String(GetTxnOutputType(type));
+    out.EndObject();
+}
+
+void TxToJSON(const CTransaction& tx, const uint256& block_hash, JSONWriter& out, bool include_hex, int serialize_flags, const CTxUndo* txundo, TxVerbosity verbosity)
+{
+    CHECK_NONFATAL(verbosity >= TxVerbosity::SHOW_DETAILS);
+
+    // Keep in sync with TxToUniv, the output must be the same.
+    out.BeginObject();
+    out.Key("txid");
+    out.String(tx.GetHash().GetHex());
+    out.Key("hash");
+    out.String(tx.GetWitnessHash().GetHex());
+    out.Key("version");
+    out.Int(static_cast<uint32_t>(tx.nVersion));
+    out.Key("size");
+    out.Int(::GetSerializeSize(tx, PROTOCOL_VERSION));
+    out.Key("vsize");
+    out.Int((GetTransactionWeight(tx) + WITNESS_SCALE_FACTOR - 1) / WITNESS_SCALE_FACTOR);
+    out.Key("weight");
+    out.Int(GetTransactionWeight(tx));
+    out.Key("locktime");
+    out.Int(tx.nLockTime);
+
+    const bool have_undo = txundo != nullptr;
+    CAmount amt_total_in = 0;
+    CAmount amt_total_out = 0;
+
+    out.Key("vin");
+    out.BeginArray();
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        const CTxIn& txin = tx.vin[i];
+        out.BeginObject();
+        if (tx.IsCoinBase()) {
+            out.Key("coinbase");
+            out.Hex(txin.scriptSig);
+        } else {
+            out.Key("txid");
+            out.String(txin.prevout.hash.GetHex());
+            out.Key("vout");
+            out.Int(txin.prevout.n);
+            out.Key("scriptSig");
+            out.BeginObject();
+            out.Key("asm");
+            out.String(ScriptToAsmStr(txin.scriptSig, true));
+            out.Key("hex");
+            out.Hex(txin.scriptSig);
+            out.EndObject();
+        }
+        if (!txin.scriptWitness.IsNull()) {
+            out.Key("txinwitness");
+            out.BeginArray();
+            for (const auto& item : txin.scriptWitness.stack) {
+                out.Hex(item);
+            }
+            out.EndArray();
+        }
+        if (have_undo) {
+            const Coin& prev_coin = txundo->vprevout[i];
+            const CTxOut& prev_txout = prev_coin.out;
+
+            amt_total_in += prev_txout.nValue;
+
+            if (verbosity == TxVerbosity::SHOW_DETAILS_AND_PREVOUT) {
+                out.Key("prevout");
+                out.BeginObject();
+                out.Key("generated");
+                out.Bool(prev_coin.fCoinBase);
+                out.Key("height");
+                out.Int(prev_coin.nHeight);
+                out.Key("value");
+                out.Amount(prev_txout.nValue);
+                out.Key("scriptPubKey");
+                ScriptToJSON(prev_txout.scriptPubKey, out);
+                out.EndObject();
+            }
+        }
+        out.Key("sequence");
+        out.Int(txin.nSequence);
+        out.EndObject();
+    }
+    out.EndArray();
+
+    out.Key("vout");
+    out.BeginArray();
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        const CTxOut& txout = tx.vout[i];
+        out.BeginObject();
+        out.Key("value");
+        out.Amount(txout.nValue);
+        out.Key("n");
+        out.Int(i);
+        out.Key("scriptPubKey");
+        ScriptToJSON(txout.scriptPubKey, out);
+        out.EndObject();
+
+        if (have_undo) {
+            amt_total_out += txout.nValue;
+        }
+    }
+    out.EndArray();
+
+    if (have_undo) {
+        const CAmount fee = amt_total_in - amt_total_out;
+        CHECK_NONFATAL(MoneyRange(fee));
+        out.Key("fee");
+        out.Amount(fee);
+    }
+
+    if (!block_hash.IsNull()) {
+        out.Key("blockhash");
+        out.String(block_hash.GetHex());
+    }
+
+    if (include_hex) {
+        CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION | serialize_flags);
+        ssTx << tx;
+        out.Key("hex");
+        out.Hex(MakeUCharSpan(ssTx));
+    }
+    out.EndObject();
+}
@@ -24,6 +24,9 @@
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
 
+/** Number of worker threads that may execute the calls of one batch request */
+static int g_rpc_batch_threads{DEFAULT_RPC_BATCH_THREADS};
+
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
  */
@@ -174,6 +177,17 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         return false;
     }
 
+    // Results that are streamed by the RPC method are sent right away, wrapped
+    // the same way as JSONRPCReply would.
+    JSONRPCResultWriter result_writer{[&](const std::string& chunk) {
+        if (!result_writer.Used()) {
+            req->WriteHeader("Content-Type", "application/json");
+            req->StartReply(HTTP_OK);
+            req->WriteReplyChunk("{\"result\":");
+        }
+        req->WriteReplyChunk(chunk);
+    }};
+
     try {
         // Parse request
         UniValue valRequest;
@@ -198,7 +212,13 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+            jreq.result_writer = &result_writer;
             UniValue result = tableRPC.execute(jreq);
+            if (result_writer.Used()) {
+                req->WriteReplyChunk(",\"error\":null,\"id\":" + jreq.id.write() + "}\n");
+                req->EndReply();
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -221,7 +241,7 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                     }
                 }
             }
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            strReply = JSONRPCExecBatch(jreq, valRequest.get_array(), g_rpc_batch_threads, EnqueueHTTPTask);
         }
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
@@ -229,10 +249,20 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        // A streamed reply can no longer be turned into an error reply, so the
+        // connection is closed before the reply is complete.
+        if (result_writer.Used()) {
+            req->AbortReply();
+        } else {
+            JSONErrorReply(req, objError, jreq.id);
+        }
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        if (result_writer.Used()) {
+            req->AbortReply();
+        } else {
+            JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        }
         return false;
     }
     return true;
@@ -297,6 +327,8 @@ bool StartHTTPRPC(const std::any& context)
     if (!InitRPCAuthentication())
         return false;
 
+    g_rpc_batch_threads = std::max<int>(gArgs.GetIntArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 1);
+
     auto handle_rpc = [context](HTTPRequest* req, const std::string&) { return HTTPReq_JSONRPC(context, req); };
     RegisterHTTPHandler("/", true, handle_rpc);
     if (g_wallet_init_interface.HasWalletSupport()) {
@@ -21,6 +21,7 @@
 #include <util/threadnames.h>
 #include <util/translation.h>
 
+#include <chrono>
 #include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
@@ -46,6 +47,9 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Maximum number of chunks of a streamed reply that may wait to be sent to the client. */
+static constexpr size_t MAX_PENDING_REPLY_CHUNKS{8};
+
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
 {
@@ -66,6 +70,20 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Task work item, for work that does not come from a request */
+class HTTPTaskItem final : public HTTPClosure
+{
+public:
+    explicit HTTPTaskItem(std::function<void()> task) : m_task(std::move(task)) {}
+    void operator()() override
+    {
+        m_task();
+    }
+
+private:
+    std::function<void()> m_task;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -136,10 +154,10 @@ struct HTTPPathHandler
 
 /** HTTP module state */
 
-//! libevent event loop
-static struct event_base* eventBase = nullptr;
-//! HTTP server
-static struct evhttp* eventHTTP = nullptr;
+//! libevent event loops, one per event thread. Each serves the connections it accepted.
+static std::vector<struct event_base*> g_event_bases;
+//! HTTP servers, one per event loop, all listening on the same sockets
+static std::vector<struct evhttp*> g_evhttps;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
@@ -147,8 +165,8 @@ static std::unique_ptr<WorkQueue<HTTPClosure>> g_work_queue{nullptr};
 //! Handlers for (sub)paths
 static GlobalMutex g_httppathhandlers_mutex;
 static std::vector<HTTPPathHandler> pathHandlers GUARDED_BY(g_httppathhandlers_mutex);
-//! Bound listening sockets
-static std::vector<evhttp_bound_socket *> boundSockets;
+//! Listening sockets, with the HTTP server they belong to
+static std::vector<std::pair<struct evhttp*, evhttp_bound_socket*>> boundSockets;
 //! Track active requests
 static GlobalMutex g_requests_mutex;
 static std::condition_variable g_requests_cv;
@@ -297,9 +315,9 @@ static void http_reject_request_cb(struct evhttp_request* req, void*)
 }
 
 /** Event dispatcher thread */
-static void ThreadHTTP(struct event_base* base)
+static void ThreadHTTP(struct event_base* base, int thread_num)
 {
-    util::ThreadRename("http");
+    util::ThreadRename(thread_num == 0 ? "http" : strprintf("http.%i", thread_num));
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::NET_HTTP_SERVER);
     LogPrint(BCLog::HTTP, "Entering http event loop\n");
     event_base_dispatch(base);
@@ -341,7 +359,7 @@ static bool HTTPBindAddresses(struct evhttp* http)
             if (i->first.empty() || (LookupHost(i->first, addr, false) && addr.IsBindAny())) {
                 LogPrintf("WARNING: the RPC server is not safe to expose to untrusted networks such as the public internet\n");
             }
-            boundSockets.push_back(bind_handle);
+            boundSockets.emplace_back(http, bind_handle);
         } else {
             LogPrintf("Binding RPC on address %s port %i failed.\n", i->first, i->second);
         }
@@ -349,6 +367,33 @@ static bool HTTPBindAddresses(struct evhttp* http)
     return !boundSockets.empty();
 }
 
+/** Let another HTTP server accept connections on the sockets that were
+ * bound by the first one. Every event loop waits on the same listening
+ * sockets, and whichever is free first accepts the next connection.
+ */
+static bool HTTPShareBoundSockets(struct evhttp* http)
+{
+#ifdef WIN32
+    // Windows sockets cannot be duplicated with dup().
+    return false;
+#else
+    std::vector<std::pair<struct evhttp*, evhttp_bound_socket*>> handles;
+    for (const auto& bound : boundSockets) {
+        // Each listener closes its socket when it is freed, so it gets its own descriptor.
+        const evutil_socket_t fd{dup(evhttp_bound_socket_get_fd(bound.second))};
+        if (fd < 0) return false;
+        evhttp_bound_socket* handle{evhttp_accept_socket_with_handle(http, fd)};
+        if (!handle) {
+            close(fd);
+            return false;
+        }
+        handles.emplace_back(http, handle);
+    }
+    boundSockets.insert(boundSockets.end(), handles.begin(), handles.end());
+    return true;
+#endif
+}
+
 /** Simple wrapper to set thread name and run work queue */
 static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num)
 {
@@ -394,24 +439,38 @@ bool InitHTTPServer()
     evthread_use_pthreads();
 #endif
 
-    raii_event_base base_ctr = obtain_event_base();
-
-    /* Create a new evhttp object to handle requests. */
-    raii_evhttp http_ctr = obtain_evhttp(base_ctr.get());
-    struct evhttp* http = http_ctr.get();
-    if (!http) {
-        LogPrintf("couldn't create evhttp. Exiting.\n");
-        return false;
-    }
+    int event_threads = std::max((long)gArgs.GetIntArg("-rpceventthreads", DEFAULT_HTTP_EVENT_THREADS), 1L);
+    std::vector<raii_event_base> base_ctrs;
+    std::vector<raii_evhttp> http_ctrs;
+    for (int i = 0; i < event_threads; ++i) {
+        raii_event_base base_ctr = obtain_event_base();
+
+        /* Create a new evhttp object to handle requests. */
+        raii_evhttp http_ctr = obtain_evhttp(base_ctr.get());
+        struct evhttp* http = http_ctr.get();
+        if (!http) {
+            LogPrintf("couldn't create evhttp. Exiting.\n");
+            boundSockets.clear();
+            return false;
+        }
 
-    evhttp_set_timeout(http, gArgs.GetIntArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
-    evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
-    evhttp_set_max_body_size(http, MAX_SIZE);
-    evhttp_set_gencb(http, http_request_cb, nullptr);
+        evhttp_set_timeout(http, gArgs.GetIntArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+        evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
+        evhttp_set_max_body_size(http, MAX_SIZE);
+        evhttp_set_gencb(http, http_request_cb, nullptr);
 
-    if (!HTTPBindAddresses(http)) {
-        LogPrintf("Unable to bind any endpoint for RPC server\n");
-        return false;
+        if (i == 0) {
+            if (!HTTPBindAddresses(http)) {
+                LogPrintf("Unable to bind any endpoint for RPC server\n");
+                boundSockets.clear();
+                return false;
+            }
+        } else if (!HTTPShareBoundSockets(http)) {
+            LogPrintf("WARNING: cannot share the RPC sockets with more event threads, using %d\n", i);
+            break;
+        }
+        base_ctrs.push_back(std::move(base_ctr));
+        http_ctrs.push_back(std::move(http_ctr));
     }
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
@@ -419,9 +478,11 @@ bool InitHTTPServer()
     LogPrintfCategory(BCLog::HTTP, "creating work queue of depth %d\n", workQueueDepth);
 
     g_work_queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth);
-    // transfer ownership to eventBase/HTTP via .release()
-    eventBase = base_ctr.release();
-    eventHTTP = http_ctr.release();
+    // transfer ownership to g_event_bases/g_evhttps via .release()
+    for (size_t i = 0; i < base_ctrs.size(); ++i) {
+        g_event_bases.push_back(base_ctrs[i].release());
+        g_evhttps.push_back(http_ctrs[i].release());
+    }
     return true;
 }
 
@@ -433,15 +494,17 @@ void UpdateHTTPServerLogging(bool enable) {
     }
 }
 
-static std::thread g_thread_http;
+static std::vector<std::thread> g_threads_http;
 static std::vector<std::thread> g_thread_http_workers;
 
 void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
     int rpcThreads = std::max((long)gArgs.GetIntArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintfCategory(BCLog::HTTP, "starting %d worker threads\n", rpcThreads);
-    g_thread_http = std::thread(ThreadHTTP, eventBase);
+    LogPrintfCategory(BCLog::HTTP, "starting %d event threads and %d worker threads\n", g_event_bases.size(), rpcThreads);
+    for (size_t i = 0; i < g_event_bases.size(); i++) {
+        g_threads_http.emplace_back(ThreadHTTP, g_event_bases[i], int(i));
+    }
 
     for (int i = 0; i < rpcThreads; i++) {
         g_thread_http_workers.emplace_back(HTTPWorkQueueRun, g_work_queue.get(), i);
@@ -451,9 +514,9 @@ void StartHTTPServer()
 void InterruptHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Interrupting HTTP server\n");
-    if (eventHTTP) {
+    for (struct evhttp* http : g_evhttps) {
         // Reject requests on current connections
-        evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
+        evhttp_set_gencb(http, http_reject_request_cb, nullptr);
     }
     if (g_work_queue) {
         g_work_queue->Interrupt();
@@ -472,8 +535,8 @@ void StopHTTPServer()
     }
     // Unlisten sockets, these are what make the event loop running, which means
     // that after this and all connections are closed the event loop will quit.
-    for (evhttp_bound_socket *socket : boundSockets) {
-        evhttp_del_accept_socket(eventHTTP, socket);
+    for (const auto& [http, socket] : boundSockets) {
+        evhttp_del_accept_socket(http, socket);
     }
     boundSockets.clear();
     {
@@ -485,28 +548,42 @@ void StopHTTPServer()
             return g_requests.empty();
         });
     }
-    if (eventHTTP) {
+    for (size_t i = 0; i < g_evhttps.size(); i++) {
         // Schedule a callback to call evhttp_free in the event base thread, so
         // that evhttp_free does not need to be called again after the handling
         // of unfinished request connections that follows.
-        event_base_once(eventBase, -1, EV_TIMEOUT, [](evutil_socket_t, short, void*) {
-            evhttp_free(eventHTTP);
-            eventHTTP = nullptr;
-        }, nullptr, nullptr);
-    }
-    if (eventBase) {
-        LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
-        if (g_thread_http.joinable()) g_thread_http.join();
-        event_base_free(eventBase);
-        eventBase = nullptr;
+        event_base_once(g_event_bases[i], -1, EV_TIMEOUT, [](evutil_socket_t, short, void* http) {
+            evhttp_free(static_cast<struct evhttp*>(http));
+        }, g_evhttps[i], nullptr);
+    }
+    g_evhttps.clear();
+    if (!g_event_bases.empty()) {
+        LogPrint(BCLog::HTTP, "Waiting for HTTP event threads to exit\n");
+        for (auto& thread : g_threads_http) {
+            if (thread.joinable()) thread.join();
+        }
+        g_threads_http.clear();
+        for (struct event_base* base : g_event_bases) {
+            event_base_free(base);
+        }
+        g_event_bases.clear();
     }
     g_work_queue.reset();
     LogPrint(BCLog::HTTP, "Stopped HTTP server\n");
 }
 
+bool EnqueueHTTPTask(std::function<void()> task)
+{
+    if (!g_work_queue) return false;
+    std::unique_ptr<HTTPTaskItem> item(new HTTPTaskItem(std::move(task)));
+    if (!g_work_queue->Enqueue(item.get())) return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 struct event_base* EventBase()
 {
-    return eventBase;
+    return g_event_bases.empty() ? nullptr : g_event_bases.front();
 }
 
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
@@ -537,11 +614,20 @@ void HTTPEvent::trigger(struct timeval* tv)
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_req), replySent(_replySent)
 {
+    // Requests are created on the thread of the event loop that serves their
+    // connection, the only thread that may look the connection up.
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    m_event_base = conn ? evhttp_connection_get_base(conn) : EventBase();
 }
 
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (replyStarted && !replySent) {
+        // A streamed reply that was not finished: abort it, so that the client
+        // does not wait for more or take the truncated body for a whole one.
+        LogPrintf("%s: Unfinished reply\n", __func__);
+        AbortReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Unhandled request");
@@ -587,6 +673,22 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+/** Re-enable reading from the socket of a request that was replied to. This is
+ * the second part of the libevent workaround in http_request_cb.
+ */
+static void ReenableReading(evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -603,19 +705,139 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     assert(evb);
     evbuffer_add(evb, strReply.data(), strReply.size());
     auto req_copy = req;
-    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
+    HTTPEvent* ev = new HTTPEvent(m_event_base, true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
+        ReenableReading(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+/** Chunks of a streamed reply that were written by the worker thread, but are
+ * not sent to the client yet. The counts change on the http thread.
+ */
+struct HTTPRequest::ReplyChunkWindow {
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    //! Chunks whose event did not run yet.
+    size_t m_queued GUARDED_BY(m_mutex){0};
+    //! Chunks in the output buffer of the connection.
+    size_t m_unsent GUARDED_BY(m_mutex){0};
+    //! The connection was closed, nothing more will be sent.
+    bool m_closed GUARDED_BY(m_mutex){false};
+
+    /** Called when the output buffer of the connection was written out. */
+    static void OnSent(evhttp_connection*, void* arg)
+    {
+        auto* window{static_cast<ReplyChunkWindow*>(arg)};
+        WITH_LOCK(window->m_mutex, window->m_unsent = 0);
+        window->m_cv.notify_all();
+    }
+
+    static void OnClosed(evhttp_connection*, void* arg)
+    {
+        auto* window{static_cast<ReplyChunkWindow*>(arg)};
+        WITH_LOCK(window->m_mutex, window->m_closed = true);
+        window->m_cv.notify_all();
+    }
+};
+
+/** Stop notifying the window of a streamed reply about its connection, which
+ * may outlive the reply.
+ */
+static void ForgetReplyChunkWindow(evhttp_request* req)
+{
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (conn) evhttp_connection_set_closecb(conn, nullptr, nullptr);
+}
+
+void HTTPRequest::StartReply(int nStatus)
+{
+    assert(!replySent && !replyStarted && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    m_chunk_window = std::make_shared<ReplyChunkWindow>();
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(m_event_base, true, [req_copy, nStatus, window = m_chunk_window]{
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn) evhttp_connection_set_closecb(conn, ReplyChunkWindow::OnClosed, window.get());
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+    replyStarted = true;
+}
+
+void HTTPRequest::WriteReplyChunk(std::string_view chunk)
+{
+    assert(replyStarted && req);
+    if (chunk.empty()) return;
+    {
+        // Wait for the client to catch up. Polled, so that a shutdown, which
+        // may stop the http thread, does not leave this waiting forever.
+        ReplyChunkWindow& window{*m_chunk_window};
+        WAIT_LOCK(window.m_mutex, lock);
+        while (!window.m_cv.wait_for(lock, std::chrono::milliseconds{100}, [&]() EXCLUSIVE_LOCKS_REQUIRED(window.m_mutex) {
+            return window.m_queued + window.m_unsent < MAX_PENDING_REPLY_CHUNKS || window.m_closed;
+        })) {
+            if (ShutdownRequested()) break;
         }
+        if (window.m_closed) return;
+        ++window.m_queued;
+    }
+    // The chunk is handed to the main http thread in its own buffer. Events are
+    // run in the order they were triggered, so the chunks reach the client in order.
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(m_event_base, true, [req_copy, evb, window = m_chunk_window]{
+        evhttp_send_reply_chunk_with_cb(req_copy, evb, ReplyChunkWindow::OnSent, window.get());
+        evbuffer_free(evb);
+        // Nothing was added to the output buffer if it is empty already, e.g.
+        // for a HEAD request, and then OnSent is not called.
+        bool unsent{false};
+        if (evhttp_connection* conn = evhttp_request_get_connection(req_copy)) {
+            unsent = evbuffer_get_length(bufferevent_get_output(evhttp_connection_get_bufferevent(conn))) > 0;
+        }
+        {
+            LOCK(window->m_mutex);
+            --window->m_queued;
+            if (unsent) ++window->m_unsent;
+        }
+        window->m_cv.notify_all();
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::EndReply()
+{
+    assert(replyStarted && req);
+    auto req_copy = req;
+    // The window is kept alive until its callbacks were replaced.
+    HTTPEvent* ev = new HTTPEvent(m_event_base, true, [req_copy, window = m_chunk_window]{
+        ForgetReplyChunkWindow(req_copy);
+        evhttp_send_reply_end(req_copy);
+        ReenableReading(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+void HTTPRequest::AbortReply()
+{
+    assert(replyStarted && req);
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(m_event_base, true, [req_copy, window = m_chunk_window]{
+        ForgetReplyChunkWindow(req_copy);
+        // Freeing the connection frees the request without completing it, so
+        // stop tracking it here.
+        WITH_LOCK(g_requests_mutex, g_requests.erase(req_copy));
+        g_requests_cv.notify_all();
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn) evhttp_connection_free(conn);
     });
     ev->trigger(nullptr);
     replySent = true;
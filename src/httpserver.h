@@ -6,10 +6,13 @@
 #define MYTHERRA_HTTPSERVER_H
 
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_EVENT_THREADS=1;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
@@ -45,6 +48,11 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Queue a task for the HTTP worker threads, behind the requests that are
+ * already queued. Returns false if the work queue is full or stopped.
+ */
+bool EnqueueHTTPTask(std::function<void()> task);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -57,7 +65,13 @@ class HTTPRequest
 {
 private:
     struct evhttp_request* req;
+    //! The event loop that serves the connection of the request. Replies must be sent from its thread.
+    struct event_base* m_event_base;
     bool replySent;
+    bool replyStarted{false};
+    struct ReplyChunkWindow;
+    //! Chunks of a reply started with StartReply that the client did not receive yet.
+    std::shared_ptr<ReplyChunkWindow> m_chunk_window;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req, bool replySent = false);
@@ -124,6 +138,38 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a HTTP reply whose body is sent in pieces, with chunked transfer
+     * encoding. Headers must be written before this. The body is written with
+     * WriteReplyChunk and the reply is finished with EndReply.
+     *
+     * @note Use instead of WriteReply, for bodies that are too large to build
+     * in memory at once.
+     */
+    void StartReply(int nStatus);
+
+    /**
+     * Send the next piece of the body of a reply started with StartReply.
+     *
+     * Blocks while too many earlier pieces were not sent to the client yet, so
+     * that a slow client does not make the whole body pile up in memory.
+     */
+    void WriteReplyChunk(std::string_view chunk);
+
+    /**
+     * Finish a reply started with StartReply. Like WriteReply, this gives the
+     * request back to the main thread.
+     */
+    void EndReply();
+
+    /**
+     * Give up on a reply started with StartReply, when the rest of its body
+     * can not be sent. The connection is closed without finishing the chunked
+     * body, so that the client sees the reply fail rather than a truncated
+     * one. Like EndReply, this gives the request back to the main thread.
+     */
+    void AbortReply();
 };
 
 /** Get the query parameter value from request uri for a specified key, or std::nullopt if the key
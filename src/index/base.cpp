@@ -20,16 +20,40 @@
 #include <validation.h> // For g_chainman
 #include <warnings.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 
 using node::ReadBlockFromDisk;
+using node::UndoReadFromDisk;
 
 constexpr uint8_t DB_BEST_BLOCK{'B'};
 
 constexpr auto SYNC_LOG_INTERVAL{30s};
 constexpr auto SYNC_LOCATOR_WRITE_INTERVAL{30s};
 
+/**
+ * Maximum number of blocks an index sync thread may get ahead of a slower
+ * index that is syncing at the same time, so that they share the block data
+ * they read. This also bounds the number of blocks kept in memory.
+ */
+constexpr int SYNC_SHARE_WINDOW{8};
+
+/**
+ * Indexes further behind than this do not hold back an index sync thread. It
+ * reads its blocks on its own instead of waiting for them to catch up.
+ */
+constexpr int SYNC_FOLLOW_DISTANCE{64};
+
+/** Number of blocks each thread prepares at once when an index syncs on several threads. */
+constexpr size_t SYNC_RANGE_BLOCKS_PER_THREAD{16};
+
 template <typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
 {
@@ -49,6 +73,263 @@ CBlockLocator GetLocator(interfaces::Chain& chain, const uint256& block_hash)
     return locator;
 }
 
+/**
+ * Reads block and undo data for the sync threads of all indexes. Indexes that
+ * catch up with the block chain at the same time share the data, so each
+ * block is read and deserialized once, no matter how many indexes are
+ * enabled, while every index appends it in its own thread.
+ *
+ * A block read is kept while a syncing index up to SYNC_SHARE_WINDOW blocks
+ * behind it has yet to reach it, which bounds the blocks kept to that window
+ * per index. An index that gets further ahead of a slower one waits for it,
+ * so that they keep sharing, unless the slower one is more than
+ * SYNC_FOLLOW_DISTANCE blocks behind. A newly enabled index syncing from
+ * genesis therefore does not hold back an index that is a few blocks behind
+ * the tip; they read their blocks separately. Indexes that sync on several
+ * threads do not register here and read their blocks on their own.
+ */
+class IndexSyncReader
+{
+public:
+    struct BlockData {
+        std::shared_ptr<const CBlock> block;
+        std::shared_ptr<const CBlockUndo> undo;
+    };
+
+    /** Registers a sync thread for as long as it is in scope. */
+    class Registration
+    {
+    public:
+        Registration(IndexSyncReader& reader, const BaseIndex& index, bool need_undo, int height)
+            : m_reader{reader}, m_index{index} { m_reader.Register(m_index, need_undo, height); }
+        ~Registration() { m_reader.Unregister(m_index); }
+
+    private:
+        IndexSyncReader& m_reader;
+        const BaseIndex& m_index;
+    };
+
+    /**
+     * Get the data of a block for an index, waiting for another thread that
+     * is reading it or reading it from disk otherwise. Undo data is only
+     * returned for blocks after genesis and only if need_undo is set.
+     * Returns nullopt if reading failed or the thread was interrupted.
+     */
+    std::optional<BlockData> Read(const BaseIndex& index, const CBlockIndex* pindex, const CThreadInterrupt& interrupt)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct Reader {
+        int height;
+        bool need_undo;
+    };
+
+    struct Entry {
+        BlockData data;
+        /** Whether a thread is reading the block from disk. */
+        bool reading{false};
+    };
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    /** The sync threads and the height of the block each of them last asked for. */
+    std::map<const BaseIndex*, Reader> m_readers GUARDED_BY(m_mutex);
+    std::map<const CBlockIndex*, Entry> m_blocks GUARDED_BY(m_mutex);
+
+    void Register(const BaseIndex& index, bool need_undo, int height) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_readers[&index] = Reader{height, need_undo};
+    }
+
+    void Unregister(const BaseIndex& index) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            m_readers.erase(&index);
+            EvictBlocks();
+        }
+        m_cv.notify_all();
+    }
+
+    /** Whether reader has yet to reach the block at height and is close enough to share it. */
+    static bool MayShare(const Reader& reader, int height)
+    {
+        return reader.height < height && height - reader.height <= SYNC_SHARE_WINDOW;
+    }
+
+    /** Whether a sync thread at height has to wait for a slower one to keep sharing blocks with it. */
+    bool WaitsForSlower(int height) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        return std::any_of(m_readers.begin(), m_readers.end(), [&](const auto& r) {
+            const int behind{height - r.second.height};
+            return behind > SYNC_SHARE_WINDOW && behind <= SYNC_FOLLOW_DISTANCE;
+        });
+    }
+
+    bool IsReading(const CBlockIndex* pindex) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        const auto it{m_blocks.find(pindex)};
+        return it != m_blocks.end() && it->second.reading;
+    }
+
+    /** Drop the blocks no registered sync thread may share anymore. */
+    void EvictBlocks() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        for (auto it{m_blocks.begin()}; it != m_blocks.end();) {
+            const int height{it->first->nHeight};
+            if (!it->second.reading && std::none_of(m_readers.begin(), m_readers.end(), [&](const auto& r) { return MayShare(r.second, height); })) {
+                it = m_blocks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
+std::optional<IndexSyncReader::BlockData> IndexSyncReader::Read(const BaseIndex& index, const CBlockIndex* pindex, const CThreadInterrupt& interrupt)
+{
+    BlockData data;
+    bool need_undo;
+    bool read_undo;
+    {
+        WAIT_LOCK(m_mutex, lock);
+        Reader& reader{m_readers.at(&index)};
+        reader.height = pindex->nHeight;
+        need_undo = reader.need_undo && pindex->nHeight > 0;
+        EvictBlocks();
+        m_cv.notify_all();
+
+        // Wait for the slower indexes close enough to share blocks with, or
+        // for another thread reading this block.
+        while (!interrupt && (WaitsForSlower(pindex->nHeight) || IsReading(pindex))) {
+            m_cv.wait_for(lock, 100ms);
+        }
+        if (interrupt) return std::nullopt;
+
+        Entry& entry{m_blocks[pindex]};
+        if (entry.data.block && (entry.data.undo || !need_undo)) {
+            return BlockData{entry.data.block, need_undo ? entry.data.undo : nullptr};
+        }
+        entry.reading = true;
+        data = entry.data;
+        // Read the undo data if any index that may share the block needs it,
+        // so that it is there for the other indexes too.
+        read_undo = pindex->nHeight > 0 && !data.undo &&
+                    (need_undo || std::any_of(m_readers.begin(), m_readers.end(), [&](const auto& r) {
+                         return r.second.need_undo && MayShare(r.second, pindex->nHeight);
+                     }));
+    }
+
+    bool ok{true};
+    if (!data.block) {
+        auto block{std::make_shared<CBlock>()};
+        ok = ReadBlockFromDisk(*block, pindex, Params().GetConsensus());
+        data.block = std::move(block);
+    }
+    if (ok && read_undo) {
+        auto undo{std::make_shared<CBlockUndo>()};
+        ok = UndoReadFromDisk(*undo, pindex);
+        data.undo = std::move(undo);
+    }
+
+    {
+        LOCK(m_mutex);
+        if (ok) {
+            m_blocks[pindex] = Entry{data};
+        } else {
+            m_blocks.erase(pindex);
+        }
+    }
+    m_cv.notify_all();
+    if (!ok) return std::nullopt;
+    if (!need_undo) data.undo = nullptr;
+    return data;
+}
+
+static IndexSyncReader g_index_sync_reader;
+
+/** Worker threads preparing blocks for an index that syncs on several threads. */
+class BaseIndex::PrepareThreads
+{
+public:
+    explicit PrepareThreads(int worker_threads)
+    {
+        for (int n = 0; n < worker_threads; ++n) {
+            m_threads.emplace_back(&util::TraceThread, strprintf("idxprep.%i", n), [this] {
+                SetSyscallSandboxPolicy(SyscallSandboxPolicy::TX_INDEX);
+                WorkerLoop();
+            });
+        }
+    }
+
+    ~PrepareThreads()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cv.notify_all();
+        for (std::thread& thread : m_threads) thread.join();
+    }
+
+    /** Run the tasks on the worker threads and the calling thread, and wait
+     *  until all of them are done. Returns whether all of them succeeded. */
+    bool Run(std::vector<std::function<bool()>> tasks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            m_tasks = std::move(tasks);
+            m_next_task = 0;
+            m_running = m_tasks.size();
+            m_ok = true;
+        }
+        m_cv.notify_all();
+        WAIT_LOCK(m_mutex, lock);
+        while (RunNextTask(lock)) {}
+        m_done_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_running == 0; });
+        m_tasks.clear();
+        return m_ok;
+    }
+
+private:
+    Mutex m_mutex;
+    /** Signalled when there are tasks or the threads have to stop. */
+    std::condition_variable m_cv;
+    /** Signalled when the last running task is done. */
+    std::condition_variable m_done_cv;
+    std::vector<std::function<bool()>> m_tasks GUARDED_BY(m_mutex);
+    size_t m_next_task GUARDED_BY(m_mutex){0};
+    /** Number of tasks of the current Run that are not done yet. */
+    size_t m_running GUARDED_BY(m_mutex){0};
+    bool m_ok GUARDED_BY(m_mutex){true};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    /** Run the next task, if any, with m_mutex released. */
+    bool RunNextTask(UniqueLock<Mutex>& lock) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        if (m_next_task == m_tasks.size()) return false;
+        auto task{std::move(m_tasks[m_next_task++])};
+        // Skip the remaining tasks once one failed.
+        bool ok{true};
+        if (m_ok) {
+            REVERSE_LOCK(lock);
+            ok = task();
+        }
+        if (!ok) m_ok = false;
+        if (--m_running == 0) m_done_cv.notify_all();
+        return true;
+    }
+
+    void WorkerLoop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_next_task < m_tasks.size(); });
+            if (m_stop) return;
+            RunNextTask(lock);
+        }
+    }
+};
+
 BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
     CDBWrapper{DBParams{
         .path = path,
@@ -159,7 +440,17 @@ void BaseIndex::ThreadSync()
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::TX_INDEX);
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
+        // An index that syncs on several threads reads its blocks on these
+        // threads, other indexes share the blocks they read.
+        const bool parallel{m_sync_threads > 1 && AllowParallelSync()};
+        std::optional<IndexSyncReader::Registration> registration;
+        std::optional<PrepareThreads> prepare_threads;
+        if (parallel) {
+            prepare_threads.emplace(m_sync_threads - 1);
+        } else {
+            registration.emplace(g_index_sync_reader, *this, NeedsUndoData(), pindex ? pindex->nHeight : -1);
+        }
+        std::vector<const CBlockIndex*> range;
 
         std::chrono::steady_clock::time_point last_log_time{0s};
         std::chrono::steady_clock::time_point last_locator_write_time{0s};
@@ -178,9 +469,11 @@ void BaseIndex::ThreadSync()
                 const CBlockIndex* pindex_next = NextSyncBlock(pindex, m_chainstate->m_chain);
                 if (!pindex_next) {
                     SetBestBlockIndex(pindex);
-                    m_synced = true;
+                    // Commit before setting m_synced, so that entries the index
+                    // holds back during sync are written when queries start.
                     // No need to handle errors in Commit. See rationale above.
                     Commit();
+                    m_synced = true;
                     break;
                 }
                 if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
@@ -189,6 +482,17 @@ void BaseIndex::ThreadSync()
                     return;
                 }
                 pindex = pindex_next;
+
+                range.clear();
+                if (parallel) {
+                    range.push_back(pindex);
+                    const size_t range_size{SYNC_RANGE_BLOCKS_PER_THREAD * m_sync_threads};
+                    while (range.size() < range_size) {
+                        const CBlockIndex* next{m_chainstate->m_chain.Next(range.back())};
+                        if (!next) break;
+                        range.push_back(next);
+                    }
+                }
             }
 
             auto current_time{std::chrono::steady_clock::now()};
@@ -205,15 +509,54 @@ void BaseIndex::ThreadSync()
                 Commit();
             }
 
-            CBlock block;
-            interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex);
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            if (!range.empty()) {
+                const bool prepared{PrepareRange(*prepare_threads, range)};
+                // Append the prepared blocks in order, which e.g. chains the
+                // block filter headers.
+                const CBlockIndex* append_failed{nullptr};
+                for (const CBlockIndex* block : range) {
+                    if (!prepared) break;
+                    if (!CustomAppend(kernel::MakeBlockInfo(block))) {
+                        append_failed = block;
+                        break;
+                    }
+                    pindex = block;
+                }
+                // Drop what was prepared for blocks that were not appended.
+                CustomDiscardPrepared();
+                if (!prepared) {
+                    if (m_interrupt) {
+                        pindex = pindex->pprev;
+                        continue;
+                    }
+                    FatalError("%s: Failed to prepare blocks %s to %s for index %s",
+                               __func__, range.front()->GetBlockHash().ToString(),
+                               range.back()->GetBlockHash().ToString(), GetName());
+                    return;
+                }
+                if (append_failed) {
+                    FatalError("%s: Failed to write block %s to index database",
+                               __func__, append_failed->GetBlockHash().ToString());
+                    return;
+                }
+                continue;
+            }
+
+            const auto block_data{g_index_sync_reader.Read(*this, pindex, m_interrupt)};
+            if (!block_data) {
+                if (m_interrupt) {
+                    // The block was not appended, so the index is in sync with its parent.
+                    SetBestBlockIndex(pindex->pprev);
+                    // No need to handle errors in Commit. See rationale above.
+                    Commit();
+                    return;
+                }
                 FatalError("%s: Failed to read block %s from disk",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
-            } else {
-                block_info.data = &block;
             }
+            interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex, block_data->block.get());
+            block_info.undo_data = block_data->undo.get();
             if (!CustomAppend(block_info)) {
                 FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
@@ -229,6 +572,34 @@ void BaseIndex::ThreadSync()
     }
 }
 
+bool BaseIndex::PrepareRange(PrepareThreads& threads, const std::vector<const CBlockIndex*>& blocks)
+{
+    std::vector<std::function<bool()>> tasks;
+    tasks.reserve(blocks.size());
+    for (const CBlockIndex* pindex : blocks) {
+        tasks.emplace_back([this, pindex] { return PrepareBlock(pindex); });
+    }
+    return threads.Run(std::move(tasks)) && !m_interrupt;
+}
+
+bool BaseIndex::PrepareBlock(const CBlockIndex* pindex)
+{
+    if (m_interrupt) return false;
+    CBlock block;
+    CBlockUndo block_undo;
+    interfaces::BlockInfo block_info{kernel::MakeBlockInfo(pindex, &block)};
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        return false;
+    }
+    if (NeedsUndoData() && pindex->nHeight > 0) {
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+        block_info.undo_data = &block_undo;
+    }
+    return CustomPrepareAppend(block_info);
+}
+
 bool BaseIndex::Commit()
 {
     // Don't commit anything if we haven't indexed any block yet
@@ -305,6 +676,15 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
         }
     }
     interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex, block.get());
+    CBlockUndo block_undo;
+    if (NeedsUndoData() && pindex->nHeight > 0) {
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            FatalError("%s: Failed to read undo data of block %s from disk",
+                       __func__, pindex->GetBlockHash().ToString());
+            return;
+        }
+        block_info.undo_data = &block_undo;
+    }
     if (CustomAppend(block_info)) {
         // Setting the best block index is intentionally the last step of this
         // function, so BlockUntilSyncedToCurrentChain callers waiting for the
@@ -326,9 +706,11 @@ void BaseIndex::ChainStateFlushed(const CBlockLocator& locator)
 
     const uint256& locator_tip_hash = locator.vHave.front();
     const CBlockIndex* locator_tip_index;
+    CCoinsViewDB* coins_db;
     {
         LOCK(cs_main);
         locator_tip_index = m_chainstate->m_blockman.LookupBlockIndex(locator_tip_hash);
+        coins_db = &m_chainstate->CoinsDB();
     }
 
     if (!locator_tip_index) {
@@ -351,6 +733,16 @@ void BaseIndex::ChainStateFlushed(const CBlockLocator& locator)
         return;
     }
 
+    // The notification follows the BlockConnected of the locator tip, so the
+    // index is at that block. Its coins may still be written in the
+    // background; committing before them would leave the index ahead of the
+    // coin database after a crash.
+    if (!coins_db->WaitForCommitted(locator_tip_hash)) {
+        LogPrintf("%s: WARNING: Coins of block (hash=%s) were not written; not writing index locator\n",
+                  __func__, locator_tip_hash.ToString());
+        return;
+    }
+
     // No need to handle errors in Commit. If it fails, the error will be already be logged. The
     // best way to recover is to continue, as index cannot be corrupted by a missed commit to disk
     // for an advanced index state.
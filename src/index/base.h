@@ -11,6 +11,7 @@
 #include <validationinterface.h>
 
 #include <string>
+#include <vector>
 
 class CBlock;
 class CBlockIndex;
@@ -19,6 +20,11 @@ namespace interfaces {
 class Chain;
 } // namespace interfaces
 
+/** Maximum number of threads building an index during sync */
+static constexpr int MAX_INDEX_THREADS{16};
+/** -indexthreads default */
+static constexpr int DEFAULT_INDEX_THREADS{1};
+
 struct IndexSummary {
     std::string name;
     bool synced{false};
@@ -69,6 +75,12 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Number of threads preparing blocks during sync, if the index allows it.
+    int m_sync_threads{DEFAULT_INDEX_THREADS};
+
+    /// Worker threads preparing blocks during parallel sync.
+    class PrepareThreads;
+
     /// Read best block locator and check that data needed to sync has not been pruned.
     bool Init();
 
@@ -79,6 +91,15 @@ private:
     /// over and the sync thread exits.
     void ThreadSync();
 
+    /// Read a range of consecutive blocks and call CustomPrepareAppend for
+    /// them, on the sync thread and the worker threads. The
+    /// blocks are read by this index alone, not shared with the other
+    /// indexes that are syncing. Returns false on failure or if interrupted.
+    bool PrepareRange(PrepareThreads& threads, const std::vector<const CBlockIndex*>& blocks);
+
+    /// Read a block and its undo data and call CustomPrepareAppend for it.
+    bool PrepareBlock(const CBlockIndex* pindex);
+
     /// Write the current index state (eg. chain block locator and subclass-specific items) to disk.
     ///
     /// Recommendations for error handling:
@@ -94,6 +115,13 @@ private:
 
     virtual bool AllowPrune() const = 0;
 
+    /// Whether CustomAppend needs the undo data of blocks after genesis.
+    virtual bool NeedsUndoData() const { return false; }
+
+    /// Whether the sync thread may call CustomPrepareAppend for blocks on
+    /// several threads at once.
+    virtual bool AllowParallelSync() const { return false; }
+
 protected:
     std::unique_ptr<interfaces::Chain> m_chain;
     Chainstate* m_chainstate{nullptr};
@@ -109,6 +137,17 @@ protected:
     /// Write update index entries for a newly connected block.
     [[nodiscard]] virtual bool CustomAppend(const interfaces::BlockInfo& block) { return true; }
 
+    /// Do the part of appending a block that does not depend on earlier
+    /// blocks. Only called during sync of indexes that allow parallel sync,
+    /// concurrently for blocks of disjoint height ranges. CustomAppend is
+    /// then called for the prepared blocks in height order, without block
+    /// and undo data.
+    [[nodiscard]] virtual bool CustomPrepareAppend(const interfaces::BlockInfo& block) { return true; }
+
+    /// Drop what CustomPrepareAppend prepared for blocks that were not
+    /// appended. Called after each range of blocks synced in parallel.
+    virtual void CustomDiscardPrepared() {}
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CustomCommit(CDBBatch& batch) { return true; }
@@ -122,6 +161,10 @@ protected:
     /// Get the name of the index for display in logs.
     const std::string& GetName() const LIFETIMEBOUND { return m_name; }
 
+    /// Whether the index is in sync with the main chain and kept in sync by
+    /// BlockConnected notifications rather than the sync thread.
+    bool IsSynced() const { return m_synced; }
+
     /// Update the internal best block index as well as the prune lock.
     void SetBestBlockIndex(const CBlockIndex* block);
 
@@ -139,6 +182,12 @@ public:
 
     void Interrupt();
 
+    /// Set the number of threads building the index while it catches up
+    /// with the block chain. Must be called before Start. An index that
+    /// syncs on several threads reads blocks on its own rather than sharing
+    /// them with the other indexes.
+    void SetSyncThreads(int threads) { m_sync_threads = threads; }
+
     /// Start initializes the sync state and registers the instance as a
     /// ValidationInterface so that it stays in sync with blockchain updates.
     [[nodiscard]] bool Start();
@@ -2,7 +2,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <cstdio>
 #include <map>
+#include <optional>
 
 #include <dbwrapper.h>
 #include <hash.h>
@@ -12,8 +14,6 @@
 #include <util/system.h>
 #include <validation.h>
 
-using node::UndoReadFromDisk;
-
 /* The index database stores three items for each block: the disk location of the encoded filter,
  * its dSHA256 hash, and the header. Those belonging to blocks on the active chain are indexed by
  * height, and those belonging to blocks that have been reorganized out of the active chain are
@@ -42,6 +42,12 @@ constexpr unsigned int FLTR_FILE_CHUNK_SIZE = 0x100000; // 1 MiB
  *  is big enough for a 2,000,000 length block chain, which
  *  we should be enough until ~2047. */
 constexpr size_t CF_HEADERS_CACHE_MAX_SZ{2000};
+/** Maximum total size of the encoded filters in the cache of recently served
+ *  filters. Light clients syncing at the same time mostly ask for the same
+ *  batches of filters. */
+constexpr size_t CF_FILTER_CACHE_MAX_BYTES{32 << 20};
+/** Size of the stdio buffer used when reading a range of filters from a file */
+constexpr size_t FLTR_RANGE_READ_BUFFER_SIZE{1 << 20};
 
 namespace {
 
@@ -152,7 +158,11 @@ bool BlockFilterIndex::ReadFilterFromDisk(const FlatFilePos& pos, const uint256&
     if (filein.IsNull()) {
         return false;
     }
+    return ReadFilter(filein, hash, filter);
+}
 
+bool BlockFilterIndex::ReadFilter(AutoFile& filein, const uint256& hash, BlockFilter& filter) const
+{
     // Check that the hash of the encoded_filter matches the one stored in the db.
     uint256 block_hash;
     std::vector<uint8_t> encoded_filter;
@@ -214,19 +224,43 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
-bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
+static BlockFilter ComputeFilter(BlockFilterType filter_type, const interfaces::BlockInfo& block)
 {
-    CBlockUndo block_undo;
-    uint256 prev_header;
+    // The genesis block spends no outputs and has no undo data.
+    static const CBlockUndo genesis_undo;
+    return BlockFilter(filter_type, *Assert(block.data), block.height > 0 ? *Assert(block.undo_data) : genesis_undo);
+}
 
-    if (block.height > 0) {
-        // pindex variable gives indexing code access to node internals. It
-        // will be removed in upcoming commit
-        const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
+bool BlockFilterIndex::CustomPrepareAppend(const interfaces::BlockInfo& block)
+{
+    BlockFilter filter{ComputeFilter(m_filter_type, block)};
+    LOCK(m_prepared_filters_mutex);
+    m_prepared_filters.insert_or_assign(block.hash, std::move(filter));
+    return true;
+}
+
+void BlockFilterIndex::CustomDiscardPrepared()
+{
+    LOCK(m_prepared_filters_mutex);
+    m_prepared_filters.clear();
+}
+
+bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    BlockFilter filter;
+    if (block.data) {
+        filter = ComputeFilter(m_filter_type, block);
+    } else {
+        LOCK(m_prepared_filters_mutex);
+        auto node{m_prepared_filters.extract(block.hash)};
+        if (node.empty()) {
+            return error("%s: filter of block %s was not prepared", __func__, block.hash.ToString());
         }
+        filter = std::move(node.mapped());
+    }
 
+    uint256 prev_header;
+    if (block.height > 0) {
         std::pair<uint256, DBVal> read_out;
         if (!m_db->Read(DBHeightKey(block.height - 1), read_out)) {
             return false;
@@ -241,8 +275,6 @@ bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
         prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, *Assert(block.data), block_undo);
-
     size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
     if (bytes_written == 0) return false;
 
@@ -288,6 +320,9 @@ static bool CopyHeightIndexToHashIndex(CDBIterator& db_it, CDBBatch& batch,
 
 bool BlockFilterIndex::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
 {
+    // Filters prepared for blocks above the new tip must not be appended later.
+    CustomDiscardPrepared();
+
     CDBBatch batch(*m_db);
     std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
 
@@ -380,6 +415,31 @@ static bool LookupRange(CDBWrapper& db, const std::string& index_name, int start
     return true;
 }
 
+bool BlockFilterIndex::GetCachedFilter(const uint256& block_hash, BlockFilter& filter) const
+{
+    LOCK(m_filter_cache_mutex);
+    const auto it{m_filter_cache_map.find(block_hash)};
+    if (it == m_filter_cache_map.end()) return false;
+    m_filter_cache.splice(m_filter_cache.begin(), m_filter_cache, it->second);
+    filter = it->second->second;
+    return true;
+}
+
+void BlockFilterIndex::CacheFilter(const uint256& block_hash, const BlockFilter& filter) const
+{
+    LOCK(m_filter_cache_mutex);
+    if (m_filter_cache_map.count(block_hash)) return;
+    m_filter_cache.emplace_front(block_hash, filter);
+    m_filter_cache_map.emplace(block_hash, m_filter_cache.begin());
+    m_filter_cache_bytes += filter.GetEncodedFilter().size();
+    while (m_filter_cache_bytes > CF_FILTER_CACHE_MAX_BYTES) {
+        const auto& [oldest_hash, oldest_filter]{m_filter_cache.back()};
+        m_filter_cache_bytes -= oldest_filter.GetEncodedFilter().size();
+        m_filter_cache_map.erase(oldest_hash);
+        m_filter_cache.pop_back();
+    }
+}
+
 bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
 {
     DBVal entry;
@@ -387,7 +447,10 @@ bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter&
         return false;
     }
 
-    return ReadFilterFromDisk(entry.pos, entry.hash, filter_out);
+    if (GetCachedFilter(block_index->GetBlockHash(), filter_out)) return true;
+    if (!ReadFilterFromDisk(entry.pos, entry.hash, filter_out)) return false;
+    CacheFilter(block_index->GetBlockHash(), filter_out);
+    return true;
 }
 
 bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out)
@@ -429,12 +492,45 @@ bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* st
     }
 
     filters_out.resize(entries.size());
-    auto filter_pos_it = filters_out.begin();
-    for (const auto& entry : entries) {
-        if (!ReadFilterFromDisk(entry.pos, entry.hash, *filter_pos_it)) {
+
+    // The cache is keyed by block hash, since blocks may have the same filter.
+    std::vector<uint256> block_hashes(entries.size());
+    const CBlockIndex* block_index{stop_index};
+    for (size_t i{entries.size()}; i-- > 0; block_index = block_index->pprev) {
+        block_hashes[i] = block_index->GetBlockHash();
+    }
+
+    // Filters of consecutive blocks are mostly stored one after the other, so
+    // keep the file open and only seek when the next filter is elsewhere.
+    std::optional<AutoFile> filein;
+    FlatFilePos file_pos;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const DBVal& entry = entries[i];
+        if (GetCachedFilter(block_hashes[i], filters_out[i])) continue;
+
+        if (!filein || file_pos.nFile != entry.pos.nFile) {
+            // Open the file at its start, as the buffer can only be set
+            // before any other operation on the stream.
+            filein.emplace(m_filter_fileseq->Open(FlatFilePos{entry.pos.nFile, 0}, true));
+            if (filein->IsNull()) {
+                return false;
+            }
+            std::setvbuf(filein->Get(), nullptr, _IOFBF, FLTR_RANGE_READ_BUFFER_SIZE);
+            if (entry.pos.nPos && std::fseek(filein->Get(), entry.pos.nPos, SEEK_SET)) {
+                return error("%s: fseek(...) failed", __func__);
+            }
+        } else if (file_pos.nPos != entry.pos.nPos) {
+            if (std::fseek(filein->Get(), entry.pos.nPos, SEEK_SET)) {
+                return error("%s: fseek(...) failed", __func__);
+            }
+        }
+        if (!ReadFilter(*filein, entry.hash, filters_out[i])) {
             return false;
         }
-        ++filter_pos_it;
+        const size_t encoded_size{filters_out[i].GetEncodedFilter().size()};
+        file_pos = entry.pos;
+        file_pos.nPos += uint256::size() + GetSizeOfCompactSize(encoded_size) + encoded_size;
+        CacheFilter(block_hashes[i], filters_out[i]);
     }
 
     return true;
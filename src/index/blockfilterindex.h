@@ -12,6 +12,12 @@
 #include <index/base.h>
 #include <util/hasher.h>
 
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+class AutoFile;
+
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 
 /** Interval between compact filter checkpoints. See BIP 157. */
@@ -34,6 +40,8 @@ private:
     std::unique_ptr<FlatFileSeq> m_filter_fileseq;
 
     bool ReadFilterFromDisk(const FlatFilePos& pos, const uint256& hash, BlockFilter& filter) const;
+    /** Read the filter at the current position of a filter file and check it against its hash. */
+    bool ReadFilter(AutoFile& filein, const uint256& hash, BlockFilter& filter) const;
     size_t WriteFilterToDisk(FlatFilePos& pos, const BlockFilter& filter);
 
     Mutex m_cs_headers_cache;
@@ -42,14 +50,37 @@ private:
 
     bool AllowPrune() const override { return true; }
 
+    bool NeedsUndoData() const override { return true; }
+
+    bool AllowParallelSync() const override { return true; }
+
+    using FilterCacheList = std::list<std::pair<uint256, BlockFilter>>;
+    mutable Mutex m_filter_cache_mutex;
+    /** Recently served filters by block hash, most recently served first. */
+    mutable FilterCacheList m_filter_cache GUARDED_BY(m_filter_cache_mutex);
+    mutable std::unordered_map<uint256, FilterCacheList::iterator, FilterHeaderHasher> m_filter_cache_map GUARDED_BY(m_filter_cache_mutex);
+    /** Total size of the encoded filters in m_filter_cache. */
+    mutable size_t m_filter_cache_bytes GUARDED_BY(m_filter_cache_mutex){0};
+
+    bool GetCachedFilter(const uint256& block_hash, BlockFilter& filter) const EXCLUSIVE_LOCKS_REQUIRED(!m_filter_cache_mutex);
+    void CacheFilter(const uint256& block_hash, const BlockFilter& filter) const EXCLUSIVE_LOCKS_REQUIRED(!m_filter_cache_mutex);
+
+    Mutex m_prepared_filters_mutex;
+    /** Filters computed during sync on several threads, until they are appended in order. */
+    std::unordered_map<uint256, BlockFilter, FilterHeaderHasher> m_prepared_filters GUARDED_BY(m_prepared_filters_mutex);
+
 protected:
     bool CustomInit(const std::optional<interfaces::BlockKey>& block) override;
 
     bool CustomCommit(CDBBatch& batch) override;
 
-    bool CustomAppend(const interfaces::BlockInfo& block) override;
+    bool CustomAppend(const interfaces::BlockInfo& block) override EXCLUSIVE_LOCKS_REQUIRED(!m_prepared_filters_mutex);
+
+    bool CustomPrepareAppend(const interfaces::BlockInfo& block) override EXCLUSIVE_LOCKS_REQUIRED(!m_prepared_filters_mutex);
+
+    void CustomDiscardPrepared() override EXCLUSIVE_LOCKS_REQUIRED(!m_prepared_filters_mutex);
 
-    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override EXCLUSIVE_LOCKS_REQUIRED(!m_prepared_filters_mutex);
 
     BaseIndex::DB& GetDB() const LIFETIMEBOUND override { return *m_db; }
 
@@ -61,14 +92,15 @@ public:
     BlockFilterType GetFilterType() const { return m_filter_type; }
 
     /** Get a single filter by block. */
-    bool LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const;
+    bool LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const EXCLUSIVE_LOCKS_REQUIRED(!m_filter_cache_mutex);
 
     /** Get a single filter header by block. */
     bool LookupFilterHeader(const CBlockIndex* block_index, uint256& header_out) EXCLUSIVE_LOCKS_REQUIRED(!m_cs_headers_cache);
 
-    /** Get a range of filters between two heights on a chain. */
+    /** Get a range of filters between two heights on a chain. Filters that
+     *  are not cached are read in one pass over the filter files. */
     bool LookupFilterRange(int start_height, const CBlockIndex* stop_index,
-                           std::vector<BlockFilter>& filters_out) const;
+                           std::vector<BlockFilter>& filters_out) const EXCLUSIVE_LOCKS_REQUIRED(!m_filter_cache_mutex);
 
     /** Get a range of filter hashes between two heights on a chain. */
     bool LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
@@ -42,6 +42,8 @@ private:
 
     bool AllowPrune() const override { return true; }
 
+    bool NeedsUndoData() const override { return true; }
+
 protected:
     bool CustomInit(const std::optional<interfaces::BlockKey>& block) override;
 
@@ -14,6 +14,9 @@ using node::OpenBlockFile;
 
 constexpr uint8_t DB_TXINDEX{'t'};
 
+/** Number of transaction positions the sync thread collects before writing them. */
+static constexpr size_t SYNC_WRITE_BATCH_SIZE{50000};
+
 std::unique_ptr<TxIndex> g_txindex;
 
 
@@ -29,6 +32,9 @@ public:
 
     /// Write a batch of transaction positions to the DB.
     bool WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos);
+
+    /// Add transaction positions to a batch.
+    void WriteTxs(CDBBatch& batch, const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos);
 };
 
 TxIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
@@ -43,10 +49,15 @@ bool TxIndex::DB::ReadTxPos(const uint256 &txid, CDiskTxPos& pos) const
 bool TxIndex::DB::WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos)
 {
     CDBBatch batch(*this);
+    WriteTxs(batch, v_pos);
+    return WriteBatch(batch);
+}
+
+void TxIndex::DB::WriteTxs(CDBBatch& batch, const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos)
+{
     for (const auto& tuple : v_pos) {
         batch.Write(std::make_pair(DB_TXINDEX, tuple.first), tuple.second);
     }
-    return WriteBatch(batch);
 }
 
 TxIndex::TxIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
@@ -59,8 +70,10 @@ bool TxIndex::CustomAppend(const interfaces::BlockInfo& block)
 {
     // Exclude genesis block transaction because outputs are not spendable.
     if (block.height == 0) return true;
+    // The positions of the transactions in blocks prepared during sync are
+    // collected already.
+    if (!block.data) return true;
 
-    assert(block.data);
     CDiskTxPos pos({block.file_number, block.data_pos}, GetSizeOfCompactSize(block.data->vtx.size()));
     std::vector<std::pair<uint256, CDiskTxPos>> vPos;
     vPos.reserve(block.data->vtx.size());
@@ -68,9 +81,32 @@ bool TxIndex::CustomAppend(const interfaces::BlockInfo& block)
         vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
+    if (IsSynced()) return m_db->WriteTxs(vPos);
+
+    // While catching up, write the positions of many blocks at once.
+    {
+        LOCK(m_pending_mutex);
+        m_pending_pos.insert(m_pending_pos.end(), vPos.begin(), vPos.end());
+        if (m_pending_pos.size() < SYNC_WRITE_BATCH_SIZE) return true;
+        vPos.clear();
+        vPos.swap(m_pending_pos);
+    }
     return m_db->WriteTxs(vPos);
 }
 
+bool TxIndex::CustomPrepareAppend(const interfaces::BlockInfo& block)
+{
+    return CustomAppend(block);
+}
+
+bool TxIndex::CustomCommit(CDBBatch& batch)
+{
+    LOCK(m_pending_mutex);
+    m_db->WriteTxs(batch, m_pending_pos);
+    m_pending_pos.clear();
+    return true;
+}
+
 BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
 
 bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
@@ -6,6 +6,11 @@
 #define MYTHERRA_INDEX_TXINDEX_H
 
 #include <index/base.h>
+#include <index/disktxpos.h>
+#include <sync.h>
+
+#include <utility>
+#include <vector>
 
 static constexpr bool DEFAULT_TXINDEX{false};
 
@@ -22,10 +27,22 @@ protected:
 private:
     const std::unique_ptr<DB> m_db;
 
+    Mutex m_pending_mutex;
+    /// Transaction positions appended by the sync thread and not written yet.
+    /// They are written in large batches, and at the latest with the block
+    /// locator on commit.
+    std::vector<std::pair<uint256, CDiskTxPos>> m_pending_pos GUARDED_BY(m_pending_mutex);
+
     bool AllowPrune() const override { return false; }
 
+    bool AllowParallelSync() const override { return true; }
+
 protected:
-    bool CustomAppend(const interfaces::BlockInfo& block) override;
+    bool CustomAppend(const interfaces::BlockInfo& block) override EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+    bool CustomPrepareAppend(const interfaces::BlockInfo& block) override EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+    bool CustomCommit(CDBBatch& batch) override EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
 
     BaseIndex::DB& GetDB() const override;
 
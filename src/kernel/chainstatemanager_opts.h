@@ -19,6 +19,7 @@ class CChainParams;
 
 static constexpr bool DEFAULT_CHECKPOINTS_ENABLED{true};
 static constexpr auto DEFAULT_MAX_TIP_AGE{24h};
+static constexpr bool DEFAULT_SCHNORR_BATCH_VERIFY{false};
 
 namespace kernel {
 
@@ -39,6 +40,10 @@ struct ChainstateManagerOpts {
     std::optional<uint256> assumed_valid_block{};
     //! If the tip is older than this, the node is considered to be in initial block download.
     std::chrono::seconds max_tip_age{DEFAULT_MAX_TIP_AGE};
+    //! Verify the Schnorr signatures of a block as one batch when connecting it.
+    //! Off by default until batch verification has been reviewed and fuzzed
+    //! against single signature verification.
+    bool schnorr_batch_verify{DEFAULT_SCHNORR_BATCH_VERIFY};
     DBOptions block_tree_db{};
     DBOptions coins_db{};
     CoinsViewOptions coins_view{};
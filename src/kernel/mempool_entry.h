@@ -169,6 +169,8 @@ public:
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
     mutable Epoch::Marker m_epoch_marker; //!< epoch when last touched, useful for graph algorithms
+    mutable uint64_t m_cluster_id{0}; //!< Cluster of the mempool this entry belongs to
+    mutable size_t m_cluster_pos{0}; //!< Index of this entry in the txs of its cluster
 };
 
 #endif // MYTHERRA_KERNEL_MEMPOOL_ENTRY_H
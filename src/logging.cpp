@@ -11,11 +11,20 @@
 
 #include <algorithm>
 #include <array>
+#include <cassert>
+#include <chrono>
 #include <mutex>
 #include <optional>
+#include <utility>
 
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
 constexpr auto MAX_USER_SETABLE_SEVERITY_LEVEL{BCLog::Level::Info};
+//! Maximum number of bytes the log writer thread writes at once
+static constexpr size_t LOG_WRITE_BATCH_BYTES{1 << 18};
+//! Longest the log writer thread sleeps without checking for messages
+static constexpr auto LOG_WRITER_IDLE_WAIT{std::chrono::milliseconds{50}};
+//! Number of messages after which logging threads wake up the log writer thread
+static constexpr uint64_t LOG_WRITER_WAKE_MESSAGES{1024};
 
 BCLog::Logger& LogInstance()
 {
@@ -40,11 +49,66 @@ BCLog::Logger& LogInstance()
 
 bool fLogIPs = DEFAULT_LOGIPS;
 
+/**
+ * Whether the last message logged by this thread ended in a newline, so that
+ * the next one starts a new line and gets the timestamp and other prefixes.
+ * Kept per thread, so that logging threads don't need a lock to decide it.
+ */
+static thread_local bool t_started_new_line{true};
+
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
     return fwrite(str.data(), 1, str.size(), fp);
 }
 
+BCLog::LogRingBuffer::LogRingBuffer(size_t capacity)
+    : m_mask{capacity - 1}, m_slots{std::make_unique<Slot[]>(capacity)}
+{
+    assert(capacity > 0 && (capacity & m_mask) == 0);
+    for (size_t i = 0; i < capacity; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool BCLog::LogRingBuffer::TryPush(std::string& message)
+{
+    uint64_t pos{m_push_pos.load(std::memory_order_relaxed)};
+    Slot* slot;
+    while (true) {
+        slot = &m_slots[pos & m_mask];
+        const uint64_t sequence{slot->sequence.load(std::memory_order_acquire)};
+        if (sequence == pos) {
+            // The slot is free, claim it.
+            if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (sequence < pos) {
+            // The slot still holds the message written one round earlier.
+            return false;
+        } else {
+            // Another thread claimed the slot first.
+            pos = m_push_pos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->message.swap(message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool BCLog::LogRingBuffer::TryPop(std::string& out)
+{
+    Slot& slot{m_slots[m_pop_pos & m_mask]};
+    if (slot.sequence.load(std::memory_order_acquire) != m_pop_pos + 1) return false;
+    out += slot.message;
+    slot.message.clear();
+    slot.sequence.store(m_pop_pos + m_mask + 1, std::memory_order_release);
+    ++m_pop_pos;
+    return true;
+}
+
+bool BCLog::LogRingBuffer::Empty() const
+{
+    return m_slots[m_pop_pos & m_mask].sequence.load(std::memory_order_acquire) != m_pop_pos + 1;
+}
+
 bool BCLog::Logger::StartLogging()
 {
     StdLockGuard scoped_lock(m_cs);
@@ -81,16 +145,66 @@ bool BCLog::Logger::StartLogging()
     }
     if (m_print_to_console) fflush(stdout);
 
+    if (m_async_output && (m_print_to_file || m_print_to_console)) {
+        if (!m_ring) m_ring = std::make_unique<LogRingBuffer>(LOG_RING_BUFFER_SLOTS);
+        m_writer_stop = false;
+        m_writer_thread = std::thread(&Logger::WriterThread, this);
+        m_writer_active = true;
+    }
+
     return true;
 }
 
+void BCLog::Logger::StopWriterThread()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_writer_mutex};
+        if (!m_writer_active) return;
+        // Later messages are written by the logging threads, once the
+        // writer thread has written the queued ones.
+        m_writer_draining = true;
+        m_writer_active = false;
+    }
+    // Wait for threads that saw the writer thread running to queue their
+    // messages. The writer thread keeps making room for them meanwhile.
+    while (m_queueing > 0) std::this_thread::yield();
+    m_writer_stop = true;
+    WakeWriter();
+    m_writer_thread.join();
+
+    {
+        // The writer thread only stops once m_ring is empty, so this is only
+        // needed if it failed to take all messages.
+        StdLockGuard scoped_lock(m_cs);
+        std::string rest;
+        while (m_ring->TryPop(rest)) {}
+        if (!rest.empty()) WriteOutput(rest);
+    }
+    {
+        std::lock_guard<std::mutex> lock{m_writer_mutex};
+        m_writer_draining = false;
+    }
+    m_written_cv.notify_all();
+}
+
+void BCLog::Logger::Flush()
+{
+    if (!m_writer_active) return;
+    const uint64_t pushed{m_ring->Pushed()};
+    WakeWriter();
+    std::unique_lock<std::mutex> lock{m_writer_mutex};
+    m_written_cv.wait(lock, [&] { return m_written >= pushed || !m_writer_active; });
+}
+
 void BCLog::Logger::DisconnectTestLogger()
 {
+    StopWriterThread();
     StdLockGuard scoped_lock(m_cs);
     m_buffering = true;
     if (m_fileout != nullptr) fclose(m_fileout);
     m_fileout = nullptr;
     m_print_callbacks.clear();
+    m_has_print_callbacks = false;
 }
 
 void BCLog::Logger::EnableCategory(BCLog::LogFlags flag)
@@ -341,14 +455,14 @@ std::string BCLog::Logger::LogLevelsString() const
     return Join(std::vector<BCLog::Level>{levels.begin(), levels.end()}, ", ", [this](BCLog::Level level) { return LogLevelToStr(level); });
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string& str)
+std::string BCLog::Logger::LogTimestampStr(const std::string& str, bool started_new_line)
 {
     std::string strStamped;
 
     if (!m_log_timestamps)
         return str;
 
-    if (m_started_new_line) {
+    if (started_new_line) {
         const auto now{SystemClock::now()};
         const auto now_seconds{std::chrono::time_point_cast<std::chrono::seconds>(now)};
         strStamped = FormatISO8601DateTime(TicksSinceEpoch<std::chrono::seconds>(now_seconds));
@@ -391,56 +505,75 @@ namespace BCLog {
 
 void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level)
 {
-    StdLockGuard scoped_lock(m_cs);
     std::string str_prefixed = LogEscapeMessage(str);
 
-    if ((category != LogFlags::NONE || level != Level::None) && m_started_new_line) {
-        std::string s{"["};
-
-        if (category != LogFlags::NONE) {
-            s += LogCategoryToStr(category);
+    if (std::exchange(t_started_new_line, !str.empty() && str[str.size()-1] == '\n')) {
+        std::string prefix;
+        if (m_log_threadnames) {
+            const auto& threadname = util::ThreadGetInternalName();
+            prefix += "[" + (threadname.empty() ? "unknown" : threadname) + "] ";
         }
 
-        if (category != LogFlags::NONE && level != Level::None) {
-            // Only add separator if both flag and level are not NONE
-            s += ":";
+        if (m_log_sourcelocations) {
+            prefix += "[" + RemovePrefix(source_file, "./") + ":" + ToString(source_line) + "] [" + logging_function + "] ";
         }
 
-        if (level != Level::None) {
-            s += LogLevelToStr(level);
-        }
+        if (category != LogFlags::NONE || level != Level::None) {
+            prefix += "[";
 
-        s += "] ";
-        str_prefixed.insert(0, s);
-    }
+            if (category != LogFlags::NONE) {
+                prefix += LogCategoryToStr(category);
+            }
 
-    if (m_log_sourcelocations && m_started_new_line) {
-        str_prefixed.insert(0, "[" + RemovePrefix(source_file, "./") + ":" + ToString(source_line) + "] [" + logging_function + "] ");
-    }
+            if (category != LogFlags::NONE && level != Level::None) {
+                // Only add separator if both flag and level are not NONE
+                prefix += ":";
+            }
+
+            if (level != Level::None) {
+                prefix += LogLevelToStr(level);
+            }
 
-    if (m_log_threadnames && m_started_new_line) {
-        const auto& threadname = util::ThreadGetInternalName();
-        str_prefixed.insert(0, "[" + (threadname.empty() ? "unknown" : threadname) + "] ");
+            prefix += "] ";
+        }
+        str_prefixed.insert(0, LogTimestampStr(prefix, /*started_new_line=*/true));
     }
 
-    str_prefixed = LogTimestampStr(str_prefixed);
+    if (!m_writer_active || m_has_print_callbacks) {
+        WaitForWriterDrained();
+        StdLockGuard scoped_lock(m_cs);
+        if (m_buffering) {
+            // buffer if we haven't started logging yet
+            m_msgs_before_open.push_back(str_prefixed);
+            return;
+        }
 
-    m_started_new_line = !str.empty() && str[str.size()-1] == '\n';
+        for (const auto& cb : m_print_callbacks) {
+            cb(str_prefixed);
+        }
+        if (!m_writer_active) {
+            WriteOutput(str_prefixed);
+            return;
+        }
+    }
 
-    if (m_buffering) {
-        // buffer if we haven't started logging yet
-        m_msgs_before_open.push_back(str_prefixed);
-        return;
+    // Messages of debug categories may be dropped when the writer thread falls
+    // behind, all others wait for it.
+    if (!QueueOutput(str_prefixed, category != LogFlags::NONE && level != Level::Warning && level != Level::Error)) {
+        // The writer thread was stopped in the meantime.
+        WaitForWriterDrained();
+        StdLockGuard scoped_lock(m_cs);
+        WriteOutput(str_prefixed);
     }
+}
 
+void BCLog::Logger::WriteOutput(const std::string& str)
+{
     if (m_print_to_console) {
         // print to console
-        fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
+        fwrite(str.data(), 1, str.size(), stdout);
         fflush(stdout);
     }
-    for (const auto& cb : m_print_callbacks) {
-        cb(str_prefixed);
-    }
     if (m_print_to_file) {
         assert(m_fileout != nullptr);
 
@@ -454,7 +587,91 @@ void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& loggi
                 m_fileout = new_fileout;
             }
         }
-        FileWriteStr(str_prefixed, m_fileout);
+        FileWriteStr(str, m_fileout);
+    }
+}
+
+bool BCLog::Logger::QueueOutput(std::string& str, bool may_drop)
+{
+    // Count this thread before checking m_writer_active, StopWriterThread()
+    // waits for it to be done.
+    ++m_queueing;
+    if (!m_writer_active) {
+        --m_queueing;
+        return false;
+    }
+    while (true) {
+        const uint64_t written{m_written};
+        if (m_ring->TryPush(str)) break;
+        if (may_drop) {
+            ++m_dropped_messages;
+            break;
+        }
+        // Only this thread waits for the writer thread to make room, other
+        // threads go on queueing or dropping their messages.
+        WakeWriter();
+        std::unique_lock<std::mutex> lock{m_writer_mutex};
+        m_written_cv.wait(lock, [&] { return m_written != written; });
+    }
+    --m_queueing;
+    // The writer thread wakes up by itself within LOG_WRITER_IDLE_WAIT, only
+    // wake it up early when messages pile up, so that it writes them in batches.
+    if (m_writer_sleeping && m_ring->Pushed() % LOG_WRITER_WAKE_MESSAGES == 0) WakeWriter();
+    return true;
+}
+
+void BCLog::Logger::WaitForWriterDrained()
+{
+    if (!m_writer_draining) return;
+    std::unique_lock<std::mutex> lock{m_writer_mutex};
+    m_written_cv.wait(lock, [&] { return !m_writer_draining; });
+}
+
+void BCLog::Logger::WakeWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_writer_mutex};
+    }
+    m_writer_cv.notify_one();
+}
+
+void BCLog::Logger::WriterThread()
+{
+    util::ThreadRename("logger");
+    std::string batch;
+    uint64_t reported_dropped{m_dropped_messages};
+    while (true) {
+        batch.clear();
+        uint64_t popped{0};
+        while (batch.size() < LOG_WRITE_BATCH_BYTES && m_ring->TryPop(batch)) {
+            ++popped;
+        }
+        const uint64_t dropped{m_dropped_messages};
+        if (dropped != reported_dropped) {
+            batch += LogTimestampStr(strprintf("[logging] %d debug messages were dropped because the log could not be written fast enough\n", dropped - reported_dropped), true);
+            reported_dropped = dropped;
+        }
+
+        if (!batch.empty()) {
+            {
+                StdLockGuard scoped_lock(m_cs);
+                WriteOutput(batch);
+            }
+            m_written += popped;
+            {
+                std::lock_guard<std::mutex> lock{m_writer_mutex};
+            }
+            m_written_cv.notify_all();
+            continue;
+        }
+        if (m_writer_stop) break;
+
+        std::unique_lock<std::mutex> lock{m_writer_mutex};
+        m_writer_sleeping = true;
+        if (m_ring->Empty() && !m_writer_stop) {
+            m_writer_cv.wait_for(lock, LOG_WRITER_IDLE_WAIT);
+        }
+        m_writer_sleeping = false;
     }
 }
 
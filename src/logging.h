@@ -12,11 +12,15 @@
 #include <util/string.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -25,6 +29,7 @@ static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
 static const bool DEFAULT_LOGSOURCELOCATIONS = false;
+static const bool DEFAULT_LOGASYNC = false;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -80,6 +85,42 @@ namespace BCLog {
     };
     constexpr auto DEFAULT_LOG_LEVEL{Level::Debug};
 
+    //! Number of messages that can wait for the log writer thread
+    static constexpr size_t LOG_RING_BUFFER_SLOTS{1 << 14};
+
+    /**
+     * Bounded queue of log messages. Any number of threads add messages
+     * without taking a lock, a single thread at a time takes them out in
+     * the order they were added.
+     */
+    class LogRingBuffer
+    {
+    public:
+        //! capacity must be a power of two
+        explicit LogRingBuffer(size_t capacity);
+
+        //! Move message into the buffer, unless it is full.
+        bool TryPush(std::string& message);
+        //! Append the oldest message to out and remove it, unless there is none.
+        bool TryPop(std::string& out);
+        //! Whether there is no message that TryPop() could take.
+        bool Empty() const;
+        //! Number of messages added so far.
+        uint64_t Pushed() const { return m_push_pos.load(); }
+
+    private:
+        struct Slot {
+            //! Position the slot can be written at, or that position + 1 once
+            //! it holds the message written there.
+            std::atomic<uint64_t> sequence;
+            std::string message;
+        };
+        const uint64_t m_mask;
+        const std::unique_ptr<Slot[]> m_slots;
+        alignas(64) std::atomic<uint64_t> m_push_pos{0};
+        alignas(64) uint64_t m_pop_pos{0};
+    };
+
     class Logger
     {
     private:
@@ -89,13 +130,6 @@ namespace BCLog {
         std::list<std::string> m_msgs_before_open GUARDED_BY(m_cs);
         bool m_buffering GUARDED_BY(m_cs) = true; //!< Buffer messages before logging can be started.
 
-        /**
-         * m_started_new_line is a state variable that will suppress printing of
-         * the timestamp when multiple calls are made that don't end in a
-         * newline.
-         */
-        std::atomic_bool m_started_new_line{true};
-
         //! Category-specific log level. Overrides `m_log_level`.
         std::unordered_map<LogFlags, Level> m_category_log_levels GUARDED_BY(m_cs);
 
@@ -106,10 +140,41 @@ namespace BCLog {
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
-        std::string LogTimestampStr(const std::string& str);
+        std::string LogTimestampStr(const std::string& str, bool started_new_line);
 
         /** Slots that connect to the print signal */
         std::list<std::function<void(const std::string&)>> m_print_callbacks GUARDED_BY(m_cs) {};
+        std::atomic_bool m_has_print_callbacks{false};
+
+        /**
+         * With m_async_output, messages for the console and the log file are
+         * queued in m_ring and written in batches by m_writer_thread, which is
+         * only started and stopped by StartLogging() and StopWriterThread().
+         * Logging threads count themselves in m_queueing before they check
+         * m_writer_active, so that StopWriterThread() can wait for the
+         * messages that are still being queued. Until the writer thread has
+         * written them, m_writer_draining holds back the logging threads that
+         * write their messages themselves.
+         */
+        std::unique_ptr<LogRingBuffer> m_ring;
+        std::thread m_writer_thread;
+        std::atomic_bool m_writer_active{false};
+        std::atomic<int> m_queueing{0};
+        std::atomic_bool m_writer_draining{false};
+        std::atomic_bool m_writer_stop{false};
+        std::atomic_bool m_writer_sleeping{false};
+        std::mutex m_writer_mutex;
+        std::condition_variable m_writer_cv;
+        std::condition_variable m_written_cv;
+        //! Number of messages taken from m_ring and written
+        std::atomic<uint64_t> m_written{0};
+        std::atomic<uint64_t> m_dropped_messages{0};
+
+        void WriteOutput(const std::string& str) EXCLUSIVE_LOCKS_REQUIRED(m_cs);
+        bool QueueOutput(std::string& str, bool may_drop);
+        void WaitForWriterDrained();
+        void WakeWriter();
+        void WriterThread();
 
     public:
         bool m_print_to_console = false;
@@ -119,16 +184,22 @@ namespace BCLog {
         bool m_log_time_micros = DEFAULT_LOGTIMEMICROS;
         bool m_log_threadnames = DEFAULT_LOGTHREADNAMES;
         bool m_log_sourcelocations = DEFAULT_LOGSOURCELOCATIONS;
+        bool m_async_output = DEFAULT_LOGASYNC;
 
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
 
-        /** Send a string to the log output */
+        /**
+         * Send a string to the log output. A string that does not end in a
+         * newline is continued by the next one that the same thread logs,
+         * which is not prefixed with a timestamp.
+         */
         void LogPrintStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level);
 
         /** Returns whether logs will be written to any output */
         bool Enabled() const
         {
+            if (m_writer_active) return true;
             StdLockGuard scoped_lock(m_cs);
             return m_buffering || m_print_to_console || m_print_to_file || !m_print_callbacks.empty();
         }
@@ -138,6 +209,7 @@ namespace BCLog {
         {
             StdLockGuard scoped_lock(m_cs);
             m_print_callbacks.push_back(std::move(fun));
+            m_has_print_callbacks = true;
             return --m_print_callbacks.end();
         }
 
@@ -146,10 +218,17 @@ namespace BCLog {
         {
             StdLockGuard scoped_lock(m_cs);
             m_print_callbacks.erase(it);
+            m_has_print_callbacks = !m_print_callbacks.empty();
         }
 
         /** Start logging (and flush all buffered messages) */
         bool StartLogging();
+        /** Write all queued messages and stop the writer thread. Later messages are written by the logging thread. */
+        void StopWriterThread();
+        /** Wait until the messages logged so far have been written */
+        void Flush();
+        /** Number of debug messages dropped because the writer thread fell behind */
+        uint64_t DroppedMessages() const { return m_dropped_messages.load(); }
         /** Only for testing */
         void DisconnectTestLogger();
 
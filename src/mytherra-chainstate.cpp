@@ -77,7 +77,7 @@ int main(int argc, char* argv[])
     // Gather some entropy once per minute.
     scheduler.scheduleEvery(RandAddPeriodic, std::chrono::minutes{1});
 
-    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+    GetMainSignals().StartBackgroundThreads(DEFAULT_NOTIFICATION_THREADS);
 
 
     // SETUP: Chainstate
@@ -249,8 +249,10 @@ epilogue:
     // Without this precise shutdown sequence, there will be a lot of nullptr
     // dereferencing and UB.
     scheduler.stop();
+    GetMainSignals().StopBackgroundThreads();
     if (chainman.m_load_block.joinable()) chainman.m_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopCoinsPrefetchWorkerThreads();
 
     GetMainSignals().FlushBackgroundCallbacks();
     {
@@ -262,5 +264,5 @@ epilogue:
             }
         }
     }
-    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    GetMainSignals().UnregisterBackgroundThreads();
 }
@@ -820,10 +820,10 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
 void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) const
 {
     // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
+    uint256 hash = Hash(msg.Payload());
 
     // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
@@ -837,7 +837,7 @@ size_t CConnman::SocketSendData(CNode& node) const
     size_t nSentSize = 0;
 
     while (it != node.vSendMsg.end()) {
-        const auto& data = *it;
+        const auto data{it->Payload()};
         assert(data.size() > node.nSendOffset);
         int nBytes = 0;
         {
@@ -1067,6 +1067,7 @@ void CConnman::CreateNodeFromAcceptedSocket(std::unique_ptr<Sock>&& sock,
         LOCK(m_nodes_mutex);
         m_nodes.push_back(pnode);
     }
+    SockEventsChanged(*pnode);
 
     // We received a new connection, harvest entropy from the time (and our peer count)
     RandAddEvent((uint32_t)id);
@@ -1136,6 +1137,13 @@ void CConnman::DisconnectNodes()
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
 
+                // stop waiting for events on the socket
+                if (pnode->m_wait_sock) {
+                    if (m_sock_wait_set) m_sock_wait_set->Remove(pnode->m_wait_sock);
+                    pnode->m_wait_sock.reset();
+                }
+                m_sock_wait_busy.erase(pnode);
+
                 // close socket and cleanup
                 pnode->CloseSocketDisconnect();
 
@@ -1212,6 +1220,36 @@ bool CConnman::InactivityCheck(const CNode& node) const
     return false;
 }
 
+/** The events to wait for on the socket of a node. */
+static Sock::Event RequestedSockEvents(CNode& node)
+{
+    // Implement the following logic:
+    // * If there is data to send, select() for sending data. As this only
+    //   happens when optimistic write failed, we choose to first drain the
+    //   write buffer in this case before receiving more. This avoids
+    //   needlessly queueing received data, if the remote peer is not themselves
+    //   receiving data. This means properly utilizing TCP flow control signalling.
+    // * Otherwise, if there is space left in the receive buffer, select() for
+    //   receiving data.
+    // * Hand off all complete messages to the processor, to be handled without
+    //   blocking here.
+
+    bool select_recv = !node.fPauseRecv;
+    bool select_send;
+    {
+        LOCK(node.cs_vSend);
+        select_send = !node.vSendMsg.empty();
+    }
+
+    Sock::Event requested{0};
+    if (select_send) {
+        requested = Sock::SEND;
+    } else if (select_recv) {
+        requested = Sock::RECV;
+    }
+    return requested;
+}
+
 Sock::EventsPerSock CConnman::GenerateWaitSockets(Span<CNode* const> nodes)
 {
     Sock::EventsPerSock events_per_sock;
@@ -1221,42 +1259,81 @@ Sock::EventsPerSock CConnman::GenerateWaitSockets(Span<CNode* const> nodes)
     }
 
     for (CNode* pnode : nodes) {
-        // Implement the following logic:
-        // * If there is data to send, select() for sending data. As this only
-        //   happens when optimistic write failed, we choose to first drain the
-        //   write buffer in this case before receiving more. This avoids
-        //   needlessly queueing received data, if the remote peer is not themselves
-        //   receiving data. This means properly utilizing TCP flow control signalling.
-        // * Otherwise, if there is space left in the receive buffer, select() for
-        //   receiving data.
-        // * Hand off all complete messages to the processor, to be handled without
-        //   blocking here.
-
-        bool select_recv = !pnode->fPauseRecv;
-        bool select_send;
-        {
-            LOCK(pnode->cs_vSend);
-            select_send = !pnode->vSendMsg.empty();
-        }
+        const Sock::Event requested{RequestedSockEvents(*pnode)};
 
         LOCK(pnode->m_sock_mutex);
         if (!pnode->m_sock) {
             continue;
         }
 
-        Sock::Event requested{0};
-        if (select_send) {
-            requested = Sock::SEND;
-        } else if (select_recv) {
-            requested = Sock::RECV;
-        }
-
         events_per_sock.emplace(pnode->m_sock, Sock::Events{requested});
     }
 
     return events_per_sock;
 }
 
+void CConnman::SockEventsChanged(CNode& node)
+{
+    if (!node.m_wait_changed.exchange(true)) {
+        LOCK(m_sock_wait_mutex);
+        m_sock_wait_changed.push_back(&node);
+    }
+}
+
+bool CConnman::UpdateSockWaitSet()
+{
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        if (!m_sock_wait_set->Set(hListenSocket.sock, Sock::RECV)) {
+            LogPrintf("Cannot wait on listening socket with epoll, falling back to poll\n");
+            m_sock_wait_set.reset();
+            return false;
+        }
+    }
+
+    std::vector<CNode*> nodes;
+    {
+        LOCK(m_sock_wait_mutex);
+        nodes.swap(m_sock_wait_changed);
+        for (CNode* pnode : nodes) {
+            pnode->m_wait_changed = false;
+        }
+    }
+    nodes.insert(nodes.end(), m_sock_wait_busy.begin(), m_sock_wait_busy.end());
+
+    for (CNode* pnode : nodes) {
+        // Disconnected nodes have been removed from the set already.
+        if (pnode->fDisconnect) {
+            continue;
+        }
+
+        const Sock::Event requested{RequestedSockEvents(*pnode)};
+
+        {
+            LOCK(pnode->m_sock_mutex);
+            if (!pnode->m_sock) {
+                continue;
+            }
+            if (!pnode->m_wait_sock) {
+                pnode->m_wait_sock = pnode->m_sock;
+            }
+        }
+
+        if (!m_sock_wait_set->Set(pnode->m_wait_sock, requested)) {
+            LogPrintf("Cannot wait on socket of peer=%d with epoll, falling back to poll\n", pnode->GetId());
+            m_sock_wait_set.reset();
+            return false;
+        }
+
+        if (requested == Sock::RECV) {
+            m_sock_wait_busy.erase(pnode);
+        } else {
+            m_sock_wait_busy.insert(pnode);
+        }
+    }
+
+    return true;
+}
+
 void CConnman::SocketHandler()
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
@@ -1272,9 +1349,15 @@ void CConnman::SocketHandler()
         // listening sockets in one call ("readiness" as in poll(2) or
         // select(2)). If none are ready, wait for a short while and return
         // empty sets.
-        events_per_sock = GenerateWaitSockets(snap.Nodes());
-        if (events_per_sock.empty() || !events_per_sock.begin()->first->WaitMany(timeout, events_per_sock)) {
-            interruptNet.sleep_for(timeout);
+        if (m_sock_wait_set && UpdateSockWaitSet()) {
+            if (!m_sock_wait_set->Wait(timeout, events_per_sock)) {
+                interruptNet.sleep_for(timeout);
+            }
+        } else {
+            events_per_sock = GenerateWaitSockets(snap.Nodes());
+            if (events_per_sock.empty() || !events_per_sock.begin()->first->WaitMany(timeout, events_per_sock)) {
+                interruptNet.sleep_for(timeout);
+            }
         }
 
         // Service (send/receive) each of the already connected nodes.
@@ -1364,6 +1447,9 @@ void CConnman::SocketHandlerConnected(const std::vector<CNode*>& nodes,
             if (bytes_sent) RecordBytesSent(bytes_sent);
         }
 
+        // Receiving may have been paused, or sending completed.
+        if (recvSet || sendSet || errorSet) SockEventsChanged(*pnode);
+
         if (InactivityCheck(*pnode)) pnode->fDisconnect = true;
     }
 }
@@ -2039,6 +2125,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         LOCK(m_nodes_mutex);
         m_nodes.push_back(pnode);
     }
+    SockEventsChanged(*pnode);
 }
 
 Mutex NetEventsInterface::g_msgproc_mutex;
@@ -2380,6 +2467,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 
     // Send and receive from sockets, accept connections
+    m_sock_wait_set = SockWaitSet::Create();
     threadSocketHandler = std::thread(&util::TraceThread, "net", [this] { ThreadSocketHandler(); });
 
     if (!gArgs.GetBoolArg("-dnsseed", DEFAULT_DNSSEED))
@@ -2502,6 +2590,7 @@ void CConnman::StopNodes()
         DeleteNode(pnode);
     }
     m_nodes_disconnected.clear();
+    m_sock_wait_set.reset();
     vhListenSocket.clear();
     semOutbound.reset();
     semAddnode.reset();
@@ -2510,6 +2599,11 @@ void CConnman::StopNodes()
 void CConnman::DeleteNode(CNode* pnode)
 {
     assert(pnode);
+    m_sock_wait_busy.erase(pnode);
+    {
+        LOCK(m_sock_wait_mutex);
+        m_sock_wait_changed.erase(std::remove(m_sock_wait_changed.begin(), m_sock_wait_changed.end(), pnode), m_sock_wait_changed.end());
+    }
     m_msgproc->FinalizeNode(*pnode);
     delete pnode;
 }
@@ -2853,10 +2947,10 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.Payload().size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", msg.m_type, nMessageSize, pnode->GetId());
     if (gArgs.GetBoolArg("-capturemessages", false)) {
-        CaptureMessage(pnode->addr, msg.m_type, msg.data, /*is_incoming=*/false);
+        CaptureMessage(pnode->addr, msg.m_type, msg.Payload(), /*is_incoming=*/false);
     }
 
     TRACE6(net, outbound_message,
@@ -2864,16 +2958,17 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->m_addr_name.c_str(),
         pnode->ConnectionTypeAsString().c_str(),
         msg.m_type.c_str(),
-        msg.data.size(),
-        msg.data.data()
+        msg.Payload().size(),
+        msg.Payload().data()
     );
 
     // make sure we use the appropriate network transport format
-    std::vector<unsigned char> serializedHeader;
-    pnode->m_serializer->prepareForTransport(msg, serializedHeader);
-    size_t nTotalSize = nMessageSize + serializedHeader.size();
+    CSerializedNetMsg serializedHeader;
+    pnode->m_serializer->prepareForTransport(msg, serializedHeader.data);
+    size_t nTotalSize = nMessageSize + serializedHeader.data.size();
 
     size_t nBytesSent = 0;
+    bool wait_send{false};
     {
         LOCK(pnode->cs_vSend);
         bool optimisticSend(pnode->vSendMsg.empty());
@@ -2884,11 +2979,14 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize) pnode->fPauseSend = true;
         pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize) pnode->vSendMsg.push_back(std::move(msg.data));
+        if (nMessageSize) pnode->vSendMsg.push_back(std::move(msg));
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend) nBytesSent = SocketSendData(*pnode);
+        // Otherwise the socket handler has to wait until it can send the rest.
+        if (optimisticSend && !pnode->vSendMsg.empty()) wait_send = true;
     }
+    if (wait_send) SockEventsChanged(*pnode);
     if (nBytesSent) RecordBytesSent(nBytesSent);
 }
 
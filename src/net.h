@@ -117,11 +117,24 @@ struct CSerializedNetMsg {
         CSerializedNetMsg copy;
         copy.data = data;
         copy.m_type = m_type;
+        copy.m_shared_owner = m_shared_owner;
+        copy.m_shared_data = m_shared_data;
         return copy;
     }
 
+    /** The serialized payload: data, or the shared bytes if the message has them. */
+    Span<const unsigned char> Payload() const { return m_shared_owner ? m_shared_data : Span<const unsigned char>{data}; }
+
     std::vector<unsigned char> data;
     std::string m_type;
+    /**
+     * Used instead of data for a payload that is shared rather than owned by
+     * the message, such as a block in a memory mapped block file, so that it
+     * can be queued for sending to any number of peers without copying it.
+     * m_shared_data stays valid for as long as m_shared_owner is alive.
+     */
+    std::shared_ptr<const void> m_shared_owner;
+    Span<const unsigned char> m_shared_data;
 };
 
 /**
@@ -372,12 +385,23 @@ public:
      */
     std::shared_ptr<Sock> m_sock GUARDED_BY(m_sock_mutex);
 
+    /**
+     * `m_sock` as registered with `CConnman::m_sock_wait_set`. Kept separately
+     * because `m_sock` may be closed by any thread, and the socket has to stay
+     * registered (and open) until it is removed from the set on disconnect.
+     */
+    std::shared_ptr<const Sock> m_wait_sock; // Used only by SocketHandler thread
+
+    /** Whether the node is queued in `CConnman::m_sock_wait_changed`. */
+    std::atomic_bool m_wait_changed{false};
+
     /** Total size of all vSendMsg entries */
     size_t nSendSize GUARDED_BY(cs_vSend){0};
     /** Offset inside the first vSendMsg already sent */
     size_t nSendOffset GUARDED_BY(cs_vSend){0};
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    /** Queued messages. The header and the payload of a message are separate entries. */
+    std::deque<CSerializedNetMsg> vSendMsg GUARDED_BY(cs_vSend);
     Mutex cs_vSend;
     Mutex m_sock_mutex;
     Mutex cs_vRecv;
@@ -945,6 +969,24 @@ private:
      */
     Sock::EventsPerSock GenerateWaitSockets(Span<CNode* const> nodes);
 
+    /**
+     * Queue a node for `UpdateSockWaitSet()`, because the events to wait for on
+     * its socket may have changed (or it has not been registered yet).
+     */
+    void SockEventsChanged(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(!m_sock_wait_mutex);
+
+    /**
+     * Register new sockets with `m_sock_wait_set` and update the events to wait
+     * for on the others, like `GenerateWaitSockets()` selects them. Only the
+     * nodes queued by `SockEventsChanged()` and those in `m_sock_wait_busy` are
+     * looked at, so the cost does not grow with the number of idle peers.
+     * Sockets are removed from the set again when their node is disconnected.
+     * If a socket can not be registered, the set is discarded and the socket
+     * handler falls back to `GenerateWaitSockets()` and `Sock::WaitMany()`.
+     * @return false if the set has been discarded
+     */
+    bool UpdateSockWaitSet() EXCLUSIVE_LOCKS_REQUIRED(!m_sock_wait_mutex);
+
     /**
      * Check connected and listening sockets for IO readiness and process them accordingly.
      */
@@ -1031,6 +1073,26 @@ private:
     unsigned int nReceiveFloodSize{0};
 
     std::vector<ListenSocket> vhListenSocket;
+
+    /**
+     * Persistent set of the listening and connected sockets, so that the socket
+     * handler only has to look at the sockets that are ready instead of polling
+     * all of them on every iteration. Null if not supported on this platform.
+     * Used only by the SocketHandler thread while it runs.
+     */
+    std::unique_ptr<SockWaitSet> m_sock_wait_set;
+
+    Mutex m_sock_wait_mutex;
+    /** Nodes to update in `m_sock_wait_set`, see `SockEventsChanged()`. */
+    std::vector<CNode*> m_sock_wait_changed GUARDED_BY(m_sock_wait_mutex);
+
+    /**
+     * Nodes registered in `m_sock_wait_set` for other events than `Sock::RECV`,
+     * i.e. with data to send or with receiving paused. Those go back to receiving
+     * without notice (when the send buffer or the receive queue is drained), so
+     * they are updated on every iteration. Used only by the SocketHandler thread.
+     */
+    std::unordered_set<CNode*> m_sock_wait_busy;
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
     AddrMan& addrman;
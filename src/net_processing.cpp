@@ -39,18 +39,26 @@
 #include <txrequest.h>
 #include <util/check.h> // For NDEBUG compile time check
 #include <util/strencodings.h>
+#include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/trace.h>
 #include <validation.h>
 
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <future>
 #include <memory>
 #include <optional>
+#include <thread>
 #include <typeinfo>
+#include <vector>
 
+using node::RawBlock;
 using node::ReadBlockFromDisk;
 using node::ReadRawBlockFromDisk;
 
@@ -376,6 +384,13 @@ struct Peer {
     /** Work queue of items requested by this peer **/
     std::deque<CInv> m_getdata_requests GUARDED_BY(m_getdata_requests_mutex);
 
+    /**
+     * Whether block data requested by this peer is being sent by a message
+     * worker thread. Until it is done, no other messages from or to the peer
+     * are processed, so that the peer gets the responses in order.
+     */
+    std::atomic<bool> m_serving_block_data{false};
+
     /** Time of the last getheaders message to this peer */
     NodeClock::time_point m_last_getheaders_timestamp GUARDED_BY(NetEventsInterface::g_msgproc_mutex){};
 
@@ -493,6 +508,7 @@ public:
     PeerManagerImpl(CConnman& connman, AddrMan& addrman,
                     BanMan* banman, ChainstateManager& chainman,
                     CTxMemPool& pool, bool ignore_incoming_txs);
+    ~PeerManagerImpl() EXCLUSIVE_LOCKS_REQUIRED(!m_msg_workers_mutex);
 
     /** Overridden from CValidationInterface. */
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected) override
@@ -508,9 +524,9 @@ public:
 
     /** Implement NetEventsInterface */
     void InitializeNode(CNode& node, ServiceFlags our_services) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
-    void FinalizeNode(const CNode& node) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_headers_presync_mutex);
+    void FinalizeNode(const CNode& node) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_headers_presync_mutex, !m_msg_workers_mutex);
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, !m_msg_workers_mutex, g_msgproc_mutex);
     bool SendMessages(CNode* pto) override
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, g_msgproc_mutex);
 
@@ -525,9 +541,10 @@ public:
     void RelayTransaction(const uint256& txid, const uint256& wtxid) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void SetBestHeight(int height) override { m_best_height = height; };
     void UnitTestMisbehaving(NodeId peer_id, int howmuch) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex) { Misbehaving(*Assert(GetPeerRef(peer_id)), howmuch, ""); };
+    void WaitForBlockDataServed(NodeId peer_id) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_msg_workers_mutex);
     void ProcessMessage(CNode& pfrom, const std::string& msg_type, CDataStream& vRecv,
                         const std::chrono::microseconds time_received, const std::atomic<bool>& interruptMsgProc) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, !m_msg_workers_mutex, g_msgproc_mutex);
     void UpdateLastBlockAnnounceTime(NodeId node, int64_t time_in_seconds) override;
 
 private:
@@ -726,6 +743,34 @@ private:
     /** Whether this node is running in -blocksonly mode */
     const bool m_ignore_incoming_txs;
 
+    /**
+     * Message worker threads, which read requested blocks from disk and send
+     * them to the peers in parallel, while the message handler thread goes on
+     * with the messages of other peers. See ServeBlockData().
+     *
+     * Compact blocks received from peers are reconstructed on the message
+     * handler thread. Reconstruction fills in the partial block that is kept
+     * with the in-flight request under cs_main, from the mempool and from
+     * vExtraTxnForCompact, which is guarded by g_msgproc_mutex. The block then
+     * goes to ProcessNewBlock(), which takes cs_main as well. A worker thread
+     * would have to take the same locks, so the handoff would gain nothing.
+     */
+    std::vector<std::thread> m_msg_workers;
+    Mutex m_msg_workers_mutex;
+    /** Signaled when a job is queued, a job is done, or the workers are stopped. */
+    std::condition_variable m_msg_workers_cv;
+    std::deque<std::function<void()>> m_msg_jobs GUARDED_BY(m_msg_workers_mutex);
+    bool m_msg_workers_interrupt GUARDED_BY(m_msg_workers_mutex){false};
+
+    void ThreadMessageWorker() EXCLUSIVE_LOCKS_REQUIRED(!m_msg_workers_mutex);
+
+    /**
+     * Run `send`, which sends block data requested by the peer, on a message
+     * worker thread, or right away if there are none. The peer's messages are
+     * not processed until `send` is done, see Peer::m_serving_block_data.
+     */
+    void ServeBlockData(CNode& node, Peer& peer, std::function<void()>&& send) EXCLUSIVE_LOCKS_REQUIRED(!m_msg_workers_mutex);
+
     bool RejectIncomingTxs(const CNode& peer) const;
 
     /** Whether we've completed initial sync yet, for determining when to turn
@@ -911,7 +956,7 @@ private:
         EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex);
 
     void ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic<bool>& interruptMsgProc)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, peer.m_getdata_requests_mutex, NetEventsInterface::g_msgproc_mutex)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, !m_msg_workers_mutex, peer.m_getdata_requests_mutex, NetEventsInterface::g_msgproc_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
     /** Process a new block. Perform any post-processing housekeeping */
@@ -964,7 +1009,22 @@ private:
     bool BlockRequestAllowed(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AlreadyHaveBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, !m_msg_workers_mutex);
+
+    /**
+     * Send a block requested by a getdata message, after ProcessGetBlockData()
+     * has checked the request. Does not need cs_main.
+     *
+     * @param[in] block_pos           Where the block is stored on disk.
+     * @param[in] recent_block        The block, if it is at hand already, otherwise it is read from disk.
+     * @param[in] recent_compact_block A compact block for it, if at hand already.
+     * @param[in] allow_compact       Whether a compact block may be sent in response to MSG_CMPCT_BLOCK.
+     * @param[in] tip_hash            The active tip, to announce if this is the peer's continuation block.
+     */
+    void SendBlockData(CNode& pfrom, Peer& peer, const CInv& inv, const FlatFilePos& block_pos,
+                       const std::shared_ptr<const CBlock>& recent_block,
+                       const std::shared_ptr<const CBlockHeaderAndShortTxIDs>& recent_compact_block,
+                       bool allow_compact, const uint256& tip_hash);
 
     /**
      * Validation logic for compact filters request handling.
@@ -1490,9 +1550,19 @@ void PeerManagerImpl::ReattemptInitialBroadcast(CScheduler& scheduler)
     scheduler.scheduleFromNow([&] { ReattemptInitialBroadcast(scheduler); }, delta);
 }
 
+void PeerManagerImpl::WaitForBlockDataServed(NodeId peer_id)
+{
+    if (PeerRef peer = GetPeerRef(peer_id)) {
+        WAIT_LOCK(m_msg_workers_mutex, lock);
+        m_msg_workers_cv.wait(lock, [&] { return !peer->m_serving_block_data; });
+    }
+}
+
 void PeerManagerImpl::FinalizeNode(const CNode& node)
 {
     NodeId nodeid = node.GetId();
+    // Wait for a message worker thread that is still sending block data to the peer.
+    WaitForBlockDataServed(nodeid);
     int misbehavior{0};
     {
     LOCK(cs_main);
@@ -1810,6 +1880,20 @@ PeerManagerImpl::PeerManagerImpl(CConnman& connman, AddrMan& addrman,
     if (gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE)) {
         m_txreconciliation = std::make_unique<TxReconciliationTracker>(TXRECONCILIATION_VERSION);
     }
+
+    const int msg_workers{std::clamp<int>(gArgs.GetIntArg("-msgworkers", DEFAULT_MSG_WORKERS), 0, MAX_MSG_WORKERS)};
+    for (int n = 0; n < msg_workers; ++n) {
+        m_msg_workers.emplace_back(&util::TraceThread, strprintf("msgworker.%i", n), [this] { ThreadMessageWorker(); });
+    }
+}
+
+PeerManagerImpl::~PeerManagerImpl()
+{
+    WITH_LOCK(m_msg_workers_mutex, m_msg_workers_interrupt = true);
+    m_msg_workers_cv.notify_all();
+    for (std::thread& worker : m_msg_workers) {
+        worker.join();
+    }
 }
 
 void PeerManagerImpl::StartScheduledTasks(CScheduler& scheduler)
@@ -2148,56 +2232,94 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
         }
     }
 
-    LOCK(cs_main);
-    const CBlockIndex* pindex = m_chainman.m_blockman.LookupBlockIndex(inv.hash);
-    if (!pindex) {
-        return;
-    }
-    if (!BlockRequestAllowed(pindex)) {
-        LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom.GetId());
+    FlatFilePos block_pos;
+    bool allow_compact;
+    uint256 tip_hash;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = m_chainman.m_blockman.LookupBlockIndex(inv.hash);
+        if (!pindex) {
+            return;
+        }
+        if (!BlockRequestAllowed(pindex)) {
+            LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom.GetId());
+            return;
+        }
+        // disconnect node in case we have reached the outbound limit for serving historical blocks
+        if (m_connman.OutboundTargetReached(true) &&
+            (((m_chainman.m_best_header != nullptr) && (m_chainman.m_best_header->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.IsMsgFilteredBlk()) &&
+            !pfrom.HasPermission(NetPermissionFlags::Download) // nodes with the download permission may exceed target
+        ) {
+            LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
+        if (!pfrom.HasPermission(NetPermissionFlags::NoBan) && (
+                (((peer.m_our_services & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((peer.m_our_services & NODE_NETWORK) != NODE_NETWORK) && (m_chainman.ActiveChain().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
+           )) {
+            LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold, disconnect peer=%d\n", pfrom.GetId());
+            //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
+            pfrom.fDisconnect = true;
+            return;
+        }
+        // Pruned nodes may have deleted the block, so check whether
+        // it's available before trying to send.
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            return;
+        }
+        block_pos = pindex->GetBlockPos();
+        // If a peer is asking for old blocks, we're almost guaranteed
+        // they won't have a useful mempool to match against a compact block,
+        // and we don't feel like constructing the object for them, so
+        // instead we respond with the full, non-compact block.
+        allow_compact = CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH;
+        tip_hash = m_chainman.ActiveChain().Tip()->GetBlockHash();
+    } // release cs_main before sending the block
+
+    if (a_recent_block && a_recent_block->GetHash() == inv.hash) {
+        SendBlockData(pfrom, peer, inv, block_pos, a_recent_block, a_recent_compact_block, allow_compact, tip_hash);
         return;
     }
+    // The block has to be read from disk, leave that to a message worker thread.
+    ServeBlockData(pfrom, peer, [=, &pfrom, &peer] {
+        SendBlockData(pfrom, peer, inv, block_pos, /*recent_block=*/nullptr, a_recent_compact_block, allow_compact, tip_hash);
+    });
+}
+
+void PeerManagerImpl::SendBlockData(CNode& pfrom, Peer& peer, const CInv& inv, const FlatFilePos& block_pos,
+                                    const std::shared_ptr<const CBlock>& recent_block,
+                                    const std::shared_ptr<const CBlockHeaderAndShortTxIDs>& recent_compact_block,
+                                    bool allow_compact, const uint256& tip_hash)
+{
     const CNetMsgMaker msgMaker(pfrom.GetCommonVersion());
-    // disconnect node in case we have reached the outbound limit for serving historical blocks
-    if (m_connman.OutboundTargetReached(true) &&
-        (((m_chainman.m_best_header != nullptr) && (m_chainman.m_best_header->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.IsMsgFilteredBlk()) &&
-        !pfrom.HasPermission(NetPermissionFlags::Download) // nodes with the download permission may exceed target
-    ) {
-        LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom.GetId());
-        pfrom.fDisconnect = true;
-        return;
-    }
-    // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
-    if (!pfrom.HasPermission(NetPermissionFlags::NoBan) && (
-            (((peer.m_our_services & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((peer.m_our_services & NODE_NETWORK) != NODE_NETWORK) && (m_chainman.ActiveChain().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
-       )) {
-        LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold, disconnect peer=%d\n", pfrom.GetId());
-        //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
-        pfrom.fDisconnect = true;
-        return;
-    }
-    // Pruned nodes may have deleted the block, so check whether
-    // it's available before trying to send.
-    if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
-        return;
-    }
-    std::shared_ptr<const CBlock> pblock;
-    if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
-        pblock = a_recent_block;
-    } else if (inv.IsMsgWitnessBlk()) {
+    std::shared_ptr<const CBlock> pblock{recent_block};
+    if (!pblock && inv.IsMsgWitnessBlk()) {
         // Fast-path: in this case it is possible to serve the block directly from disk,
         // as the network format matches the format on disk
-        std::vector<uint8_t> block_data;
-        if (!ReadRawBlockFromDisk(block_data, pindex->GetBlockPos(), m_chainparams.MessageStart())) {
-            assert(!"cannot load block from disk");
+        RawBlock block_data;
+        if (!ReadRawBlockFromDisk(block_data, block_pos, m_chainparams.MessageStart())) {
+            // The block may have been pruned since the request was checked.
+            LogPrint(BCLog::NET, "Cannot load block %s from disk, disconnect peer=%d\n", inv.hash.ToString(), pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
         }
-        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, Span{block_data}));
+        // Queue the block without copying it: the message shares the buffer
+        // (usually a mapping of the block file) with every other peer it is
+        // sent to, and keeps it alive until it has been written to the socket.
+        CSerializedNetMsg msg;
+        msg.m_type = NetMsgType::BLOCK;
+        msg.m_shared_owner = block_data.Owner();
+        msg.m_shared_data = block_data.Data();
+        m_connman.PushMessage(&pfrom, std::move(msg));
         // Don't set pblock as we've sent the block
-    } else {
+    } else if (!pblock) {
         // Send block from disk
         std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockRead, pindex, m_chainparams.GetConsensus())) {
-            assert(!"cannot load block from disk");
+        if (!ReadBlockFromDisk(*pblockRead, block_pos, m_chainparams.GetConsensus()) || pblockRead->GetHash() != inv.hash) {
+            LogPrint(BCLog::NET, "Cannot load block %s from disk, disconnect peer=%d\n", inv.hash.ToString(), pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
         }
         pblock = pblockRead;
     }
@@ -2231,13 +2353,9 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             // else
             // no response
         } else if (inv.IsMsgCmpctBlk()) {
-            // If a peer is asking for old blocks, we're almost guaranteed
-            // they won't have a useful mempool to match against a compact block,
-            // and we don't feel like constructing the object for them, so
-            // instead we respond with the full, non-compact block.
-            if (CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH) {
-                if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                    m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+            if (allow_compact) {
+                if (recent_compact_block && recent_compact_block->header.GetHash() == inv.hash) {
+                    m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *recent_compact_block));
                 } else {
                     CBlockHeaderAndShortTxIDs cmpctblock{*pblock};
                     m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
@@ -2256,13 +2374,56 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             // and we want it right after the last block so they don't
             // wait for other stuff first.
             std::vector<CInv> vInv;
-            vInv.push_back(CInv(MSG_BLOCK, m_chainman.ActiveChain().Tip()->GetBlockHash()));
+            vInv.push_back(CInv(MSG_BLOCK, tip_hash));
             m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::INV, vInv));
             peer.m_continuation_block.SetNull();
         }
     }
 }
 
+void PeerManagerImpl::ServeBlockData(CNode& node, Peer& peer, std::function<void()>&& send)
+{
+    if (m_msg_workers.empty()) {
+        send();
+        return;
+    }
+    // Keep the node around until the job is done. The peer is kept around by
+    // FinalizeNode(), which waits for m_serving_block_data to be reset.
+    node.AddRef();
+    peer.m_serving_block_data = true;
+    {
+        LOCK(m_msg_workers_mutex);
+        m_msg_jobs.emplace_back([this, &node, &peer, send = std::move(send)] {
+            send();
+            node.Release();
+            {
+                LOCK(m_msg_workers_mutex);
+                peer.m_serving_block_data = false;
+            }
+            m_msg_workers_cv.notify_all();
+            // The peer's next message can be processed now.
+            m_connman.WakeMessageHandler();
+        });
+    }
+    m_msg_workers_cv.notify_all();
+}
+
+void PeerManagerImpl::ThreadMessageWorker()
+{
+    SetSyscallSandboxPolicy(SyscallSandboxPolicy::MESSAGE_HANDLER);
+    while (true) {
+        std::function<void()> job;
+        {
+            WAIT_LOCK(m_msg_workers_mutex, lock);
+            m_msg_workers_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_msg_workers_mutex) { return m_msg_workers_interrupt || !m_msg_jobs.empty(); });
+            if (m_msg_jobs.empty()) return;
+            job = std::move(m_msg_jobs.front());
+            m_msg_jobs.pop_front();
+        }
+        job();
+    }
+}
+
 CTransactionRef PeerManagerImpl::FindTxForGetData(const Peer::TxRelay& tx_relay, const GenTxid& gtxid, const std::chrono::seconds mempool_req, const std::chrono::seconds now)
 {
     auto txinfo = m_mempool.info(gtxid);
@@ -2350,19 +2511,6 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
         }
     }
 
-    // Only process one BLOCK item per call, since they're uncommon and can be
-    // expensive to process.
-    if (it != peer.m_getdata_requests.end() && !pfrom.fPauseSend) {
-        const CInv &inv = *it++;
-        if (inv.IsGenBlkMsg()) {
-            ProcessGetBlockData(pfrom, peer, inv);
-        }
-        // else: If the first item on the queue is an unknown type, we erase it
-        // and continue processing the queue on the next call.
-    }
-
-    peer.m_getdata_requests.erase(peer.m_getdata_requests.begin(), it);
-
     if (!vNotFound.empty()) {
         // Let the peer know that we didn't find what it asked for, so it doesn't
         // have to wait around forever.
@@ -2378,8 +2526,23 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
         // In normal operation, we often send NOTFOUND messages for parents of
         // transactions that we relay; if a peer is missing a parent, they may
         // assume we have them and request the parents from us.
+        // This is sent before the block below, which may be sent by a message
+        // worker thread, to keep the responses in the order of the requests.
         m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::NOTFOUND, vNotFound));
     }
+
+    // Only process one BLOCK item per call, since they're uncommon and can be
+    // expensive to process.
+    if (it != peer.m_getdata_requests.end() && !pfrom.fPauseSend) {
+        const CInv &inv = *it++;
+        if (inv.IsGenBlkMsg()) {
+            ProcessGetBlockData(pfrom, peer, inv);
+        }
+        // else: If the first item on the queue is an unknown type, we erase it
+        // and continue processing the queue on the next call.
+    }
+
+    peer.m_getdata_requests.erase(peer.m_getdata_requests.begin(), it);
 }
 
 uint32_t PeerManagerImpl::GetFetchFlags(const Peer& peer) const
@@ -3874,6 +4037,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             return;
         }
 
+        FlatFilePos block_pos;
         {
             LOCK(cs_main);
 
@@ -3884,15 +4048,23 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             }
 
             if (pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_BLOCKTXN_DEPTH) {
-                CBlock block;
-                bool ret = ReadBlockFromDisk(block, pindex, m_chainparams.GetConsensus());
-                assert(ret);
-
-                SendBlockTransactions(pfrom, *peer, block, req);
-                return;
+                block_pos = pindex->GetBlockPos();
             }
         }
 
+        if (!block_pos.IsNull()) {
+            ServeBlockData(pfrom, *peer, [this, &pfrom, &peer = *peer, block_pos, req] {
+                CBlock block;
+                if (!ReadBlockFromDisk(block, block_pos, m_chainparams.GetConsensus()) || block.GetHash() != req.blockhash) {
+                    LogPrint(BCLog::NET, "Cannot load block %s from disk, disconnect peer=%d\n", req.blockhash.ToString(), pfrom.GetId());
+                    pfrom.fDisconnect = true;
+                    return;
+                }
+                SendBlockTransactions(pfrom, peer, block, req);
+            });
+            return;
+        }
+
         // If an older block is requested (should never happen in practice,
         // but can happen in tests) send a block response instead of a
         // blocktxn response. Sending a full block response instead of a
@@ -4879,6 +5051,10 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
     PeerRef peer = GetPeerRef(pfrom->GetId());
     if (peer == nullptr) return false;
 
+    // Wait for the block data that is being sent to the peer, the message
+    // handler is woken up when it is done.
+    if (peer->m_serving_block_data) return false;
+
     {
         LOCK(peer->m_getdata_requests_mutex);
         if (!peer->m_getdata_requests.empty()) {
@@ -4886,6 +5062,10 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
         }
     }
 
+    // A block may have been handed to a message worker thread just now; nothing
+    // else must be sent to the peer, nor another request served, until it's done.
+    if (peer->m_serving_block_data) return false;
+
     const bool processed_orphan = ProcessOrphanTx(*peer);
 
     if (pfrom->fDisconnect)
@@ -5376,6 +5556,10 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
     if (!pto->fSuccessfullyConnected || pto->fDisconnect)
         return true;
 
+    // Don't send anything while block data is being sent to the peer by a
+    // message worker thread either, so that it stays in order.
+    if (peer->m_serving_block_data) return true;
+
     // If we get here, the outgoing message serialization version is set and can't change.
     const CNetMsgMaker msgMaker(pto->GetCommonVersion());
 
@@ -18,6 +18,10 @@ class ChainstateManager;
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Default for -msgworkers, threads that send block data to peers in parallel with message processing */
+static const int DEFAULT_MSG_WORKERS{2};
+/** Maximum number of -msgworkers */
+static const int MAX_MSG_WORKERS{16};
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
 static const bool DEFAULT_PEERBLOCKFILTERS = false;
 /** Threshold for marking a node to be discouraged, e.g. disconnected and added to the discouragement filter. */
@@ -76,6 +80,12 @@ public:
     /* Public for unit testing. */
     virtual void UnitTestMisbehaving(NodeId peer_id, int howmuch) = 0;
 
+    /**
+     * Wait until no block data is being sent to the peer by a message worker
+     * thread. Public for unit testing.
+     */
+    virtual void WaitForBlockDataServed(NodeId peer_id) = 0;
+
     /**
      * Evict extra outbound peers. If we think our tip may be stale, connect to an extra outbound.
      * Public for unit testing.
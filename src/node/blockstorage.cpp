@@ -7,6 +7,7 @@
 #include <chain.h>
 #include <clientversion.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <logging.h>
@@ -18,11 +19,16 @@
 #include <streams.h>
 #include <undo.h>
 #include <util/fs.h>
+#include <util/fs_helpers.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <list>
 #include <map>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 
 namespace node {
@@ -56,6 +62,109 @@ static FILE* OpenUndoFile(const FlatFilePos& pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
 
+namespace {
+/**
+ * LRU of memory mapped block or undo files, so that reading a block or its
+ * undo data does not need to open and read the file each time.
+ *
+ * Only files of which the block file is finalized are mapped. Their undo
+ * files may still grow when blocks are connected out of order, in which case
+ * the file is mapped again. They are also truncated when finalized, but never
+ * to below the data written to them, so reads of records that were written
+ * before the file was mapped stay within the file.
+ */
+class MappedFileCache
+{
+private:
+    Mutex m_mutex;
+    //! Most recently used first.
+    std::list<std::pair<fs::path, std::shared_ptr<const MappedFile>>> m_files GUARDED_BY(m_mutex);
+    const size_t m_max_files;
+
+public:
+    explicit MappedFileCache(size_t max_files) : m_max_files{max_files} {}
+
+    /** Get a mapping of the file at path with at least min_size bytes. Returns
+     *  nullptr if the file can not (yet) be mapped. */
+    std::shared_ptr<const MappedFile> Get(const FlatFileSeq& seq, const FlatFilePos& pos, size_t min_size) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (m_max_files == 0) return nullptr;
+        const fs::path path{seq.FileName(pos)};
+        LOCK(m_mutex);
+        for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+            if (it->first != path) continue;
+            if (it->second->Data().size() >= min_size) {
+                m_files.splice(m_files.begin(), m_files, it);
+                return it->second;
+            }
+            // The file has grown since it was mapped.
+            m_files.erase(it);
+            break;
+        }
+        if (!fs::exists(BlockFileSeq().FileName(FlatFilePos{pos.nFile + 1, 0}))) return nullptr;
+        std::shared_ptr<const MappedFile> file{MappedFile::Open(path)};
+        if (!file || file->Data().size() < min_size) return nullptr;
+        m_files.emplace_front(path, file);
+        if (m_files.size() > m_max_files) m_files.pop_back();
+        return file;
+    }
+
+    void Erase(const FlatFileSeq& seq, const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const fs::path path{seq.FileName(pos)};
+        LOCK(m_mutex);
+        m_files.remove_if([&](const auto& entry) { return entry.first == path; });
+    }
+
+    void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_files.clear();
+    }
+};
+
+/** Number of block and of undo files kept memory mapped. Mapping is disabled
+ *  on 32-bit systems, which do not have the address space for it. */
+constexpr size_t MAX_MAPPED_BLOCK_FILES{sizeof(void*) >= 8 ? 64 : 0};
+
+MappedFileCache g_mapped_block_files{MAX_MAPPED_BLOCK_FILES};
+MappedFileCache g_mapped_undo_files{MAX_MAPPED_BLOCK_FILES};
+
+/** A record in a memory mapped file, with the mapping it points into. */
+struct MappedRecord {
+    std::shared_ptr<const MappedFile> file;
+    //! The message start preceding the record.
+    Span<const uint8_t> message_start;
+    //! The record, followed by the requested trailer.
+    Span<const uint8_t> data;
+};
+
+/**
+ * Find the record at pos, which is preceded by a message start and size
+ * header as written by WriteBlockToDisk and UndoWriteToDisk, in a memory
+ * mapped file. Returns nullopt if the file is not mapped, in which case the
+ * caller has to read it from the file.
+ */
+std::optional<MappedRecord> GetMappedRecord(MappedFileCache& cache, const FlatFileSeq& seq, const FlatFilePos& pos, size_t trailer_size)
+{
+    if (pos.nPos < BLOCK_SERIALIZATION_HEADER_SIZE) return std::nullopt;
+    MappedRecord record;
+    record.file = cache.Get(seq, pos, pos.nPos);
+    if (!record.file) return std::nullopt;
+    const uint8_t* header{record.file->Data().data() + pos.nPos - BLOCK_SERIALIZATION_HEADER_SIZE};
+    const size_t end{pos.nPos + size_t{ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE)} + trailer_size};
+    if (end > record.file->Data().size()) {
+        // The record may have been written after the file was mapped.
+        record.file = cache.Get(seq, pos, end);
+        if (!record.file) return std::nullopt;
+    }
+    const Span<const uint8_t> data{record.file->Data()};
+    record.message_start = data.subspan(pos.nPos - BLOCK_SERIALIZATION_HEADER_SIZE, CMessageHeader::MESSAGE_START_SIZE);
+    record.data = data.subspan(pos.nPos, end - pos.nPos);
+    return record;
+}
+} // namespace
+
 std::vector<CBlockIndex*> BlockManager::GetAllBlockIndices()
 {
     AssertLockHeld(cs_main);
@@ -67,6 +176,36 @@ std::vector<CBlockIndex*> BlockManager::GetAllBlockIndices()
     return rv;
 }
 
+std::vector<CBlockIndex*> BlockManager::GetAllBlockIndicesByHeight()
+{
+    AssertLockHeld(cs_main);
+    int max_height{-1};
+    for (const auto& [_, block_index] : m_block_index) {
+        max_height = std::max(max_height, block_index.nHeight);
+    }
+    std::vector<CBlockIndex*> rv(m_block_index.size());
+    if (max_height < 0 || size_t(max_height) >= 2 * rv.size()) {
+        // Heights of a valid block tree are below the number of entries. Do
+        // not allocate the counters for a corrupted index.
+        rv = GetAllBlockIndices();
+        std::sort(rv.begin(), rv.end(), CBlockIndexHeightOnlyComparator());
+        return rv;
+    }
+
+    // offsets[h] is the position of the next entry with height h in rv.
+    std::vector<size_t> offsets(max_height + 2, 0);
+    for (const auto& [_, block_index] : m_block_index) {
+        ++offsets[block_index.nHeight + 1];
+    }
+    for (size_t h = 1; h < offsets.size(); ++h) {
+        offsets[h] += offsets[h - 1];
+    }
+    for (auto& [_, block_index] : m_block_index) {
+        rv[offsets[block_index.nHeight]++] = &block_index;
+    }
+    return rv;
+}
+
 CBlockIndex* BlockManager::LookupBlockIndex(const uint256& hash)
 {
     AssertLockHeld(cs_main);
@@ -259,9 +398,7 @@ bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
     }
 
     // Calculate nChainWork
-    std::vector<CBlockIndex*> vSortedByHeight{GetAllBlockIndices()};
-    std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
-              CBlockIndexHeightOnlyComparator());
+    std::vector<CBlockIndex*> vSortedByHeight{GetAllBlockIndicesByHeight()};
 
     for (CBlockIndex* pindex : vSortedByHeight) {
         if (ShutdownRequested()) return false;
@@ -430,6 +567,8 @@ void CleanupBlockRevFiles()
     // Remove the rev files immediately and insert the blk file paths into an
     // ordered map keyed by block file index.
     LogPrintf("Removing unusable blk?????.dat and rev?????.dat files for -reindex with -prune\n");
+    g_mapped_block_files.Clear();
+    g_mapped_undo_files.Clear();
     const fs::path& blocksdir = gArgs.GetBlocksDirPath();
     for (fs::directory_iterator it(blocksdir); it != fs::directory_iterator(); it++) {
         const std::string path = fs::PathToString(it->path().filename());
@@ -495,20 +634,9 @@ static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const
     return true;
 }
 
-bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+template <typename Stream>
+static bool ReadUndo(CBlockUndo& blockundo, Stream& filein, const CBlockIndex* pindex)
 {
-    const FlatFilePos pos{WITH_LOCK(::cs_main, return pindex->GetUndoPos())};
-
-    if (pos.IsNull()) {
-        return error("%s: no undo data available", __func__);
-    }
-
-    // Open history file to read
-    AutoFile filein{OpenUndoFile(pos, true)};
-    if (filein.IsNull()) {
-        return error("%s: OpenUndoFile failed", __func__);
-    }
-
     // Read block
     uint256 hashChecksum;
     HashVerifier verifier{filein}; // Use HashVerifier as reserializing may lose data, c.f. commit d342424301013ec47dc146a4beb49d5c9319d80a
@@ -528,12 +656,35 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     return true;
 }
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    const FlatFilePos pos{WITH_LOCK(::cs_main, return pindex->GetUndoPos())};
+
+    if (pos.IsNull()) {
+        return error("%s: no undo data available", __func__);
+    }
+
+    if (auto record{GetMappedRecord(g_mapped_undo_files, UndoFileSeq(), pos, sizeof(uint256))}) {
+        SpanReader filein{SER_DISK, CLIENT_VERSION, record->data};
+        return ReadUndo(blockundo, filein, pindex);
+    }
+
+    // Open history file to read
+    AutoFile filein{OpenUndoFile(pos, true)};
+    if (filein.IsNull()) {
+        return error("%s: OpenUndoFile failed", __func__);
+    }
+    return ReadUndo(blockundo, filein, pindex);
+}
+
 void BlockManager::FlushUndoFile(int block_file, bool finalize)
 {
     FlatFilePos undo_pos_old(block_file, m_blockfile_info[block_file].nUndoSize);
     if (!UndoFileSeq().Flush(undo_pos_old, finalize)) {
         AbortNode("Flushing undo file to disk failed. This is likely the result of an I/O error.");
     }
+    // Finalizing truncated the file, so map it again with its final size.
+    if (finalize) g_mapped_undo_files.Erase(UndoFileSeq(), undo_pos_old);
 }
 
 void BlockManager::FlushBlockFile(bool fFinalize, bool finalize_undo)
@@ -574,6 +725,8 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
     std::error_code ec;
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        g_mapped_block_files.Erase(BlockFileSeq(), pos);
+        g_mapped_undo_files.Erase(UndoFileSeq(), pos);
         const bool removed_blockfile{fs::remove(BlockFileSeq().FileName(pos), ec)};
         const bool removed_undofile{fs::remove(UndoFileSeq().FileName(pos), ec)};
         if (removed_blockfile || removed_undofile) {
@@ -742,17 +895,25 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-    }
+    if (auto record{GetMappedRecord(g_mapped_block_files, BlockFileSeq(), pos, 0)}) {
+        try {
+            SpanReader{SER_DISK, CLIENT_VERSION, record->data} >> block;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+        }
 
-    // Read block
-    try {
-        filein >> block;
-    } catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -782,8 +943,22 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
-bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
+bool ReadRawBlockFromDisk(RawBlock& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
+    if (auto record{GetMappedRecord(g_mapped_block_files, BlockFileSeq(), pos, 0)}) {
+        if (memcmp(record->message_start.data(), message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                         HexStr(record->message_start),
+                         HexStr(message_start));
+        }
+        if (record->data.size() > MAX_SIZE) {
+            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                         record->data.size(), MAX_SIZE);
+        }
+        block = RawBlock{std::move(record->file), record->data};
+        return true;
+    }
+
     FlatFilePos hpos = pos;
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     AutoFile filein{OpenBlockFile(hpos, true)};
@@ -808,8 +983,9 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
                          blk_size, MAX_SIZE);
         }
 
-        block.resize(blk_size); // Zeroing of memory is intentional here
-        filein.read(MakeWritableByteSpan(block));
+        auto data{std::make_shared<std::vector<uint8_t>>(blk_size)}; // Zeroing of memory is intentional here
+        filein.read(MakeWritableByteSpan(*data));
+        block = RawBlock{data, *data};
     } catch (const std::exception& e) {
         return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
     }
@@ -10,13 +10,18 @@
 #include <kernel/blockmanager_opts.h>
 #include <kernel/cs_main.h>
 #include <protocol.h>
+#include <span.h>
+#include <support/allocators/pool.h>
 #include <sync.h>
 #include <txdb.h>
 #include <util/fs.h>
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 class ArgsManager;
@@ -53,7 +58,16 @@ extern std::atomic_bool fReindex;
 // we ever switch to another associative container, we need to either use a
 // container that has stable addressing (true of all std associative
 // containers), or make the key a `std::unique_ptr<CBlockIndex>`
-using BlockMap = std::unordered_map<uint256, CBlockIndex, BlockHasher>;
+//
+// The nodes are allocated from a PoolAllocator, see CCoinsMap for the choice of
+// MAX_BLOCK_SIZE_BYTES. The block index only grows while the node runs, so
+// allocating the entries from an arena avoids one heap allocation per block.
+using BlockMap = std::unordered_map<uint256,
+                                    CBlockIndex,
+                                    BlockHasher,
+                                    std::equal_to<uint256>,
+                                    PoolAllocator<std::pair<const uint256, CBlockIndex>,
+                                                  sizeof(std::pair<const uint256, CBlockIndex>) + sizeof(void*) * 4>>;
 
 struct CBlockIndexWorkComparator {
     bool operator()(const CBlockIndex* pa, const CBlockIndex* pb) const;
@@ -149,10 +163,23 @@ public:
 
     std::atomic<bool> m_importing{false};
 
-    BlockMap m_block_index GUARDED_BY(cs_main);
+private:
+    //! Arena the entries of m_block_index are allocated from. Declared before
+    //! m_block_index so that it outlives it.
+    BlockMap::allocator_type::ResourceType m_block_index_resource{};
+
+public:
+    BlockMap m_block_index GUARDED_BY(cs_main){0, BlockHasher{}, BlockMap::key_equal{}, &m_block_index_resource};
 
     std::vector<CBlockIndex*> GetAllBlockIndices() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    /**
+     * All block indices, ordered by height. This is a counting sort, which
+     * is linear in the number of entries, instead of a comparison sort.
+     * The order of entries with the same height is unspecified.
+     */
+    std::vector<CBlockIndex*> GetAllBlockIndicesByHeight() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     /**
      * All pairs A->B, where A (or one of its ancestors) misses transactions, but B has transactions.
      * Pruned nodes may have entries where B is missing data.
@@ -230,10 +257,30 @@ fs::path GetBlockPosFilename(const FlatFilePos& pos);
  */
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
+/**
+ * A serialized block as stored in a block file. If the block file is memory
+ * mapped, this points into the mapping and keeps it alive, so that the block
+ * does not have to be copied.
+ */
+class RawBlock
+{
+private:
+    std::shared_ptr<const void> m_owner;
+    Span<const uint8_t> m_data;
+
+public:
+    RawBlock() = default;
+    RawBlock(std::shared_ptr<const void> owner, Span<const uint8_t> data) : m_owner{std::move(owner)}, m_data{data} {}
+
+    Span<const uint8_t> Data() const { return m_data; }
+    /** Keeps Data() valid for as long as it is held, e.g. while the block is queued for sending. */
+    const std::shared_ptr<const void>& Owner() const { return m_owner; }
+};
+
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
-bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
+bool ReadRawBlockFromDisk(RawBlock& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
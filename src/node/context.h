@@ -30,6 +30,8 @@ class WalletLoader;
 } // namespace interfaces
 
 namespace node {
+class BlockTemplateCache;
+
 //! NodeContext struct containing references to chain state and connection
 //! state.
 //!
@@ -51,6 +53,7 @@ struct NodeContext {
     std::unique_ptr<const NetGroupManager> netgroupman;
     std::unique_ptr<CBlockPolicyEstimator> fee_estimator;
     std::unique_ptr<PeerManager> peerman;
+    std::unique_ptr<BlockTemplateCache> block_template_cache;
     std::unique_ptr<ChainstateManager> chainman;
     std::unique_ptr<BanMan> banman;
     ArgsManager* args{nullptr}; // Currently a raw pointer because the memory is not managed by this struct
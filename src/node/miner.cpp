@@ -18,12 +18,16 @@
 #include <policy/policy.h>
 #include <pow.h>
 #include <primitives/transaction.h>
+#include <script/script.h>
 #include <timedata.h>
 #include <util/moneystr.h>
+#include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <validation.h>
 
 #include <algorithm>
+#include <stdexcept>
 #include <utility>
 
 namespace node {
@@ -91,8 +95,6 @@ BlockAssembler::BlockAssembler(Chainstate& chainstate, const CTxMemPool* mempool
 
 void BlockAssembler::resetBlock()
 {
-    inBlock.clear();
-
     // Reserve space for coinbase tx
     nBlockWeight = 4000;
     nBlockSigOpsCost = 400;
@@ -123,6 +125,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     LOCK(::cs_main);
     CBlockIndex* pindexPrev = m_chainstate.m_chain.Tip();
     assert(pindexPrev != nullptr);
+    m_prev_block = pindexPrev;
     nHeight = pindexPrev->nHeight + 1;
 
     pblock->nVersion = m_chainstate.m_chainman.m_versionbitscache.ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
@@ -136,10 +139,10 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     m_lock_time_cutoff = pindexPrev->GetMedianTimePast();
 
     int nPackagesSelected = 0;
-    int nDescendantsUpdated = 0;
     if (m_mempool) {
         LOCK(m_mempool->cs);
-        addPackageTxs(*m_mempool, nPackagesSelected, nDescendantsUpdated);
+        m_mempool_sequence = m_mempool->GetSequence();
+        addPackageTxs(*m_mempool, nPackagesSelected);
     }
 
     const auto time_1{SteadyClock::now()};
@@ -175,26 +178,14 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
     const auto time_2{SteadyClock::now()};
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n",
-             Ticks<MillisecondsDouble>(time_1 - time_start), nPackagesSelected, nDescendantsUpdated,
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages), validity: %.2fms (total %.2fms)\n",
+             Ticks<MillisecondsDouble>(time_1 - time_start), nPackagesSelected,
              Ticks<MillisecondsDouble>(time_2 - time_1),
              Ticks<MillisecondsDouble>(time_2 - time_start));
 
     return std::move(pblocktemplate);
 }
 
-void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
-{
-    for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
-        // Only test txs not already in the block
-        if (inBlock.count(*iit)) {
-            testSet.erase(iit++);
-        } else {
-            iit++;
-        }
-    }
-}
-
 bool BlockAssembler::TestPackage(uint64_t packageSize, int64_t packageSigOpsCost) const
 {
     // TODO: switch to weight-based accounting for packages instead of vsize-based accounting.
@@ -209,7 +200,7 @@ bool BlockAssembler::TestPackage(uint64_t packageSize, int64_t packageSigOpsCost
 
 // Perform transaction-level checks before adding to block:
 // - transaction finality (locktime)
-bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& package) const
+bool BlockAssembler::TestPackageTransactions(Span<const CTxMemPool::txiter> package) const
 {
     for (CTxMemPool::txiter it : package) {
         if (!IsFinalTx(it->GetTx(), nHeight, m_lock_time_cutoff)) {
@@ -228,7 +219,6 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     ++nBlockTx;
     nBlockSigOpsCost += iter->GetSigOpCost();
     nFees += iter->GetFee();
-    inBlock.insert(iter);
 
     bool fPrintPriority = gArgs.GetBoolArg("-printpriority", DEFAULT_PRINTPRIORITY);
     if (fPrintPriority) {
@@ -238,69 +228,36 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     }
 }
 
-/** Add descendants of given transactions to mapModifiedTx with ancestor
- * state updated assuming given transactions are inBlock. Returns number
- * of updated descendants. */
-static int UpdatePackagesForAdded(const CTxMemPool& mempool,
-                                  const CTxMemPool::setEntries& alreadyAdded,
-                                  indexed_modified_transaction_set& mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs)
+// The mempool keeps each cluster of related transactions linearized into
+// chunks of non-increasing feerate, so the best chunk that is left is always
+// the next chunk of some cluster. Selecting transactions is a merge of the
+// chunk sequences of all clusters: no ancestor sets need to be computed and
+// nothing needs to be updated as transactions are added.
+void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSelected)
 {
     AssertLockHeld(mempool.cs);
 
-    int nDescendantsUpdated = 0;
-    for (CTxMemPool::txiter it : alreadyAdded) {
-        CTxMemPool::setEntries descendants;
-        mempool.CalculateDescendants(it, descendants);
-        // Insert all descendants (not yet in block) into the modified set
-        for (CTxMemPool::txiter desc : descendants) {
-            if (alreadyAdded.count(desc)) {
-                continue;
-            }
-            ++nDescendantsUpdated;
-            modtxiter mit = mapModifiedTx.find(desc);
-            if (mit == mapModifiedTx.end()) {
-                CTxMemPoolModifiedEntry modEntry(desc);
-                mit = mapModifiedTx.insert(modEntry).first;
-            }
-            mapModifiedTx.modify(mit, update_for_parent_inclusion(it));
-        }
+    struct NextChunk {
+        const CTxMemPool::Cluster* cluster;
+        size_t index;
+
+        const CTxMemPool::Cluster::Chunk& Get() const { return cluster->chunks[index]; }
+        size_t Begin() const { return index == 0 ? 0 : cluster->chunks[index - 1].end; }
+    };
+    // Order by feerate, then by the hash of the first transaction.
+    const auto lower_feerate = [](const NextChunk& a, const NextChunk& b) {
+        const double fee_a{double(a.Get().fee) * b.Get().size};
+        const double fee_b{double(b.Get().fee) * a.Get().size};
+        if (fee_a != fee_b) return fee_a < fee_b;
+        return CompareIteratorByHash{}(b.cluster->txs[b.Begin()], a.cluster->txs[a.Begin()]);
+    };
+    std::vector<NextChunk> next_chunks;
+    const auto& clusters{mempool.GetClusters()};
+    next_chunks.reserve(clusters.size());
+    for (const auto& [_, cluster] : clusters) {
+        next_chunks.push_back({&cluster, 0});
     }
-    return nDescendantsUpdated;
-}
-
-void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, std::vector<CTxMemPool::txiter>& sortedEntries)
-{
-    // Sort package by ancestor count
-    // If a transaction A depends on transaction B, then A's ancestor count
-    // must be greater than B's.  So this is sufficient to validly order the
-    // transactions for block inclusion.
-    sortedEntries.clear();
-    sortedEntries.insert(sortedEntries.begin(), package.begin(), package.end());
-    std::sort(sortedEntries.begin(), sortedEntries.end(), CompareTxIterByAncestorCount());
-}
-
-// This transaction selection algorithm orders the mempool based
-// on feerate of a transaction including all unconfirmed ancestors.
-// Since we don't remove transactions from the mempool as we select them
-// for block inclusion, we need an alternate method of updating the feerate
-// of a transaction with its not-yet-selected ancestors as we go.
-// This is accomplished by walking the in-mempool descendants of selected
-// transactions and storing a temporary modified state in mapModifiedTxs.
-// Each time through the loop, we compare the best transaction in
-// mapModifiedTxs with the next transaction in the mempool to decide what
-// transaction package to work on next.
-void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSelected, int& nDescendantsUpdated)
-{
-    AssertLockHeld(mempool.cs);
-
-    // mapModifiedTx will store sorted packages after they are modified
-    // because some of their txs are already in the block
-    indexed_modified_transaction_set mapModifiedTx;
-    // Keep track of entries that failed inclusion, to avoid duplicate work
-    CTxMemPool::setEntries failedTx;
-
-    CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = mempool.mapTx.get<ancestor_score>().begin();
-    CTxMemPool::txiter iter;
+    std::make_heap(next_chunks.begin(), next_chunks.end(), lower_feerate);
 
     // Limit the number of attempts to add transactions to the block when it is
     // close to full; this is just a simple heuristic to finish quickly if the
@@ -308,82 +265,20 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
-    while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty()) {
-        // First try to find a new transaction in mapTx to evaluate.
-        //
-        // Skip entries in mapTx that are already in a block or are present
-        // in mapModifiedTx (which implies that the mapTx ancestor state is
-        // stale due to ancestor inclusion in the block)
-        // Also skip transactions that we've already failed to add. This can happen if
-        // we consider a transaction in mapModifiedTx and it fails: we can then
-        // potentially consider it again while walking mapTx.  It's currently
-        // guaranteed to fail again, but as a belt-and-suspenders check we put it in
-        // failedTx and avoid re-evaluation, since the re-evaluation would be using
-        // cached size/sigops/fee values that are not actually correct.
-        /** Return true if given transaction from mapTx has already been evaluated,
-         * or if the transaction's cached data in mapTx is incorrect. */
-        if (mi != mempool.mapTx.get<ancestor_score>().end()) {
-            auto it = mempool.mapTx.project<0>(mi);
-            assert(it != mempool.mapTx.end());
-            if (mapModifiedTx.count(it) || inBlock.count(it) || failedTx.count(it)) {
-                ++mi;
-                continue;
-            }
-        }
-
-        // Now that mi is not stale, determine which transaction to evaluate:
-        // the next entry from mapTx, or the best from mapModifiedTx?
-        bool fUsingModified = false;
-
-        modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
-        if (mi == mempool.mapTx.get<ancestor_score>().end()) {
-            // We're out of entries in mapTx; use the entry from mapModifiedTx
-            iter = modit->iter;
-            fUsingModified = true;
-        } else {
-            // Try to compare the mapTx entry to the mapModifiedTx entry
-            iter = mempool.mapTx.project<0>(mi);
-            if (modit != mapModifiedTx.get<ancestor_score>().end() &&
-                    CompareTxMemPoolEntryByAncestorFee()(*modit, CTxMemPoolModifiedEntry(iter))) {
-                // The best entry in mapModifiedTx has higher score
-                // than the one from mapTx.
-                // Switch which transaction (package) to consider
-                iter = modit->iter;
-                fUsingModified = true;
-            } else {
-                // Either no entry in mapModifiedTx, or it's worse than mapTx.
-                // Increment mi for the next loop iteration.
-                ++mi;
-            }
-        }
+    while (!next_chunks.empty()) {
+        std::pop_heap(next_chunks.begin(), next_chunks.end(), lower_feerate);
+        const NextChunk next{next_chunks.back()};
+        next_chunks.pop_back();
+        const CTxMemPool::Cluster::Chunk& chunk{next.Get()};
 
-        // We skip mapTx entries that are inBlock, and mapModifiedTx shouldn't
-        // contain anything that is inBlock.
-        assert(!inBlock.count(iter));
-
-        uint64_t packageSize = iter->GetSizeWithAncestors();
-        CAmount packageFees = iter->GetModFeesWithAncestors();
-        int64_t packageSigOpsCost = iter->GetSigOpCostWithAncestors();
-        if (fUsingModified) {
-            packageSize = modit->nSizeWithAncestors;
-            packageFees = modit->nModFeesWithAncestors;
-            packageSigOpsCost = modit->nSigOpCostWithAncestors;
-        }
-
-        if (packageFees < m_options.blockMinFeeRate.GetFee(packageSize)) {
+        if (chunk.fee < m_options.blockMinFeeRate.GetFee(chunk.size)) {
             // Everything else we might consider has a lower fee rate
             return;
         }
 
-        if (!TestPackage(packageSize, packageSigOpsCost)) {
-            if (fUsingModified) {
-                // Since we always look at the best entry in mapModifiedTx,
-                // we must erase failed entries so that we can consider the
-                // next best entry on the next loop iteration
-                mapModifiedTx.get<ancestor_score>().erase(modit);
-                failedTx.insert(iter);
-            }
-
+        // A chunk that cannot be added takes the rest of its cluster with it,
+        // since later chunks may spend its transactions.
+        if (!TestPackage(chunk.size, chunk.sigop_cost)) {
             ++nConsecutiveFailed;
 
             if (nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockWeight >
@@ -394,37 +289,136 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
             continue;
         }
 
-        auto ancestors{mempool.AssumeCalculateMemPoolAncestors(__func__, *iter, CTxMemPool::Limits::NoLimits(), /*fSearchForParents=*/false)};
-
-        onlyUnconfirmed(ancestors);
-        ancestors.insert(iter);
+        const Span<const CTxMemPool::txiter> package{next.cluster->txs.data() + next.Begin(), chunk.end - next.Begin()};
 
         // Test if all tx's are Final
-        if (!TestPackageTransactions(ancestors)) {
-            if (fUsingModified) {
-                mapModifiedTx.get<ancestor_score>().erase(modit);
-                failedTx.insert(iter);
-            }
+        if (!TestPackageTransactions(package)) {
             continue;
         }
 
         // This transaction will make it in; reset the failed counter.
         nConsecutiveFailed = 0;
 
-        // Package can be added. Sort the entries in a valid order.
-        std::vector<CTxMemPool::txiter> sortedEntries;
-        SortForBlock(ancestors, sortedEntries);
-
-        for (size_t i = 0; i < sortedEntries.size(); ++i) {
-            AddToBlock(sortedEntries[i]);
-            // Erase from the modified set, if present
-            mapModifiedTx.erase(sortedEntries[i]);
+        // The chunk is already in a valid order.
+        for (const CTxMemPool::txiter& it : package) {
+            AddToBlock(it);
         }
 
         ++nPackagesSelected;
 
-        // Update transactions that depend on each of these
-        nDescendantsUpdated += UpdatePackagesForAdded(mempool, ancestors, mapModifiedTx);
+        if (next.index + 1 < next.cluster->chunks.size()) {
+            next_chunks.push_back({next.cluster, next.index + 1});
+            std::push_heap(next_chunks.begin(), next_chunks.end(), lower_feerate);
+        }
     }
 }
+
+BlockTemplateCache::BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool)
+    : m_chainman{chainman},
+      m_mempool{mempool}
+{
+}
+
+BlockTemplateCache::~BlockTemplateCache()
+{
+    std::thread thread;
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+        thread = std::move(m_thread);
+    }
+    m_cv.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+BlockTemplateCache::Entry BlockTemplateCache::Get()
+{
+    const CBlockIndex* const tip{m_chainman.CachedActiveTip()};
+    const uint64_t sequence{m_mempool.GetSequence()};
+    {
+        LOCK(m_mutex);
+        if (!m_thread.joinable()) {
+            // The template built below is up to date.
+            m_tip_changed = false;
+            m_mempool_changed = false;
+            m_thread = std::thread(&util::TraceThread, "blocktemplate", [this] {
+                SetSyscallSandboxPolicy(SyscallSandboxPolicy::BLOCK_TEMPLATE);
+                ThreadRefresh();
+            });
+        }
+        if (m_entry && m_entry->prev == tip &&
+            (m_entry->mempool_sequence == sequence || SteadyClock::now() - m_entry->time < BLOCK_TEMPLATE_MAX_AGE)) {
+            return *m_entry;
+        }
+    }
+    Entry entry{Build()};
+    LOCK(m_mutex);
+    Store(entry);
+    return entry;
+}
+
+BlockTemplateCache::Entry BlockTemplateCache::Build() const
+{
+    Entry entry;
+    // Read before the template is built, so that later changes are not missed.
+    entry.transactions_updated = m_mempool.GetTransactionsUpdated();
+    entry.time = SteadyClock::now();
+    BlockAssembler assembler{m_chainman.ActiveChainstate(), &m_mempool};
+    entry.block_template = assembler.CreateNewBlock(CScript() << OP_TRUE);
+    entry.prev = assembler.GetPrevBlock();
+    entry.mempool_sequence = assembler.GetMempoolSequence();
+    return entry;
+}
+
+void BlockTemplateCache::Store(Entry entry)
+{
+    AssertLockHeld(m_mutex);
+    if (!entry.block_template) return;
+    if (!m_entry || entry.time >= m_entry->time) m_entry = std::move(entry);
+}
+
+void BlockTemplateCache::ThreadRefresh()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (!m_stop) {
+        if (!m_tip_changed && !m_mempool_changed) {
+            m_cv.wait(lock);
+            continue;
+        }
+        if (!m_tip_changed && m_entry && SteadyClock::now() < m_entry->time + BLOCK_TEMPLATE_REFRESH_INTERVAL) {
+            m_cv.wait_until(lock, m_entry->time + BLOCK_TEMPLATE_REFRESH_INTERVAL);
+            continue;
+        }
+        m_tip_changed = false;
+        m_mempool_changed = false;
+        std::optional<Entry> entry;
+        {
+            REVERSE_LOCK(lock);
+            try {
+                entry = Build();
+            } catch (const std::runtime_error& e) {
+                LogPrintf("Failed to refresh the block template: %s\n", e.what());
+            }
+        }
+        if (entry) Store(std::move(*entry));
+    }
+}
+
+void BlockTemplateCache::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    WITH_LOCK(m_mutex, m_tip_changed = true);
+    m_cv.notify_one();
+}
+
+void BlockTemplateCache::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence)
+{
+    WITH_LOCK(m_mutex, m_mempool_changed = true);
+    m_cv.notify_one();
+}
+
+void BlockTemplateCache::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
+{
+    WITH_LOCK(m_mutex, m_mempool_changed = true);
+    m_cv.notify_one();
+}
 } // namespace node
@@ -8,14 +8,19 @@
 
 #include <policy/policy.h>
 #include <primitives/block.h>
+#include <span.h>
+#include <sync.h>
+#include <threadsafety.h>
 #include <txmempool.h>
+#include <util/time.h>
+#include <validationinterface.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <optional>
 #include <stdint.h>
-
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index_container.hpp>
+#include <thread>
 
 class ArgsManager;
 class ChainstateManager;
@@ -36,96 +41,6 @@ struct CBlockTemplate
     std::vector<unsigned char> vchCoinbaseCommitment;
 };
 
-// Container for tracking updates to ancestor feerate as we include (parent)
-// transactions in a block
-struct CTxMemPoolModifiedEntry {
-    explicit CTxMemPoolModifiedEntry(CTxMemPool::txiter entry)
-    {
-        iter = entry;
-        nSizeWithAncestors = entry->GetSizeWithAncestors();
-        nModFeesWithAncestors = entry->GetModFeesWithAncestors();
-        nSigOpCostWithAncestors = entry->GetSigOpCostWithAncestors();
-    }
-
-    CAmount GetModifiedFee() const { return iter->GetModifiedFee(); }
-    uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
-    CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
-    size_t GetTxSize() const { return iter->GetTxSize(); }
-    const CTransaction& GetTx() const { return iter->GetTx(); }
-
-    CTxMemPool::txiter iter;
-    uint64_t nSizeWithAncestors;
-    CAmount nModFeesWithAncestors;
-    int64_t nSigOpCostWithAncestors;
-};
-
-/** Comparator for CTxMemPool::txiter objects.
- *  It simply compares the internal memory address of the CTxMemPoolEntry object
- *  pointed to. This means it has no meaning, and is only useful for using them
- *  as key in other indexes.
- */
-struct CompareCTxMemPoolIter {
-    bool operator()(const CTxMemPool::txiter& a, const CTxMemPool::txiter& b) const
-    {
-        return &(*a) < &(*b);
-    }
-};
-
-struct modifiedentry_iter {
-    typedef CTxMemPool::txiter result_type;
-    result_type operator() (const CTxMemPoolModifiedEntry &entry) const
-    {
-        return entry.iter;
-    }
-};
-
-// A comparator that sorts transactions based on number of ancestors.
-// This is sufficient to sort an ancestor package in an order that is valid
-// to appear in a block.
-struct CompareTxIterByAncestorCount {
-    bool operator()(const CTxMemPool::txiter& a, const CTxMemPool::txiter& b) const
-    {
-        if (a->GetCountWithAncestors() != b->GetCountWithAncestors()) {
-            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
-        }
-        return CompareIteratorByHash()(a, b);
-    }
-};
-
-typedef boost::multi_index_container<
-    CTxMemPoolModifiedEntry,
-    boost::multi_index::indexed_by<
-        boost::multi_index::ordered_unique<
-            modifiedentry_iter,
-            CompareCTxMemPoolIter
-        >,
-        // sorted by modified ancestor fee rate
-        boost::multi_index::ordered_non_unique<
-            // Reuse same tag from CTxMemPool's similar index
-            boost::multi_index::tag<ancestor_score>,
-            boost::multi_index::identity<CTxMemPoolModifiedEntry>,
-            CompareTxMemPoolEntryByAncestorFee
-        >
-    >
-> indexed_modified_transaction_set;
-
-typedef indexed_modified_transaction_set::nth_index<0>::type::iterator modtxiter;
-typedef indexed_modified_transaction_set::index<ancestor_score>::type::iterator modtxscoreiter;
-
-struct update_for_parent_inclusion
-{
-    explicit update_for_parent_inclusion(CTxMemPool::txiter it) : iter(it) {}
-
-    void operator() (CTxMemPoolModifiedEntry &e)
-    {
-        e.nModFeesWithAncestors -= iter->GetModifiedFee();
-        e.nSizeWithAncestors -= iter->GetTxSize();
-        e.nSigOpCostWithAncestors -= iter->GetSigOpCost();
-    }
-
-    CTxMemPool::txiter iter;
-};
-
 /** Generate a new block, without valid proof-of-work */
 class BlockAssembler
 {
@@ -138,7 +53,6 @@ private:
     uint64_t nBlockTx;
     uint64_t nBlockSigOpsCost;
     CAmount nFees;
-    CTxMemPool::setEntries inBlock;
 
     // Chain context for the block
     int nHeight;
@@ -148,6 +62,10 @@ private:
     const CTxMemPool* const m_mempool;
     Chainstate& m_chainstate;
 
+    // What the last template was built from
+    const CBlockIndex* m_prev_block{nullptr};
+    uint64_t m_mempool_sequence{0};
+
 public:
     struct Options {
         // Configuration parameters for the block size
@@ -166,6 +84,11 @@ public:
     inline static std::optional<int64_t> m_last_block_num_txs{};
     inline static std::optional<int64_t> m_last_block_weight{};
 
+    /** The block that the last template builds on. */
+    const CBlockIndex* GetPrevBlock() const { return m_prev_block; }
+    /** CTxMemPool::GetSequence() when the transactions of the last template were selected. */
+    uint64_t GetMempoolSequence() const { return m_mempool_sequence; }
+
 private:
     const Options m_options;
 
@@ -176,23 +99,79 @@ private:
     void AddToBlock(CTxMemPool::txiter iter);
 
     // Methods for how to add transactions to a block.
-    /** Add transactions based on feerate including unconfirmed ancestors
-      * Increments nPackagesSelected / nDescendantsUpdated with corresponding
-      * statistics from the package selection (for logging statistics). */
-    void addPackageTxs(const CTxMemPool& mempool, int& nPackagesSelected, int& nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Add transactions by merging the chunks of the mempool clusters in
+      * feerate order. Increments nPackagesSelected with the number of chunks
+      * selected (for logging statistics). */
+    void addPackageTxs(const CTxMemPool& mempool, int& nPackagesSelected) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
 
     // helper functions for addPackageTxs()
-    /** Remove confirmed (inBlock) entries from given set */
-    void onlyUnconfirmed(CTxMemPool::setEntries& testSet);
     /** Test if a new package would "fit" in the block */
     bool TestPackage(uint64_t packageSize, int64_t packageSigOpsCost) const;
     /** Perform checks on each transaction in a package:
       * locktime, premature-witness, serialized size (if necessary)
       * These checks should always succeed, and they're here
       * only as an extra check in case of suboptimal node configuration */
-    bool TestPackageTransactions(const CTxMemPool::setEntries& package) const;
-    /** Sort the package in an order that is valid to appear in a block */
-    void SortForBlock(const CTxMemPool::setEntries& package, std::vector<CTxMemPool::txiter>& sortedEntries);
+    bool TestPackageTransactions(Span<const CTxMemPool::txiter> package) const;
+};
+
+/** Minimum time between two background rebuilds of the cached block template after mempool changes. */
+static constexpr std::chrono::seconds BLOCK_TEMPLATE_REFRESH_INTERVAL{1};
+/** Age up to which a cached block template for the current tip is served although the mempool has changed. */
+static constexpr std::chrono::seconds BLOCK_TEMPLATE_MAX_AGE{5};
+
+/**
+ * Keeps a block template for the current tip and mempool ready for
+ * getblocktemplate. Once a template has been requested, a background thread
+ * rebuilds it whenever the tip changes, and at most once per
+ * BLOCK_TEMPLATE_REFRESH_INTERVAL when the mempool changes.
+ */
+class BlockTemplateCache final : public CValidationInterface
+{
+public:
+    struct Entry {
+        std::shared_ptr<const CBlockTemplate> block_template;
+        //! Block that the template builds on.
+        const CBlockIndex* prev{nullptr};
+        //! CTxMemPool::GetSequence() when the template was built.
+        uint64_t mempool_sequence{0};
+        //! CTxMemPool::GetTransactionsUpdated() when the template was built.
+        unsigned int transactions_updated{0};
+        SteadyClock::time_point time;
+    };
+
+    BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool);
+    ~BlockTemplateCache();
+
+    /**
+     * Return a template that builds on the current tip and either reflects
+     * the current mempool or is younger than BLOCK_TEMPLATE_MAX_AGE. Only if
+     * the cache has no such template, one is built by the caller. Serving a
+     * cached template takes neither cs_main nor the mempool lock.
+     */
+    Entry Get() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    ChainstateManager& m_chainman;
+    const CTxMemPool& m_mempool;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::optional<Entry> m_entry GUARDED_BY(m_mutex);
+    bool m_tip_changed GUARDED_BY(m_mutex){false};
+    bool m_mempool_changed GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    //! Started by the first request, so that no templates are built for nodes that don't mine.
+    std::thread m_thread GUARDED_BY(m_mutex);
+
+    Entry Build() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    //! Keep the newest of the cached and the given template.
+    void Store(Entry entry) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void ThreadRefresh() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
 };
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
@@ -113,7 +113,7 @@ std::optional<std::string> HasNoNewUnconfirmed(const CTransaction& tx,
     return std::nullopt;
 }
 
-std::optional<std::string> EntriesAndTxidsDisjoint(const CTxMemPool::setEntries& ancestors,
+std::optional<std::string> EntriesAndTxidsDisjoint(const CTxMemPool::vecEntries& ancestors,
                                                    const std::set<uint256>& direct_conflicts,
                                                    const uint256& txid)
 {
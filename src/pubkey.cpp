@@ -6,6 +6,7 @@
 #include <pubkey.h>
 
 #include <hash.h>
+#include <schnorrbatch.h>
 #include <secp256k1.h>
 #include <secp256k1_extrakeys.h>
 #include <secp256k1_recovery.h>
@@ -15,6 +16,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <memory>
 
 namespace {
 
@@ -217,6 +219,33 @@ bool XOnlyPubKey::VerifySchnorr(const uint256& msg, Span<const unsigned char> si
     return secp256k1_schnorrsig_verify(secp256k1_context_static, sigbytes.data(), msg.begin(), 32, &pubkey);
 }
 
+bool VerifySchnorrBatch(Span<const SchnorrSignatureCheck> checks)
+{
+    // Enough for the multi-scalar multiplication of a few thousand points in one go.
+    static constexpr size_t BATCH_SCRATCH_SIZE{4 << 20};
+    struct ScratchDeleter {
+        void operator()(secp256k1_scratch_space* scratch) const { secp256k1_scratch_space_destroy(secp256k1_context_static, scratch); }
+    };
+    // Allocated once per verifying thread rather than for every batch.
+    thread_local const std::unique_ptr<secp256k1_scratch_space, ScratchDeleter> scratch{
+        secp256k1_scratch_space_create(secp256k1_context_static, BATCH_SCRATCH_SIZE)};
+
+    if (checks.empty()) return true;
+    std::vector<secp256k1_xonly_pubkey> pubkeys(checks.size());
+    std::vector<const secp256k1_xonly_pubkey*> pubkey_ptrs(checks.size());
+    std::vector<const unsigned char*> sig_ptrs(checks.size());
+    std::vector<const unsigned char*> msg_ptrs(checks.size());
+    for (size_t i = 0; i < checks.size(); ++i) {
+        if (!secp256k1_xonly_pubkey_parse(secp256k1_context_static, &pubkeys[i], checks[i].pubkey.data())) return false;
+        pubkey_ptrs[i] = &pubkeys[i];
+        sig_ptrs[i] = checks[i].sig.data();
+        msg_ptrs[i] = checks[i].msg.begin();
+    }
+    // Without a scratch space the points are multiplied one at a time, which is
+    // slower but still correct.
+    return mytherra_schnorrsig_verify_batch(scratch.get(), sig_ptrs.data(), msg_ptrs.data(), pubkey_ptrs.data(), checks.size());
+}
+
 static const HashWriter HASHER_TAPTWEAK{TaggedHash("TapTweak")};
 
 uint256 XOnlyPubKey::ComputeTapTweakHash(const uint256* merkle_root) const
@@ -12,6 +12,7 @@
 #include <span.h>
 #include <uint256.h>
 
+#include <array>
 #include <cstring>
 #include <optional>
 #include <vector>
@@ -291,6 +292,19 @@ public:
     SERIALIZE_METHODS(XOnlyPubKey, obj) { READWRITE(obj.m_keydata); }
 };
 
+/** A BIP340 signature check (pubkey, message, 64-byte signature) whose verification was deferred
+ *  so that it can be done as part of a batch. */
+struct SchnorrSignatureCheck {
+    XOnlyPubKey pubkey;
+    uint256 msg;
+    std::array<unsigned char, 64> sig;
+};
+
+/** Verify a batch of BIP340 signatures at once. This is faster than calling
+ *  XOnlyPubKey::VerifySchnorr for each of them, but only tells whether all
+ *  signatures are valid. Returns true for an empty batch. */
+bool VerifySchnorrBatch(Span<const SchnorrSignatureCheck> checks);
+
 struct CExtPubKey {
     unsigned char version[4];
     unsigned char nDepth;
@@ -12,6 +12,7 @@
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
 #include <index/txindex.h>
+#include <logging.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <primitives/block.h>
@@ -335,8 +336,9 @@ static bool rest_block(const std::any& context,
     }
 
     case RESTResponseFormat::JSON: {
-        UniValue objBlock = blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
-        std::string strJSON = objBlock.write() + "\n";
+        JSONWriter out;
+        blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity, out);
+        std::string strJSON = out.Text() + "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strJSON);
         return true;
@@ -683,6 +685,21 @@ static bool rest_mempool(const std::any& context, HTTPRequest* req, const std::s
             if (verbose && mempool_sequence) {
                 return RESTERR(req, HTTP_BAD_REQUEST, "Verbose results cannot contain mempool sequence values. (hint: set \"verbose=false\")");
             }
+            if (verbose) {
+                req->WriteHeader("Content-Type", "application/json");
+                req->StartReply(HTTP_OK);
+                const auto mempool_sequence{MempoolToJSONStream(*mempool, [&](const std::string& chunk) { req->WriteReplyChunk(chunk); })};
+                if (!mempool_sequence) {
+                    // The status was sent already, so the connection is closed
+                    // before the reply is complete, for the client to retry.
+                    LogPrint(BCLog::HTTP, "rest_mempool: the mempool changed while the result was written\n");
+                    req->AbortReply();
+                    return false;
+                }
+                req->WriteReplyChunk("\n");
+                req->EndReply();
+                return true;
+            }
             str_json = MempoolToJSON(*mempool, verbose, mempool_sequence).write() + "\n";
         } else {
             str_json = MempoolInfoToJSON(*mempool).write() + "\n";
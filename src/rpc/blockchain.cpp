@@ -201,6 +201,49 @@ UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIn
     return result;
 }
 
+void blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity, JSONWriter& out)
+{
+    const UniValue header{blockheaderToJSON(tip, blockindex)};
+    out.BeginObject();
+    for (size_t i = 0; i < header.size(); ++i) {
+        out.Key(header.getKeys()[i]);
+        out.Value(header.getValues()[i]);
+    }
+
+    out.Key("strippedsize");
+    out.Int(::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    out.Key("size");
+    out.Int(::GetSerializeSize(block, PROTOCOL_VERSION));
+    out.Key("weight");
+    out.Int(::GetBlockWeight(block));
+    out.Key("tx");
+    out.BeginArray();
+
+    switch (verbosity) {
+        case TxVerbosity::SHOW_TXID:
+            for (const CTransactionRef& tx : block.vtx) {
+                out.String(tx->GetHash().GetHex());
+            }
+            break;
+
+        case TxVerbosity::SHOW_DETAILS:
+        case TxVerbosity::SHOW_DETAILS_AND_PREVOUT:
+            CBlockUndo blockUndo;
+            const bool is_not_pruned{WITH_LOCK(::cs_main, return !blockman.IsBlockPruned(blockindex))};
+            const bool have_undo{is_not_pruned && UndoReadFromDisk(blockUndo, blockindex)};
+
+            for (size_t i = 0; i < block.vtx.size(); ++i) {
+                // coinbase transaction (i.e. i == 0) doesn't have undo data
+                const CTxUndo* txundo = (have_undo && i > 0) ? &blockUndo.vtxundo.at(i - 1) : nullptr;
+                TxToJSON(*block.vtx[i], /*block_hash=*/uint256(), out, /*include_hex=*/true, RPCSerializationFlags(), txundo, verbosity);
+            }
+            break;
+    }
+
+    out.EndArray();
+    out.EndObject();
+}
+
 static RPCHelpMan getblockcount()
 {
     return RPCHelpMan{"getblockcount",
@@ -756,6 +799,13 @@ static RPCHelpMan getblock()
         tx_verbosity = TxVerbosity::SHOW_DETAILS_AND_PREVOUT;
     }
 
+    if (request.result_writer) {
+        JSONWriter out{[&](const std::string& chunk) { request.result_writer->Write(chunk); }};
+        blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity, out);
+        out.Flush();
+        return NullUniValue;
+    }
+
     return blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
 },
     };
@@ -1019,6 +1069,44 @@ static RPCHelpMan gettxoutsetinfo()
     };
 }
 
+static RPCHelpMan getcoinsflushinfo()
+{
+    return RPCHelpMan{"getcoinsflushinfo",
+                "\nReturns information about writing the UTXO set cache to disk.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::BOOL, "background", "Whether the cache is written from a background thread (see -dbbackgroundflush)"},
+                        {RPCResult::Type::BOOL, "in_progress", "Whether a background write is in progress"},
+                        {RPCResult::Type::NUM, "coins_written", "The number of cache entries of the current or last write that are on disk"},
+                        {RPCResult::Type::NUM, "coins_total", "The number of cache entries of the current or last write"},
+                        {RPCResult::Type::NUM, "stall_time", "The total time in seconds that writing the cache blocked validation"},
+                        {RPCResult::Type::NUM, "last_stall_time", "The time in seconds that the last write of the cache blocked validation"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getcoinsflushinfo", "")
+            + HelpExampleRpc("getcoinsflushinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    LOCK(cs_main);
+    Chainstate& active_chainstate = chainman.ActiveChainstate();
+    const CoinsWriteProgress progress{active_chainstate.CoinsDB().GetBackgroundWriteProgress()};
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("background", chainman.m_options.coins_view.background_flush);
+    ret.pushKV("in_progress", progress.in_progress);
+    ret.pushKV("coins_written", uint64_t(progress.coins_written));
+    ret.pushKV("coins_total", uint64_t(progress.coins_total));
+    ret.pushKV("stall_time", Ticks<SecondsDouble>(active_chainstate.m_coins_flush_stall_time));
+    ret.pushKV("last_stall_time", Ticks<SecondsDouble>(active_chainstate.m_last_coins_flush_stall_time));
+    return ret;
+},
+    };
+}
+
 static RPCHelpMan gettxout()
 {
     return RPCHelpMan{"gettxout",
@@ -2716,6 +2804,7 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &getchaintips},
         {"blockchain", &getdifficulty},
         {"blockchain", &getdeploymentinfo},
+        {"blockchain", &getcoinsflushinfo},
         {"blockchain", &gettxout},
         {"blockchain", &gettxoutsetinfo},
         {"blockchain", &pruneblockchain},
@@ -10,6 +10,7 @@
 #include <chainparams.h>
 #include <core_io.h>
 #include <kernel/mempool_entry.h>
+#include <logging.h>
 #include <node/mempool_persist_args.h>
 #include <policy/rbf.h>
 #include <policy/settings.h>
@@ -378,6 +379,53 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
     }
 }
 
+/** Number of verbose mempool entries serialized per hold of the mempool lock. */
+static constexpr size_t MEMPOOL_JSON_CHUNK_ENTRIES{1000};
+
+std::optional<uint64_t> MempoolToJSONStream(const CTxMemPool& pool, const std::function<void(const std::string&)>& write)
+{
+    uint64_t mempool_sequence;
+    std::string chunk{"{"};
+    {
+        WAIT_LOCK(pool.cs, lock);
+        std::vector<uint256> txids;
+        txids.reserve(pool.mapTx.size());
+        for (const CTxMemPoolEntry& e : pool.mapTx) {
+            txids.push_back(e.GetTx().GetHash());
+        }
+        mempool_sequence = pool.GetSequence();
+
+        bool first{true};
+        for (size_t begin{0}; begin < txids.size(); begin += MEMPOOL_JSON_CHUNK_ENTRIES) {
+            // The lock was released for the previous piece. If the mempool
+            // changed meanwhile, the rest would not match what was written.
+            if (pool.GetSequence() != mempool_sequence) return std::nullopt;
+            const size_t end{std::min(txids.size(), begin + MEMPOOL_JSON_CHUNK_ENTRIES)};
+            for (size_t i{begin}; i < end; ++i) {
+                const auto it{pool.GetIter(txids[i])};
+                if (!Assume(it)) continue;
+                UniValue info(UniValue::VOBJ);
+                entryToJSON(pool, info, **it);
+                if (!first) chunk += ',';
+                first = false;
+                chunk += '"';
+                chunk += txids[i].ToString();
+                chunk += "\":";
+                chunk += info.write();
+            }
+            {
+                // Write outside of the lock, the receiver may block on a slow client.
+                REVERSE_LOCK(lock);
+                write(chunk);
+            }
+            chunk.clear();
+        }
+    }
+    chunk += '}';
+    write(chunk);
+    return mempool_sequence;
+}
+
 static RPCHelpMan getrawmempool()
 {
     return RPCHelpMan{"getrawmempool",
@@ -423,6 +471,15 @@ static RPCHelpMan getrawmempool()
         include_mempool_sequence = request.params[1].get_bool();
     }
 
+    if (fVerbose && !include_mempool_sequence && request.result_writer) {
+        const auto mempool_sequence{MempoolToJSONStream(EnsureAnyMemPool(request.context), [&](const std::string& chunk) {
+            request.result_writer->Write(chunk);
+        })};
+        // The reply is aborted, so that the client doesn't take the partial result for a complete one.
+        if (!mempool_sequence) throw JSONRPCError(RPC_MISC_ERROR, "The mempool changed while the result was written, try again");
+        return NullUniValue;
+    }
+
     return MempoolToJSON(EnsureAnyMemPool(request.context), fVerbose, include_mempool_sequence);
 },
     };
@@ -467,6 +524,7 @@ static RPCHelpMan getmempoolancestors()
     }
 
     auto ancestors{mempool.AssumeCalculateMemPoolAncestors(__func__, *it, CTxMemPool::Limits::NoLimits(), /*fSearchForParents=*/false)};
+    std::sort(ancestors.begin(), ancestors.end(), CompareIteratorByHash{});
 
     if (!fVerbose) {
         UniValue o(UniValue::VARR);
@@ -5,6 +5,11 @@
 #ifndef MYTHERRA_RPC_MEMPOOL_H
 #define MYTHERRA_RPC_MEMPOOL_H
 
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+
 class CTxMemPool;
 class UniValue;
 
@@ -14,4 +19,20 @@ UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false, bool include_mempool_sequence = false);
 
+/**
+ * Verbose mempool to JSON, written in pieces. Each piece is written as soon as
+ * it is built, and the mempool lock is only held while a piece is built, so
+ * that a large mempool neither blocks the node nor is held in memory for the
+ * whole serialization.
+ *
+ * The result has the same text as MempoolToJSON(pool, true).write(). If the
+ * mempool changes between two pieces, writing stops, so that the result never
+ * mixes different states of the mempool. The caller must then tell the client
+ * that what it received is incomplete.
+ *
+ * @return the mempool sequence number that the result reflects, or
+ *         std::nullopt if the mempool changed and the result is incomplete
+ */
+std::optional<uint64_t> MempoolToJSONStream(const CTxMemPool& pool, const std::function<void(const std::string&)>& write);
+
 #endif // MYTHERRA_RPC_MEMPOOL_H
@@ -38,10 +38,12 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <atomic>
 #include <memory>
 #include <stdint.h>
 
 using node::BlockAssembler;
+using node::BlockTemplateCache;
 using node::CBlockTemplate;
 using node::NodeContext;
 using node::RegenerateCommitments;
@@ -602,13 +604,12 @@ static RPCHelpMan getblocktemplate()
 {
     NodeContext& node = EnsureAnyNodeContext(request.context);
     ChainstateManager& chainman = EnsureChainman(node);
-    LOCK(cs_main);
 
+    // Only proposals take cs_main. Templates are served from the cache, which
+    // is checked against the active tip without it.
     std::string strMode = "template";
     UniValue lpval = NullUniValue;
     std::set<std::string> setClientRules;
-    Chainstate& active_chainstate = chainman.ActiveChainstate();
-    CChain& active_chain = active_chainstate.m_chain;
     if (!request.params[0].isNull())
     {
         const UniValue& oparam = request.params[0].get_obj();
@@ -633,6 +634,7 @@ static RPCHelpMan getblocktemplate()
             if (!DecodeHexBlk(block, dataval.get_str()))
                 throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Block decode failed");
 
+            LOCK(cs_main);
             uint256 hash = block.GetHash();
             const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(hash);
             if (pindex) {
@@ -643,7 +645,8 @@ static RPCHelpMan getblocktemplate()
                 return "duplicate-inconclusive";
             }
 
-            CBlockIndex* const pindexPrev = active_chain.Tip();
+            Chainstate& active_chainstate = chainman.ActiveChainstate();
+            CBlockIndex* const pindexPrev = active_chainstate.m_chain.Tip();
             // TestBlockValidity only supports blocks built on the current Tip
             if (block.hashPrevBlock != pindexPrev->GetBlockHash())
                 return "inconclusive-not-best-prevblk";
@@ -670,12 +673,12 @@ static RPCHelpMan getblocktemplate()
             throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, PACKAGE_NAME " is not connected!");
         }
 
-        if (active_chainstate.IsInitialBlockDownload()) {
+        if (chainman.IsInitialBlockDownload()) {
             throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, PACKAGE_NAME " is in initial sync and waiting for blocks...");
         }
     }
 
-    static unsigned int nTransactionsUpdatedLast;
+    static std::atomic<unsigned int> nTransactionsUpdatedLast;
     const CTxMemPool& mempool = EnsureMemPool(node);
 
     if (!lpval.isNull())
@@ -696,12 +699,10 @@ static RPCHelpMan getblocktemplate()
         else
         {
             // NOTE: Spec does not specify behaviour for non-string longpollid, but this makes testing easier
-            hashWatchedChain = active_chain.Tip()->GetBlockHash();
+            hashWatchedChain = CHECK_NONFATAL(chainman.CachedActiveTip())->GetBlockHash();
             nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
         }
 
-        // Release lock while waiting
-        LEAVE_CRITICAL_SECTION(cs_main);
         {
             checktxtime = std::chrono::steady_clock::now() + std::chrono::minutes(1);
 
@@ -718,7 +719,6 @@ static RPCHelpMan getblocktemplate()
                 }
             }
         }
-        ENTER_CRITICAL_SECTION(cs_main);
 
         if (!IsRPCRunning())
             throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
@@ -737,32 +737,16 @@ static RPCHelpMan getblocktemplate()
         throw JSONRPCError(RPC_INVALID_PARAMETER, "getblocktemplate must be called with the segwit rule set (call with {\"rules\": [\"segwit\"]})");
     }
 
-    // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t time_start;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (pindexPrev != active_chain.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - time_start > 5))
-    {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = nullptr;
-
-        // Store the pindexBest used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = active_chain.Tip();
-        time_start = GetTime();
-
-        // Create new block
-        CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler{active_chainstate, &mempool}.CreateNewBlock(scriptDummy);
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
-    }
-    CHECK_NONFATAL(pindexPrev);
-    CBlock* pblock = &pblocktemplate->block; // pointer for convenience
+    // Get a template for the current tip from the cache, which refreshes it in the background
+    const BlockTemplateCache::Entry cached{EnsureBlockTemplateCache(node).Get()};
+    if (!cached.block_template)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+    nTransactionsUpdatedLast = cached.transactions_updated;
+    const CBlockIndex* const pindexPrev{CHECK_NONFATAL(cached.prev)};
+    const CBlockTemplate& blocktemplate{*cached.block_template};
+    // Modify a copy, the cached template is shared with other requests
+    CBlock block{blocktemplate.block};
+    CBlock* pblock = &block; // pointer for convenience
 
     // Update nTime
     UpdateTime(pblock, consensusParams, pindexPrev);
@@ -799,8 +783,8 @@ static RPCHelpMan getblocktemplate()
         entry.pushKV("depends", deps);
 
         int index_in_template = i - 1;
-        entry.pushKV("fee", pblocktemplate->vTxFees[index_in_template]);
-        int64_t nTxSigOps = pblocktemplate->vTxSigOpsCost[index_in_template];
+        entry.pushKV("fee", blocktemplate.vTxFees[index_in_template]);
+        int64_t nTxSigOps = blocktemplate.vTxSigOpsCost[index_in_template];
         if (fPreSegWit) {
             CHECK_NONFATAL(nTxSigOps % WITNESS_SCALE_FACTOR == 0);
             nTxSigOps /= WITNESS_SCALE_FACTOR;
@@ -881,7 +865,8 @@ static RPCHelpMan getblocktemplate()
     result.pushKV("transactions", transactions);
     result.pushKV("coinbaseaux", aux);
     result.pushKV("coinbasevalue", (int64_t)pblock->vtx[0]->vout[0].nValue);
-    result.pushKV("longpollid", active_chain.Tip()->GetBlockHash().GetHex() + ToString(nTransactionsUpdatedLast));
+    // Identify the template itself, the tip may have moved on since it was fetched
+    result.pushKV("longpollid", pindexPrev->GetBlockHash().GetHex() + ToString(cached.transactions_updated));
     result.pushKV("target", hashTarget.GetHex());
     result.pushKV("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1);
     result.pushKV("mutable", aMutable);
@@ -907,8 +892,8 @@ static RPCHelpMan getblocktemplate()
         result.pushKV("signet_challenge", HexStr(consensusParams.signet_challenge));
     }
 
-    if (!pblocktemplate->vchCoinbaseCommitment.empty()) {
-        result.pushKV("default_witness_commitment", HexStr(pblocktemplate->vchCoinbaseCommitment));
+    if (!blocktemplate.vchCoinbaseCommitment.empty()) {
+        result.pushKV("default_witness_commitment", HexStr(blocktemplate.vchCoinbaseCommitment));
     }
 
     return result;
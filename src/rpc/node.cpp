@@ -22,6 +22,7 @@
 #include <util/check.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <validationinterface.h>
 
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
@@ -417,11 +418,46 @@ static RPCHelpMan getindexinfo()
     };
 }
 
+static RPCHelpMan getvalidationqueueinfo()
+{
+    return RPCHelpMan{"getvalidationqueueinfo",
+                "\nReturns how many validation notifications (new blocks, mempool changes, ...) are waiting to be delivered to\n"
+                "the node's subscribers, such as the wallets, the indexes and the ZMQ notifier. Every subscriber has its own queue.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "subscribers", "The number of subscribers"},
+                        {RPCResult::Type::NUM, "pending", "The number of notifications waiting in all queues"},
+                        {RPCResult::Type::NUM, "max_pending", "The number of notifications waiting for the subscriber that is furthest behind"},
+                        {RPCResult::Type::NUM, "peak_pending", "The largest number of notifications that waited in a single queue"},
+                        {RPCResult::Type::NUM, "delivered", "The number of notifications delivered to the current subscribers"},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getvalidationqueueinfo", "")
+                  + HelpExampleRpc("getvalidationqueueinfo", "")
+                },
+                [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const ValidationQueueInfo info{GetMainSignals().GetQueueInfo()};
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("subscribers", uint64_t(info.subscribers));
+    result.pushKV("pending", uint64_t(info.pending));
+    result.pushKV("max_pending", uint64_t(info.max_pending));
+    result.pushKV("peak_pending", uint64_t(info.peak_pending));
+    result.pushKV("delivered", info.delivered);
+    return result;
+},
+    };
+}
+
 void RegisterNodeRPCCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[]{
         {"control", &getmemoryinfo},
         {"control", &logging},
+        {"control", &getvalidationqueueinfo},
         {"util", &getindexinfo},
         {"hidden", &setmocktime},
         {"hidden", &mockscheduler},
@@ -8,7 +8,9 @@
 #define MYTHERRA_RPC_REQUEST_H
 
 #include <any>
+#include <functional>
 #include <string>
+#include <utility>
 
 #include <univalue.h>
 
@@ -26,6 +28,30 @@ void DeleteAuthCookie();
 /** Parse JSON-RPC batch reply into a vector */
 std::vector<UniValue> JSONRPCProcessBatchReply(const UniValue& in);
 
+/**
+ * Lets an RPC method send its result to the client in pieces while it is being
+ * serialized, instead of returning it as a single UniValue.
+ */
+class JSONRPCResultWriter
+{
+public:
+    explicit JSONRPCResultWriter(std::function<void(const std::string&)> write) : m_write{std::move(write)} {}
+
+    /** Append the next piece of the serialized result. Used() is still false while the first piece is written. */
+    void Write(const std::string& chunk)
+    {
+        m_write(chunk);
+        m_used = true;
+    }
+
+    /** Whether the method wrote its result here, rather than returning it. */
+    bool Used() const { return m_used; }
+
+private:
+    std::function<void(const std::string&)> m_write;
+    bool m_used{false};
+};
+
 class JSONRPCRequest
 {
 public:
@@ -37,6 +63,8 @@ public:
     std::string authUser;
     std::string peerAddr;
     std::any context;
+    /** Where the result may be streamed to, if the caller supports it (not owned). */
+    JSONRPCResultWriter* result_writer{nullptr};
 
     void parse(const UniValue& valRequest);
 };
@@ -15,11 +15,15 @@
 
 #include <boost/signals2/signal.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 static GlobalMutex g_rpc_warmup_mutex;
 static std::atomic<bool> g_rpc_running{false};
@@ -377,12 +381,56 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+/** Replies of a batch that is executed by several threads. */
+struct RPCBatchState
+{
+    std::vector<UniValue> replies;
+    //! Index of the next call to execute
+    std::atomic<size_t> next{0};
+    Mutex mutex;
+    std::condition_variable cond;
+    //! Number of calls whose reply is in replies
+    size_t done GUARDED_BY(mutex){0};
+
+    explicit RPCBatchState(size_t size) : replies(size) {}
+
+    /** Execute calls of the batch until none are left to start. */
+    void Run(const JSONRPCRequest& jreq, const UniValue& vReq) EXCLUSIVE_LOCKS_REQUIRED(!mutex)
+    {
+        for (size_t i; (i = next++) < replies.size();) {
+            replies[i] = JSONRPCExecOne(jreq, vReq[i]);
+            LOCK(mutex);
+            if (++done == replies.size()) cond.notify_all();
+        }
+    }
+};
+
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, int max_threads, const RPCTaskRunner& run_task)
 {
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    if (max_threads <= 1 || !run_task || vReq.size() < 2) {
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+        return ret.write() + "\n";
+    }
 
+    // Helpers may only get to run after the batch is complete. They keep the
+    // state alive, and only touch the request once they claimed a call, which
+    // cannot happen anymore by then.
+    const auto state{std::make_shared<RPCBatchState>(vReq.size())};
+    const size_t num_helpers{std::min<size_t>(max_threads - 1, vReq.size() - 1)};
+    for (size_t i = 0; i < num_helpers; ++i) {
+        if (!run_task([state, &jreq, &vReq] { state->Run(jreq, vReq); })) break;
+    }
+    state->Run(jreq, vReq);
+    {
+        WAIT_LOCK(state->mutex, lock);
+        state->cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(state->mutex) { return state->done == vReq.size(); });
+    }
+
+    for (UniValue& reply : state->replies) {
+        ret.push_back(std::move(reply));
+    }
     return ret.write() + "\n";
 }
 
@@ -18,6 +18,8 @@
 #include <univalue.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
+/** Default for -rpcbatchthreads, the number of threads that may execute the calls of one batch */
+static const int DEFAULT_RPC_BATCH_THREADS = 1;
 
 class CRPCCommand;
 
@@ -173,7 +175,19 @@ extern CRPCTable tableRPC;
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+/** Runs a task on another thread. Returns false if the task was not accepted. */
+using RPCTaskRunner = std::function<bool(std::function<void()> task)>;
+
+/**
+ * Execute the calls of a JSON-RPC batch and return the serialized array of
+ * their replies, in the order of the calls.
+ *
+ * With max_threads above 1, up to max_threads - 1 helper tasks are handed to
+ * run_task, and the calls are executed concurrently and in no particular order
+ * by this thread and the helpers. This thread executes any calls that no
+ * helper has started, so the batch completes even if the helpers never run.
+ */
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, int max_threads = 1, const RPCTaskRunner& run_task = {});
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
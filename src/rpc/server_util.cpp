@@ -6,6 +6,7 @@
 
 #include <net_processing.h>
 #include <node/context.h>
+#include <node/miner.h>
 #include <policy/fees.h>
 #include <rpc/protocol.h>
 #include <rpc/request.h>
@@ -107,3 +108,11 @@ PeerManager& EnsurePeerman(const NodeContext& node)
     }
     return *node.peerman;
 }
+
+node::BlockTemplateCache& EnsureBlockTemplateCache(const NodeContext& node)
+{
+    if (!node.block_template_cache) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block template cache not found");
+    }
+    return *node.block_template_cache;
+}
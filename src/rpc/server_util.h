@@ -15,6 +15,7 @@ class ChainstateManager;
 class PeerManager;
 class BanMan;
 namespace node {
+class BlockTemplateCache;
 struct NodeContext;
 } // namespace node
 
@@ -31,5 +32,6 @@ CBlockPolicyEstimator& EnsureFeeEstimator(const node::NodeContext& node);
 CBlockPolicyEstimator& EnsureAnyFeeEstimator(const std::any& context);
 CConnman& EnsureConnman(const node::NodeContext& node);
 PeerManager& EnsurePeerman(const node::NodeContext& node);
+node::BlockTemplateCache& EnsureBlockTemplateCache(const node::NodeContext& node);
 
 #endif // MYTHERRA_RPC_SERVER_UTIL_H
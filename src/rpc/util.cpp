@@ -568,7 +568,9 @@ UniValue RPCHelpMan::HandleRequest(const JSONRPCRequest& request) const
         throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Wrong type passed:\n%s", arg_mismatch.write(4)));
     }
     UniValue ret = m_fun(*this, request);
-    if (gArgs.GetBoolArg("-rpcdoccheck", DEFAULT_RPC_DOC_CHECK)) {
+    // A streamed result never exists as a whole, so it cannot be checked.
+    const bool streamed{request.result_writer && request.result_writer->Used()};
+    if (!streamed && gArgs.GetBoolArg("-rpcdoccheck", DEFAULT_RPC_DOC_CHECK)) {
         UniValue mismatch{UniValue::VARR};
         for (const auto& res : m_results.m_results) {
             UniValue match{res.MatchesType(ret)};
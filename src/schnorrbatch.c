@@ -0,0 +1,190 @@
+// Copyright (c) 2026 The Mytherra developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <schnorrbatch.h>
+
+#include <secp256k1_schnorrsig.h>
+
+// The field, group and multi-scalar multiplication code of libsecp256k1 is
+// internal and made of static functions, so it is compiled into this file,
+// the way the library's own modules use it. The precomputed tables for the
+// generator are shared with the library, which must be built with the same
+// ECMULT_WINDOW_SIZE (the default). Not every included function is used.
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "secp256k1/src/assumptions.h"
+#include "secp256k1/src/util.h"
+#include "secp256k1/src/field_impl.h"
+#include "secp256k1/src/scalar_impl.h"
+#include "secp256k1/src/group_impl.h"
+#include "secp256k1/src/ecmult_impl.h"
+#include "secp256k1/src/hash_impl.h"
+#include "secp256k1/src/int128_impl.h"
+#include "secp256k1/src/scratch_impl.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include <stdint.h>
+
+static void schnorrbatch_error_fn(const char* str, void* data)
+{
+    (void)data;
+    fprintf(stderr, "[schnorrbatch] internal consistency check failed: %s\n", str);
+    abort();
+}
+
+static const secp256k1_callback schnorrbatch_error_callback = {schnorrbatch_error_fn, NULL};
+
+static const unsigned char schnorrbatch_tag_challenge[17] = "BIP0340/challenge";
+static const unsigned char schnorrbatch_tag_batch[13] = "BIP0340/batch";
+
+typedef struct {
+    const unsigned char* const* sigs64;
+    const unsigned char* const* msgs32;
+    // The x coordinates of the public keys, serialized.
+    const unsigned char* pubkeys32;
+    unsigned char seed[32];
+    // The randomizer of the last signature the callback was called for, as it
+    // is called for R_i and P_i right after each other.
+    size_t last_i;
+    secp256k1_scalar last_a;
+} schnorrbatch_data;
+
+// Derive the randomizer a_i of signature i. a_0 is 1, the others come from a
+// hash of all batch inputs, so whoever created the signatures can't predict
+// them.
+static void schnorrbatch_randomizer(secp256k1_scalar* a, const unsigned char* seed32, size_t i)
+{
+    unsigned char buf[32];
+    unsigned char idx[8];
+    secp256k1_sha256 sha;
+    int j;
+
+    if (i == 0) {
+        secp256k1_scalar_set_int(a, 1);
+        return;
+    }
+    for (j = 0; j < 8; j++) {
+        idx[j] = (unsigned char)(((uint64_t)i) >> (8 * j));
+    }
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, seed32, 32);
+    secp256k1_sha256_write(&sha, idx, sizeof(idx));
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(a, buf, NULL);
+}
+
+// The BIP340 challenge e = hash_BIP0340/challenge(r || P || m) mod n.
+static void schnorrbatch_challenge(secp256k1_scalar* e, const unsigned char* r32, const unsigned char* msg32, const unsigned char* pubkey32)
+{
+    unsigned char buf[32];
+    secp256k1_sha256 sha;
+
+    secp256k1_sha256_initialize_tagged(&sha, schnorrbatch_tag_challenge, sizeof(schnorrbatch_tag_challenge));
+    secp256k1_sha256_write(&sha, r32, 32);
+    secp256k1_sha256_write(&sha, pubkey32, 32);
+    secp256k1_sha256_write(&sha, msg32, 32);
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(e, buf, NULL);
+}
+
+// Provide the points of the batch equation to secp256k1_ecmult_multi_var:
+// point 2*i is R_i with scalar a_i, point 2*i+1 is P_i with scalar a_i*e_i.
+static int schnorrbatch_callback(secp256k1_scalar* sc, secp256k1_ge* pt, size_t idx, void* cbdata)
+{
+    schnorrbatch_data* data = (schnorrbatch_data*)cbdata;
+    const size_t i = idx / 2;
+    const unsigned char* sig64 = data->sigs64[i];
+    const unsigned char* pubkey32 = &data->pubkeys32[32 * i];
+    secp256k1_fe x;
+
+    if (data->last_i != i) {
+        schnorrbatch_randomizer(&data->last_a, data->seed, i);
+        data->last_i = i;
+    }
+    *sc = data->last_a;
+    if (idx % 2 == 0) {
+        // R_i is the point with x coordinate r and even y.
+        return secp256k1_fe_set_b32(&x, &sig64[0]) && secp256k1_ge_set_xo_var(pt, &x, 0);
+    } else {
+        secp256k1_scalar e;
+        // P_i is the point with the x coordinate of the key and even y.
+        if (!secp256k1_fe_set_b32(&x, pubkey32) || !secp256k1_ge_set_xo_var(pt, &x, 0)) {
+            return 0;
+        }
+        schnorrbatch_challenge(&e, &sig64[0], data->msgs32[i], pubkey32);
+        secp256k1_scalar_mul(sc, sc, &e);
+        return 1;
+    }
+}
+
+int mytherra_schnorrsig_verify_batch(secp256k1_scratch_space* scratch, const unsigned char* const* sigs64, const unsigned char* const* msgs32, const secp256k1_xonly_pubkey* const* pubkeys, size_t n)
+{
+    schnorrbatch_data data;
+    unsigned char* pubkeys32;
+    secp256k1_scalar sum_s;
+    secp256k1_gej rj;
+    secp256k1_sha256 sha;
+    size_t i;
+    int ret;
+
+    if (n == 0) {
+        return 1;
+    }
+    if (n == 1) {
+        // Nothing to gain from batching a single signature.
+        return secp256k1_schnorrsig_verify(secp256k1_context_static, sigs64[0], msgs32[0], 32, pubkeys[0]);
+    }
+    if (n > SIZE_MAX / 64) {
+        return 0;
+    }
+    pubkeys32 = (unsigned char*)malloc(32 * n);
+    if (pubkeys32 == NULL) {
+        return 0;
+    }
+
+    // Seed the randomizers with a hash of every input of the batch.
+    secp256k1_sha256_initialize_tagged(&sha, schnorrbatch_tag_batch, sizeof(schnorrbatch_tag_batch));
+    for (i = 0; i < n; i++) {
+        if (!secp256k1_xonly_pubkey_serialize(secp256k1_context_static, &pubkeys32[32 * i], pubkeys[i])) {
+            free(pubkeys32);
+            return 0;
+        }
+        secp256k1_sha256_write(&sha, sigs64[i], 64);
+        secp256k1_sha256_write(&sha, &pubkeys32[32 * i], 32);
+        secp256k1_sha256_write(&sha, msgs32[i], 32);
+    }
+    secp256k1_sha256_finalize(&sha, data.seed);
+
+    // Compute sum_s = -sum(a_i * s_i).
+    secp256k1_scalar_set_int(&sum_s, 0);
+    for (i = 0; i < n; i++) {
+        secp256k1_scalar a;
+        secp256k1_scalar s;
+        int overflow;
+        secp256k1_scalar_set_b32(&s, &sigs64[i][32], &overflow);
+        if (overflow) {
+            free(pubkeys32);
+            return 0;
+        }
+        schnorrbatch_randomizer(&a, data.seed, i);
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&sum_s, &sum_s, &s);
+    }
+    secp256k1_scalar_negate(&sum_s, &sum_s);
+
+    // The batch is valid iff -sum(a_i*s_i)*G + sum(a_i*R_i) + sum(a_i*e_i*P_i)
+    // is the point at infinity.
+    data.sigs64 = sigs64;
+    data.msgs32 = msgs32;
+    data.pubkeys32 = pubkeys32;
+    data.last_i = SIZE_MAX;
+    ret = secp256k1_ecmult_multi_var(&schnorrbatch_error_callback, scratch, &rj, &sum_s, schnorrbatch_callback, &data, 2 * n) &&
+          secp256k1_gej_is_infinity(&rj);
+    free(pubkeys32);
+    return ret;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2026 The Mytherra developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MYTHERRA_SCHNORRBATCH_H
+#define MYTHERRA_SCHNORRBATCH_H
+
+#include <secp256k1.h>
+#include <secp256k1_extrakeys.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Verify a batch of BIP340 signatures over 32-byte messages at once.
+ *
+ *  This checks the randomized BIP340 batch equation with one multi-scalar
+ *  multiplication. It is faster than verifying the signatures one by one, but
+ *  only tells whether all of them are valid.
+ *
+ *  It lives outside the libsecp256k1 subtree, which has no batch API, and is
+ *  built on that library's internal field, group and multiplication code.
+ *
+ *  Returns: 1: all signatures are valid (or n is 0)
+ *           0: at least one signature is invalid
+ *  Args: scratch: scratch space for the multiplication, from
+ *                 secp256k1_scratch_space_create. If NULL or too small, a
+ *                 slower algorithm is used.
+ *  In:    sigs64: array of n pointers to 64-byte signatures.
+ *         msgs32: array of n pointers to 32-byte messages.
+ *        pubkeys: array of n pointers to x-only public keys.
+ *              n: number of signatures in the batch.
+ */
+int mytherra_schnorrsig_verify_batch(
+    secp256k1_scratch_space* scratch,
+    const unsigned char* const* sigs64,
+    const unsigned char* const* msgs32,
+    const secp256k1_xonly_pubkey* const* pubkeys,
+    size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MYTHERRA_SCHNORRBATCH_H
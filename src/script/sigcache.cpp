@@ -13,6 +13,7 @@
 #include <cuckoocache.h>
 
 #include <algorithm>
+#include <cassert>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
@@ -126,3 +127,36 @@ bool CachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsig
     if (store) signatureCache.Set(entry);
     return true;
 }
+
+void SchnorrBatchVerifier::Add(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash)
+{
+    assert(sig.size() == 64);
+    SchnorrSignatureCheck check{pubkey, sighash, {}};
+    std::copy(sig.begin(), sig.end(), check.sig.begin());
+    LOCK(m_mutex);
+    m_checks.push_back(std::move(check));
+}
+
+size_t SchnorrBatchVerifier::Size() const
+{
+    LOCK(m_mutex);
+    return m_checks.size();
+}
+
+bool SchnorrBatchVerifier::Verify() const
+{
+    LOCK(m_mutex);
+    if (VerifySchnorrBatch(m_checks)) return true;
+    return std::all_of(m_checks.begin(), m_checks.end(), [](const SchnorrSignatureCheck& check) {
+        return check.pubkey.VerifySchnorr(check.msg, check.sig);
+    });
+}
+
+bool BatchingCachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const
+{
+    uint256 entry;
+    signatureCache.ComputeEntrySchnorr(entry, sighash, sig, pubkey);
+    if (signatureCache.Get(entry, !store)) return true;
+    m_batch.Add(sig, pubkey, sighash);
+    return true;
+}
@@ -6,8 +6,10 @@
 #ifndef MYTHERRA_SCRIPT_SIGCACHE_H
 #define MYTHERRA_SCRIPT_SIGCACHE_H
 
+#include <pubkey.h>
 #include <script/interpreter.h>
 #include <span.h>
+#include <sync.h>
 #include <util/hasher.h>
 
 #include <optional>
@@ -22,7 +24,7 @@ class CPubKey;
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
-private:
+protected:
     bool store;
 
 public:
@@ -32,6 +34,46 @@ public:
     bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
 };
 
+/**
+ * Collects Schnorr signature checks from many script checks, so that they can
+ * be verified together with a single batch verification. Thread safe, so it
+ * can be shared by all script check threads validating a block.
+ */
+class SchnorrBatchVerifier
+{
+private:
+    mutable Mutex m_mutex;
+    std::vector<SchnorrSignatureCheck> m_checks GUARDED_BY(m_mutex);
+
+public:
+    void Add(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    size_t Size() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Verify all collected signatures. If the batch fails, every signature is
+     *  checked individually, so the result is always the same as verifying
+     *  them one by one. */
+    bool Verify() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+/**
+ * Signature checker which defers Schnorr signature checks that miss the
+ * signature cache to a SchnorrBatchVerifier, assuming them valid. A script
+ * that passes with this checker is only valid once the batch verifies.
+ *
+ * This is sound because a Schnorr signature that is checked at all must be
+ * valid (BIP341/BIP342), so an invalid one fails the whole script anyway.
+ */
+class BatchingCachingTransactionSignatureChecker : public CachingTransactionSignatureChecker
+{
+private:
+    SchnorrBatchVerifier& m_batch;
+
+public:
+    BatchingCachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn, SchnorrBatchVerifier& batch) : CachingTransactionSignatureChecker(txToIn, nInIn, amountIn, storeIn, txdataIn), m_batch(batch) {}
+
+    bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
+};
+
 [[nodiscard]] bool InitSignatureCache(size_t max_size_bytes);
 
 #endif // MYTHERRA_SCRIPT_SIGCACHE_H
@@ -12,6 +12,7 @@
 #include <pow.h>
 #include <script/standard.h>
 #include <test/util/blockfilter.h>
+#include <test/util/mining.h>
 #include <test/util/setup_common.h>
 #include <util/time.h>
 #include <validation.h>
@@ -273,6 +274,95 @@ BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, BuildChainTestingSetup)
     filter_index.Stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_parallel_sync, TestingSetup)
+{
+    for (int i = 0; i < 12; ++i) {
+        MineBlock(m_node, CScript() << OP_TRUE);
+    }
+
+    // Filters prepared on several threads are appended and chained in order.
+    BlockFilterIndex filter_index(interfaces::MakeChain(m_node), BlockFilterType::BASIC, 1 << 20, true);
+    filter_index.SetSyncThreads(4);
+    BOOST_REQUIRE(filter_index.Start());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    uint256 last_header;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* block_index{m_node.chainman->ActiveChain().Genesis()};
+             block_index != nullptr;
+             block_index = m_node.chainman->ActiveChain().Next(block_index)) {
+            CheckFilterLookups(filter_index, block_index, last_header);
+        }
+    }
+
+    // Ranges are read in one pass over the filter files, or served from the
+    // cache of recently served filters.
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip())};
+    for (int start_height : {0, 0, 5, 1}) {
+        std::vector<BlockFilter> filters;
+        BOOST_REQUIRE(filter_index.LookupFilterRange(start_height, tip, filters));
+        BOOST_REQUIRE_EQUAL(filters.size(), size_t(tip->nHeight - start_height + 1));
+        for (const CBlockIndex* block_index{tip}; block_index->nHeight >= start_height; block_index = block_index->pprev) {
+            BlockFilter expected_filter;
+            BOOST_REQUIRE(ComputeFilter(filter_index.GetFilterType(), block_index, expected_filter));
+            BOOST_CHECK_EQUAL(filters[block_index->nHeight - start_height].GetHash(), expected_filter.GetHash());
+            if (block_index->nHeight == 0) break;
+        }
+    }
+
+    filter_index.Interrupt();
+    filter_index.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_identical_filters, TestingSetup)
+{
+    // Blocks that only pay to empty scripts have the same, empty filter.
+    for (int i = 0; i < 2; ++i) {
+        MineBlock(m_node, CScript());
+    }
+
+    BlockFilterIndex filter_index(interfaces::MakeChain(m_node), BlockFilterType::BASIC, 1 << 20, true);
+    BOOST_REQUIRE(filter_index.Start());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    // Cached filters are served with the hash of the block they were requested for.
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip())};
+    for (int i = 0; i < 2; ++i) {
+        for (const CBlockIndex* block_index : std::vector<const CBlockIndex*>{tip->pprev, tip}) {
+            BlockFilter filter;
+            BOOST_REQUIRE(filter_index.LookupFilter(block_index, filter));
+            BOOST_CHECK_EQUAL(filter.GetBlockHash(), block_index->GetBlockHash());
+        }
+    }
+    BlockFilter prev_filter;
+    BlockFilter tip_filter;
+    BOOST_REQUIRE(filter_index.LookupFilter(tip->pprev, prev_filter));
+    BOOST_REQUIRE(filter_index.LookupFilter(tip, tip_filter));
+    BOOST_CHECK_EQUAL(prev_filter.GetHash(), tip_filter.GetHash());
+
+    std::vector<BlockFilter> filters;
+    BOOST_REQUIRE(filter_index.LookupFilterRange(tip->pprev->nHeight, tip, filters));
+    BOOST_REQUIRE_EQUAL(filters.size(), 2U);
+    BOOST_CHECK_EQUAL(filters[0].GetBlockHash(), tip->pprev->GetBlockHash());
+    BOOST_CHECK_EQUAL(filters[1].GetBlockHash(), tip->GetBlockHash());
+
+    filter_index.Interrupt();
+    filter_index.Stop();
+}
+
 BOOST_FIXTURE_TEST_CASE(blockfilter_index_init_destroy, BasicTestingSetup)
 {
     BlockFilterIndex* filter_index;
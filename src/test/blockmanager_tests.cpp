@@ -5,15 +5,25 @@
 #include <chainparams.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
+#include <pow.h>
+#include <streams.h>
+#include <txdb.h>
 #include <validation.h>
 
 #include <boost/test/unit_test.hpp>
 #include <test/util/setup_common.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 using node::BlockManager;
 using node::BLOCK_SERIALIZATION_HEADER_SIZE;
 using node::MAX_BLOCKFILE_SIZE;
 using node::OpenBlockFile;
+using node::RawBlock;
+using node::ReadBlockFromDisk;
+using node::ReadRawBlockFromDisk;
 
 // use BasicTestingSetup here for the data directory configuration, setup, and cleanup
 BOOST_FIXTURE_TEST_SUITE(blockmanager_tests, BasicTestingSetup)
@@ -41,6 +51,91 @@ BOOST_AUTO_TEST_CASE(blockmanager_find_block_pos)
     BOOST_CHECK_EQUAL(actual.nPos, BLOCK_SERIALIZATION_HEADER_SIZE + ::GetSerializeSize(params->GenesisBlock(), CLIENT_VERSION) + BLOCK_SERIALIZATION_HEADER_SIZE);
 }
 
+BOOST_AUTO_TEST_CASE(blockmanager_read_mapped_block)
+{
+    const auto params{CreateChainParams(ArgsManager{}, CBaseChainParams::MAIN)};
+    const CBlock& genesis{params->GenesisBlock()};
+    CDataStream expected{SER_DISK, CLIENT_VERSION};
+    expected << genesis;
+    {
+        CAutoFile file{OpenBlockFile(FlatFilePos{0, 0}), SER_DISK, CLIENT_VERSION};
+        file << params->MessageStart() << uint32_t(expected.size()) << genesis;
+    }
+    const FlatFilePos pos{0, BLOCK_SERIALIZATION_HEADER_SIZE};
+
+    // The last block file may still be written to, so it is read and copied.
+    RawBlock raw1, raw2;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw1, pos, params->MessageStart()));
+    BOOST_CHECK(ReadRawBlockFromDisk(raw2, pos, params->MessageStart()));
+    BOOST_CHECK(MakeByteSpan(raw1.Data()) == MakeByteSpan(expected));
+    BOOST_CHECK(raw1.Data().data() != raw2.Data().data());
+
+    // Once the next block file exists, the block is served from a mapping of the file.
+    BOOST_CHECK(!AutoFile{OpenBlockFile(FlatFilePos{1, 0})}.IsNull());
+    BOOST_CHECK(ReadRawBlockFromDisk(raw1, pos, params->MessageStart()));
+    BOOST_CHECK(ReadRawBlockFromDisk(raw2, pos, params->MessageStart()));
+    BOOST_CHECK(MakeByteSpan(raw1.Data()) == MakeByteSpan(expected));
+#ifndef WIN32
+    if (sizeof(void*) >= 8) BOOST_CHECK(raw1.Data().data() == raw2.Data().data());
+#endif
+
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pos, params->GetConsensus()));
+    BOOST_CHECK_EQUAL(block.GetHash(), genesis.GetHash());
+
+    // A wrong message start is still detected.
+    CMessageHeader::MessageStartChars wrong_start{};
+    BOOST_CHECK(!ReadRawBlockFromDisk(raw1, pos, wrong_start));
+}
+
+BOOST_AUTO_TEST_CASE(blockmanager_load_block_index)
+{
+    const auto params{CreateChainParams(ArgsManager{}, CBaseChainParams::REGTEST)};
+    const Consensus::Params& consensus{params->GetConsensus()};
+    LOCK(::cs_main);
+
+    // Write a chain of headers with a fork to the block tree database. There
+    // are enough headers for every key range of the database to be used.
+    BlockManager writer{{}};
+    writer.m_block_tree_db = std::make_unique<CBlockTreeDB>(DBParams{.path = "", .cache_bytes = 1 << 20, .memory_only = true});
+    CBlockIndex* best_header{nullptr};
+    const auto add_header{[&](const CBlockHeader& prev) {
+        CBlockHeader header{prev};
+        header.hashPrevBlock = prev.GetHash();
+        header.nTime += 1;
+        while (!CheckProofOfWork(header.GetHash(), header.nBits, consensus)) ++header.nNonce;
+        writer.AddToBlockIndex(header, best_header);
+        return header;
+    }};
+    CBlockHeader tip{params->GenesisBlock()};
+    writer.AddToBlockIndex(tip, best_header);
+    CBlockHeader fork;
+    for (int i = 1; i < 1000; ++i) {
+        tip = add_header(tip);
+        if (i == 500) fork = tip;
+    }
+    for (int i = 0; i < 10; ++i) {
+        fork = add_header(fork);
+    }
+    BOOST_REQUIRE(writer.WriteBlockIndexDB());
+
+    BlockManager reader{{}};
+    reader.m_block_tree_db = std::move(writer.m_block_tree_db);
+    BOOST_REQUIRE(reader.LoadBlockIndexDB(consensus));
+    BOOST_REQUIRE_EQUAL(reader.m_block_index.size(), writer.m_block_index.size());
+    for (const auto& [hash, written] : writer.m_block_index) {
+        const CBlockIndex* loaded{reader.LookupBlockIndex(hash)};
+        BOOST_REQUIRE(loaded);
+        BOOST_CHECK_EQUAL(loaded->nHeight, written.nHeight);
+        BOOST_CHECK_EQUAL(loaded->pprev ? loaded->pprev->GetBlockHash() : uint256{}, written.pprev ? written.pprev->GetBlockHash() : uint256{});
+        BOOST_CHECK(loaded->nChainWork == written.nChainWork);
+    }
+
+    const std::vector<CBlockIndex*> by_height{reader.GetAllBlockIndicesByHeight()};
+    BOOST_REQUIRE_EQUAL(by_height.size(), reader.m_block_index.size());
+    BOOST_CHECK(std::is_sorted(by_height.begin(), by_height.end(), node::CBlockIndexHeightOnlyComparator()));
+}
+
 BOOST_FIXTURE_TEST_CASE(blockmanager_scan_unlink_already_pruned_files, TestChain100Setup)
 {
     // Cap last block file size, and mine new block in a new block file.
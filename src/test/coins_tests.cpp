@@ -13,6 +13,7 @@
 #include <undo.h>
 #include <util/strencodings.h>
 
+#include <atomic>
 #include <map>
 #include <vector>
 
@@ -612,7 +613,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags, const C
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
@@ -965,8 +967,8 @@ void TestFlushBehavior(
         //
         flush_all(/*erase=*/ true);
 
-        // Memory usage should have gone down.
-        BOOST_CHECK(view->DynamicMemoryUsage() < cache_usage);
+        // Memory does not necessarily go down due to the map using a memory pool
+        BOOST_CHECK(view->DynamicMemoryUsage() <= cache_usage);
 
         // --- 5. Ensuring the entry is no longer in the cache
         //
@@ -1076,4 +1078,105 @@ BOOST_AUTO_TEST_CASE(ccoins_flush_behavior)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_prefetched_coin)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    CCoinsViewCacheTest cache{&base};
+    const COutPoint outp{InsecureRand256(), 0};
+
+    Coin coin = MakeCoin();
+    const CAmount coin_val{coin.out.nValue};
+    const size_t coin_usage{coin.DynamicMemoryUsage()};
+    cache.AddPrefetchedCoin(outp, std::move(coin));
+
+    // A prefetched coin is cached clean, exactly as if it had been fetched.
+    CAmount value;
+    char flags;
+    GetCoinsMapEntry(cache.map(), value, flags, outp);
+    BOOST_CHECK_EQUAL(value, coin_val);
+    BOOST_CHECK_EQUAL(flags, 0);
+    BOOST_CHECK_EQUAL(cache.usage(), coin_usage);
+
+    // An outpoint that is already cached is left untouched.
+    cache.AddPrefetchedCoin(outp, MakeCoin());
+    GetCoinsMapEntry(cache.map(), value, flags, outp);
+    BOOST_CHECK_EQUAL(value, coin_val);
+    BOOST_CHECK_EQUAL(cache.usage(), coin_usage);
+    cache.SelfTest();
+
+    // Clean entries are not written to the base on flush.
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!base.HaveCoinInCache(outp));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_background_flush)
+{
+    CCoinsViewDB base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    CCoinsViewCacheTest cache{&base};
+    const COutPoint spent{InsecureRand256(), 0};
+    const COutPoint clean{InsecureRand256(), 0};
+    const COutPoint added{InsecureRand256(), 0};
+
+    cache.AddCoin(spent, MakeCoin(), /*possible_overwrite=*/false);
+    cache.AddCoin(clean, MakeCoin(), /*possible_overwrite=*/false);
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+
+    // Modify the cache on top of the database.
+    BOOST_CHECK(cache.SpendCoin(spent));
+    BOOST_CHECK(cache.HaveCoin(clean));
+    cache.AddCoin(added, MakeCoin(), /*possible_overwrite=*/false);
+    const uint256 best_block{InsecureRand256()};
+    cache.SetBestBlock(best_block);
+
+    // Only the modified entries are moved; the unmodified one stays cached.
+    auto write{std::make_unique<PendingCoinsWrite>()};
+    write->best_block = best_block;
+    cache.MoveDirtyCoins(write->coins, std::numeric_limits<size_t>::max());
+    BOOST_CHECK_EQUAL(write->coins.size(), 2U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    BOOST_CHECK(cache.HaveCoinInCache(clean));
+    cache.SelfTest();
+
+    // The database serves the moved entries while and after they are written.
+    std::atomic<bool> written{false};
+    base.BatchWriteInBackground(std::move(write), [&] { written = true; });
+    // Until it is committed, the write counts as cache memory.
+    BOOST_CHECK(base.PendingMemoryUsage() > 0 || written);
+    BOOST_CHECK(!cache.HaveCoin(spent));
+    BOOST_CHECK(cache.HaveCoin(added));
+    BOOST_CHECK(base.GetBestBlock() == best_block);
+    // Other threads can wait for the coins of the block to be committed.
+    BOOST_CHECK(base.WaitForCommitted(best_block));
+    BOOST_CHECK(!base.GetBackgroundWriteProgress().in_progress);
+    BOOST_CHECK(base.WaitForBackgroundWrite());
+    BOOST_CHECK(written);
+    BOOST_CHECK_EQUAL(base.PendingMemoryUsage(), 0U);
+    CoinsWriteProgress progress{base.GetBackgroundWriteProgress()};
+    BOOST_CHECK(!progress.in_progress);
+    BOOST_CHECK_EQUAL(progress.coins_written, 2U);
+    BOOST_CHECK_EQUAL(progress.coins_total, 2U);
+    BOOST_CHECK(!base.HaveCoin(spent));
+    BOOST_CHECK(base.HaveCoin(added));
+    BOOST_CHECK(base.GetBestBlock() == best_block);
+
+    // A synchronous write reports its own progress.
+    BOOST_CHECK(cache.SpendCoin(added));
+    const size_t cache_size{cache.GetCacheSize()};
+    BOOST_CHECK(cache.Flush());
+    progress = base.GetBackgroundWriteProgress();
+    BOOST_CHECK_EQUAL(progress.coins_written, cache_size);
+    BOOST_CHECK_EQUAL(progress.coins_total, cache_size);
+
+    // Without room, the unmodified entries are dropped as well.
+    CCoinsMapMemoryResource resource;
+    CCoinsMap coins{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+    cache.MoveDirtyCoins(coins, 0);
+    BOOST_CHECK(coins.empty());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK_EQUAL(cache.usage(), 0U);
+    cache.SelfTest();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -119,6 +119,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getblocktemplate",
     "getchaintips",
     "getchaintxstats",
+    "getcoinsflushinfo",
     "getconnectioncount",
     "getdeploymentinfo",
     "getdescriptorinfo",
@@ -141,6 +142,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getrpcinfo",
     "gettxout",
     "gettxoutsetinfo",
+    "getvalidationqueueinfo",
     "help",
     "invalidateblock",
     "joinpsbts",
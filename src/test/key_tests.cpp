@@ -5,6 +5,7 @@
 #include <key.h>
 
 #include <key_io.h>
+#include <script/sigcache.h>
 #include <streams.h>
 #include <test/util/random.h>
 #include <test/util/setup_common.h>
@@ -344,4 +345,43 @@ BOOST_AUTO_TEST_CASE(bip340_test_vectors)
     }
 }
 
+BOOST_AUTO_TEST_CASE(bip340_batch_verify)
+{
+    std::vector<SchnorrSignatureCheck> checks;
+    for (int i = 0; i < 20; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        SchnorrSignatureCheck check{XOnlyPubKey(key.GetPubKey()), InsecureRand256(), {}};
+        BOOST_CHECK(key.SignSchnorr(check.msg, check.sig, nullptr, InsecureRand256()));
+        checks.push_back(check);
+    }
+    BOOST_CHECK(VerifySchnorrBatch({}));
+    BOOST_CHECK(VerifySchnorrBatch(Span{checks}.first(1)));
+    BOOST_CHECK(VerifySchnorrBatch(checks));
+
+    SchnorrBatchVerifier batch;
+    for (const auto& check : checks) batch.Add(check.sig, check.pubkey, check.msg);
+    BOOST_CHECK_EQUAL(batch.Size(), checks.size());
+    BOOST_CHECK(batch.Verify());
+
+    // A single invalid signature, message or key makes the whole batch fail.
+    for (size_t i : {size_t{0}, checks.size() - 1}) {
+        auto bad_sig{checks};
+        bad_sig[i].sig[InsecureRandRange(64)] ^= 1 << InsecureRandRange(8);
+        BOOST_CHECK(!VerifySchnorrBatch(bad_sig));
+
+        auto bad_msg{checks};
+        bad_msg[i].msg = InsecureRand256();
+        BOOST_CHECK(!VerifySchnorrBatch(bad_msg));
+
+        auto bad_key{checks};
+        std::swap(bad_key[i].pubkey, bad_key[(i + 1) % checks.size()].pubkey);
+        BOOST_CHECK(!VerifySchnorrBatch(bad_key));
+
+        SchnorrBatchVerifier bad_batch;
+        for (const auto& check : bad_msg) bad_batch.Add(check.sig, check.pubkey, check.msg);
+        BOOST_CHECK(!bad_batch.Verify());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,8 +9,10 @@
 #include <util/string.h>
 
 #include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -46,6 +48,8 @@ struct LogSetup : public BasicTestingSetup {
                  prev_category_levels{LogInstance().CategoryLevels()},
                  prev_log_level{LogInstance().LogLevel()}
     {
+        // Messages of the fixture still waiting for the writer thread belong in the previous log file.
+        LogInstance().Flush();
         LogInstance().m_file_path = tmp_log_path;
         LogInstance().m_reopen_file = true;
         LogInstance().m_print_to_file = true;
@@ -61,6 +65,7 @@ struct LogSetup : public BasicTestingSetup {
 
     ~LogSetup()
     {
+        LogInstance().Flush();
         LogInstance().m_file_path = prev_log_path;
         LogPrintf("Sentinel log to reopen log file\n");
         LogInstance().m_print_to_file = prev_print_to_file;
@@ -87,6 +92,7 @@ BOOST_FIXTURE_TEST_CASE(logging_LogPrintf_, LogSetup)
     LogPrintf_("fn2", "src2", 2, BCLog::LogFlags::NET, BCLog::Level::None, "foo2: %s", "bar2\n");
     LogPrintf_("fn3", "src3", 3, BCLog::LogFlags::NONE, BCLog::Level::Debug, "foo3: %s", "bar3\n");
     LogPrintf_("fn4", "src4", 4, BCLog::LogFlags::NONE, BCLog::Level::None, "foo4: %s", "bar4\n");
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -110,6 +116,7 @@ BOOST_FIXTURE_TEST_CASE(logging_LogPrintMacros, LogSetup)
     LogPrintLevel(BCLog::NET, BCLog::Level::Warning, "foo9: %s\n", "bar9");
     LogPrintLevel(BCLog::NET, BCLog::Level::Error, "foo10: %s\n", "bar10");
     LogPrintfCategory(BCLog::VALIDATION, "foo11: %s\n", "bar11");
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -149,6 +156,7 @@ BOOST_FIXTURE_TEST_CASE(logging_LogPrintMacros_CategoryName, LogSetup)
         expected.push_back(expected_log);
     }
 
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -182,6 +190,7 @@ BOOST_FIXTURE_TEST_CASE(logging_SeverityLevels, LogSetup)
         "[net:warning] foo5: bar5",
         "[net:error] foo7: bar7",
     };
+    LogInstance().Flush();
     std::ifstream file{tmp_log_path};
     std::vector<std::string> log_lines;
     for (std::string log; std::getline(file, log);) {
@@ -245,4 +254,136 @@ BOOST_FIXTURE_TEST_CASE(logging_Conf, LogSetup)
     }
 }
 
+BOOST_AUTO_TEST_CASE(logging_RingBuffer)
+{
+    BCLog::LogRingBuffer ring{4};
+    std::string out;
+    BOOST_CHECK(ring.Empty());
+    BOOST_CHECK(!ring.TryPop(out));
+
+    // The buffer takes messages until it is full, and hands them out in order.
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            std::string message{strprintf("%d.%d\n", round, i)};
+            BOOST_CHECK(ring.TryPush(message));
+        }
+        std::string message{"full\n"};
+        BOOST_CHECK(!ring.TryPush(message));
+        BOOST_CHECK_EQUAL(message, "full\n");
+        BOOST_CHECK_EQUAL(ring.Pushed(), uint64_t(4 * (round + 1)));
+
+        out.clear();
+        while (ring.TryPop(out)) {}
+        BOOST_CHECK_EQUAL(out, strprintf("%d.0\n%d.1\n%d.2\n%d.3\n", round, round, round, round));
+        BOOST_CHECK(ring.Empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(logging_RingBuffer_threads)
+{
+    constexpr int NUM_THREADS{4};
+    constexpr int MESSAGES_PER_THREAD{20000};
+    BCLog::LogRingBuffer ring{64};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&ring, t] {
+            for (int i = 0; i < MESSAGES_PER_THREAD; ++i) {
+                std::string message{strprintf("%d %d\n", t, i)};
+                while (!ring.TryPush(message)) std::this_thread::yield();
+            }
+        });
+    }
+
+    // Every thread's messages come out complete and in the order it added them.
+    std::vector<int> next(NUM_THREADS, 0);
+    int received{0};
+    std::string out;
+    while (received < NUM_THREADS * MESSAGES_PER_THREAD) {
+        out.clear();
+        if (!ring.TryPop(out)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int t, i;
+        BOOST_REQUIRE_EQUAL(sscanf(out.c_str(), "%d %d\n", &t, &i), 2);
+        BOOST_REQUIRE(t >= 0 && t < NUM_THREADS);
+        BOOST_REQUIRE_EQUAL(i, next[t]);
+        ++next[t];
+        ++received;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK(ring.Empty());
+    BOOST_CHECK_EQUAL(ring.Pushed(), uint64_t{NUM_THREADS * MESSAGES_PER_THREAD});
+}
+
+BOOST_AUTO_TEST_CASE(logging_async_stop)
+{
+    constexpr int NUM_THREADS{4};
+    constexpr int MESSAGES_PER_THREAD{5000};
+    const fs::path log_path{m_args.GetDataDirBase() / "async_debug.log"};
+    BCLog::Logger logger;
+    logger.m_file_path = log_path;
+    logger.m_print_to_file = true;
+    logger.m_async_output = true;
+    logger.m_log_timestamps = false;
+    logger.m_log_threadnames = false;
+    logger.m_log_sourcelocations = false;
+    BOOST_REQUIRE(logger.StartLogging());
+
+    // Messages logged while the writer thread stops are all written, either
+    // by the writer thread or by the logging thread.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&logger, t] {
+            for (int i = 0; i < MESSAGES_PER_THREAD; ++i) {
+                logger.LogPrintStr(strprintf("%d %d\n", t, i), "fn", "src", 1, BCLog::LogFlags::NONE, BCLog::Level::Info);
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    logger.StopWriterThread();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    logger.DisconnectTestLogger();
+
+    std::ifstream file{log_path};
+    std::vector<int> next(NUM_THREADS, 0);
+    for (std::string line; std::getline(file, line);) {
+        if (line.empty()) continue;
+        int t, i;
+        BOOST_REQUIRE_EQUAL(sscanf(line.c_str(), "[info] %d %d", &t, &i), 2);
+        BOOST_REQUIRE(t >= 0 && t < NUM_THREADS);
+        BOOST_REQUIRE_EQUAL(i, next[t]);
+        ++next[t];
+    }
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        BOOST_CHECK_EQUAL(next[t], MESSAGES_PER_THREAD);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(logging_partial_lines)
+{
+    BCLog::Logger logger;
+    logger.m_log_timestamps = false;
+    logger.m_log_threadnames = false;
+    logger.m_log_sourcelocations = false;
+    std::vector<std::string> messages;
+    logger.PushBackCallback([&](const std::string& s) { messages.push_back(s); });
+    BOOST_REQUIRE(logger.StartLogging());
+
+    // A line is continued by the next message of the same thread only.
+    const auto log{[&](const std::string& str) { logger.LogPrintStr(str, "fn", "src", 1, BCLog::LogFlags::NONE, BCLog::Level::Info); }};
+    log("a1 ");
+    std::thread{[&] { log("b\n"); }}.join();
+    log("a2\n");
+    log("c\n");
+    logger.DisconnectTestLogger();
+
+    BOOST_CHECK(messages == (std::vector<std::string>{"[info] a1 ", "[info] b\n", "a2\n", "[info] c\n"}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
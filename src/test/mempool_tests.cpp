@@ -11,6 +11,7 @@
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 #include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
@@ -190,8 +191,8 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     sortedOrder.insert(sortedOrder.begin(), tx6.GetHash().ToString());
     CheckSort<descendant_score>(pool, sortedOrder);
 
-    CTxMemPool::setEntries setAncestors;
-    setAncestors.insert(pool.mapTx.find(tx6.GetHash()));
+    CTxMemPool::vecEntries ancestors;
+    ancestors.push_back(pool.mapTx.find(tx6.GetHash()));
     CMutableTransaction tx7 = CMutableTransaction();
     tx7.vin.resize(1);
     tx7.vin[0].prevout = COutPoint(tx6.GetHash(), 0);
@@ -204,9 +205,9 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 
     auto ancestors_calculated{pool.CalculateMemPoolAncestors(entry.Fee(2000000LL).FromTx(tx7), CTxMemPool::Limits::NoLimits())};
     BOOST_REQUIRE(ancestors_calculated.has_value());
-    BOOST_CHECK(*ancestors_calculated == setAncestors);
+    BOOST_CHECK(CTxMemPool::setEntries(ancestors_calculated->begin(), ancestors_calculated->end()) == CTxMemPool::setEntries(ancestors.begin(), ancestors.end()));
 
-    pool.addUnchecked(entry.FromTx(tx7), setAncestors);
+    pool.addUnchecked(entry.FromTx(tx7), ancestors);
     BOOST_CHECK_EQUAL(pool.size(), 7U);
 
     // Now tx6 should be sorted higher (high fee child): tx7, tx6, tx2, ...
@@ -223,8 +224,8 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     tx8.vout.resize(1);
     tx8.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
     tx8.vout[0].nValue = 10 * COIN;
-    setAncestors.insert(pool.mapTx.find(tx7.GetHash()));
-    pool.addUnchecked(entry.Fee(0LL).Time(NodeSeconds{2s}).FromTx(tx8), setAncestors);
+    ancestors.push_back(pool.mapTx.find(tx7.GetHash()));
+    pool.addUnchecked(entry.Fee(0LL).Time(NodeSeconds{2s}).FromTx(tx8), ancestors);
 
     // Now tx8 should be sorted low, but tx6/tx both high
     sortedOrder.insert(sortedOrder.begin(), tx8.GetHash().ToString());
@@ -238,7 +239,7 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     tx9.vout.resize(1);
     tx9.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
     tx9.vout[0].nValue = 1 * COIN;
-    pool.addUnchecked(entry.Fee(0LL).Time(NodeSeconds{3s}).FromTx(tx9), setAncestors);
+    pool.addUnchecked(entry.Fee(0LL).Time(NodeSeconds{3s}).FromTx(tx9), ancestors);
 
     // tx9 should be sorted low
     BOOST_CHECK_EQUAL(pool.size(), 9U);
@@ -247,8 +248,8 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 
     std::vector<std::string> snapshotOrder = sortedOrder;
 
-    setAncestors.insert(pool.mapTx.find(tx8.GetHash()));
-    setAncestors.insert(pool.mapTx.find(tx9.GetHash()));
+    ancestors.push_back(pool.mapTx.find(tx8.GetHash()));
+    ancestors.push_back(pool.mapTx.find(tx9.GetHash()));
     /* tx10 depends on tx8 and tx9 and has a high fee*/
     CMutableTransaction tx10 = CMutableTransaction();
     tx10.vin.resize(2);
@@ -262,9 +263,9 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 
     ancestors_calculated = pool.CalculateMemPoolAncestors(entry.Fee(200000LL).Time(NodeSeconds{4s}).FromTx(tx10), CTxMemPool::Limits::NoLimits());
     BOOST_REQUIRE(ancestors_calculated);
-    BOOST_CHECK(*ancestors_calculated == setAncestors);
+    BOOST_CHECK(CTxMemPool::setEntries(ancestors_calculated->begin(), ancestors_calculated->end()) == CTxMemPool::setEntries(ancestors.begin(), ancestors.end()));
 
-    pool.addUnchecked(entry.FromTx(tx10), setAncestors);
+    pool.addUnchecked(entry.FromTx(tx10), ancestors);
 
     /**
      *  tx8 and tx9 should both now be sorted higher
@@ -800,4 +801,236 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTestsDiamond)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_FIXTURE_TEST_CASE(MempoolClusterTest, BasicTestingSetup)
+{
+    CTxMemPool pool{MemPoolOptionsForTest(m_node)};
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    const auto cluster_of = [&](const CTransactionRef& tx) -> const CTxMemPool::Cluster& {
+        return pool.GetClusters().at((*pool.GetIter(tx->GetHash()))->m_cluster_id);
+    };
+
+    // [tx1].0 <- [tx2]  [tx3]
+    CTransactionRef tx1 = make_tx(/*output_values=*/{10 * COIN, 10 * COIN});
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tx1));
+    CTransactionRef tx2 = make_tx(/*output_values=*/{10 * COIN}, /*inputs=*/{tx1});
+    pool.addUnchecked(entry.Fee(20000LL).FromTx(tx2));
+    CTransactionRef tx3 = make_tx(/*output_values=*/{5 * COIN});
+    pool.addUnchecked(entry.Fee(5000LL).FromTx(tx3));
+    BOOST_CHECK_EQUAL(pool.GetClusters().size(), 2U);
+
+    // The child pays for its parent: both end up in a single chunk.
+    BOOST_CHECK_EQUAL(cluster_of(tx1).txs.size(), 2U);
+    BOOST_REQUIRE_EQUAL(cluster_of(tx1).chunks.size(), 1U);
+    BOOST_CHECK_EQUAL(cluster_of(tx1).chunks[0].fee, 21000);
+    BOOST_CHECK(cluster_of(tx1).txs[0]->GetTx().GetHash() == tx1->GetHash());
+
+    // [tx1].1 <- [tx4] adds a chunk with a lower feerate.
+    CTransactionRef tx4 = make_tx(/*output_values=*/{10 * COIN}, /*inputs=*/{tx1}, /*input_indices=*/{1});
+    pool.addUnchecked(entry.Fee(0LL).FromTx(tx4));
+    BOOST_REQUIRE_EQUAL(cluster_of(tx4).chunks.size(), 2U);
+    BOOST_CHECK_EQUAL(cluster_of(tx4).chunks[0].end, 2U);
+    BOOST_CHECK(cluster_of(tx4).txs[2]->GetTx().GetHash() == tx4->GetHash());
+
+    // [tx4] <- [tx5] -> [tx3] merges both clusters. The ancestors of tx5 now
+    // have the highest feerate and move in front of tx2.
+    CTransactionRef tx5 = make_tx(/*output_values=*/{10 * COIN}, /*inputs=*/{tx4, tx3});
+    pool.addUnchecked(entry.Fee(100000LL).FromTx(tx5));
+    BOOST_CHECK_EQUAL(pool.GetClusters().size(), 1U);
+    const CTxMemPool::Cluster& cluster{cluster_of(tx5)};
+    BOOST_REQUIRE_EQUAL(cluster.txs.size(), 5U);
+    BOOST_REQUIRE_EQUAL(cluster.chunks.size(), 2U);
+    BOOST_CHECK_EQUAL(cluster.chunks[0].end, 4U);
+    BOOST_CHECK_EQUAL(cluster.chunks[0].fee, 106000);
+    BOOST_CHECK(cluster.txs[3]->GetTx().GetHash() == tx5->GetHash());
+    BOOST_CHECK(cluster.txs[4]->GetTx().GetHash() == tx2->GetHash());
+
+    // Mining tx4 and tx5 splits the cluster again.
+    pool.removeForBlock({tx4, tx5}, /*nBlockHeight=*/1);
+    BOOST_CHECK_EQUAL(pool.GetClusters().size(), 2U);
+    BOOST_CHECK_EQUAL(cluster_of(tx1).txs.size(), 2U);
+    BOOST_CHECK_EQUAL(cluster_of(tx3).txs.size(), 1U);
+    BOOST_CHECK_EQUAL(cluster_of(tx3).chunks[0].fee, 5000);
+
+    // Prioritisation is reflected in the chunks.
+    pool.PrioritiseTransaction(tx3->GetHash(), 1000);
+    BOOST_CHECK_EQUAL(cluster_of(tx3).chunks[0].fee, 6000);
+
+    // A child of tx2 and tx3 would join a cluster of 3 transactions with itself.
+    CTxMemPool::Limits limits;
+    limits.cluster_count = 3;
+    const CTxMemPool::vecEntries parents{*pool.GetIter(tx2->GetHash()), *pool.GetIter(tx3->GetHash())};
+    BOOST_CHECK(!pool.CheckClusterLimit({*pool.GetIter(tx2->GetHash())}, /*conflicts=*/{}, /*entry_count=*/1, limits));
+    BOOST_CHECK(pool.CheckClusterLimit(parents, /*conflicts=*/{}, /*entry_count=*/1, limits));
+    // Replaced transactions don't count: a child of tx1 replacing tx2 only joins tx1.
+    limits.cluster_count = 2;
+    BOOST_CHECK(pool.CheckClusterLimit({*pool.GetIter(tx1->GetHash())}, /*conflicts=*/{}, /*entry_count=*/1, limits));
+    BOOST_CHECK(!pool.CheckClusterLimit({*pool.GetIter(tx1->GetHash())}, {*pool.GetIter(tx2->GetHash())}, /*entry_count=*/1, limits));
+
+    // A cluster is ordered by ancestor score, each transaction after its
+    // ancestors: [tx6] <- [child]... <- [grandchild]
+    CTransactionRef tx6 = make_tx(/*output_values=*/std::vector<CAmount>(70, COIN));
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tx6));
+    std::vector<CTransactionRef> children;
+    for (uint32_t i = 0; i < 70; ++i) {
+        children.push_back(make_tx(/*output_values=*/{COIN}, /*inputs=*/{tx6}, /*input_indices=*/{i}));
+        pool.addUnchecked(entry.Fee(1000LL + i).FromTx(children.back()));
+    }
+    CTransactionRef grandchild = make_tx(/*output_values=*/{COIN}, /*inputs=*/{children[3]});
+    pool.addUnchecked(entry.Fee(1000000LL).FromTx(grandchild));
+    const CTxMemPool::Cluster& large{cluster_of(tx6)};
+    BOOST_REQUIRE_EQUAL(large.txs.size(), 72U);
+    BOOST_CHECK(large.txs[0]->GetTx().GetHash() == tx6->GetHash());
+    BOOST_CHECK(large.txs[1]->GetTx().GetHash() == children[3]->GetHash());
+    BOOST_CHECK(large.txs[2]->GetTx().GetHash() == grandchild->GetHash());
+    BOOST_CHECK(large.txs[3]->GetTx().GetHash() == children[69]->GetHash());
+    BOOST_CHECK(large.txs[71]->GetTx().GetHash() == children[0]->GetHash());
+    BOOST_CHECK_EQUAL(large.chunks[0].end, 3U);
+
+    // Removing a transaction keeps the positions of the others up to date.
+    pool.removeForBlock({children[5]}, /*nBlockHeight=*/2);
+    for (const auto& [_, cluster] : pool.GetClusters()) {
+        for (size_t i = 0; i < cluster.txs.size(); ++i) BOOST_CHECK_EQUAL(cluster.txs[i]->m_cluster_pos, i);
+    }
+    BOOST_CHECK_EQUAL(cluster_of(tx6).txs.size(), 71U);
+}
+
+BOOST_FIXTURE_TEST_CASE(MempoolLargeClusterTest, BasicTestingSetup)
+{
+    CTxMemPool pool{MemPoolOptionsForTest(m_node)};
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    const auto cluster_of = [&](const CTransactionRef& tx) -> const CTxMemPool::Cluster& {
+        return pool.GetClusters().at((*pool.GetIter(tx->GetHash()))->m_cluster_id);
+    };
+    const auto hashes_of = [](const CTxMemPool::Cluster& cluster) {
+        std::vector<uint256> hashes;
+        for (const auto& tx : cluster.txs) hashes.push_back(tx->GetTx().GetHash());
+        return hashes;
+    };
+    // Every transaction comes after its parents, and the chunks have
+    // non-increasing feerates.
+    const auto check_linearized = [](const CTxMemPool::Cluster& cluster) {
+        size_t begin{0};
+        for (size_t i = 0; i < cluster.chunks.size(); ++i) {
+            const auto& chunk{cluster.chunks[i]};
+            BOOST_CHECK_LT(begin, chunk.end);
+            CAmount fee{0};
+            for (size_t pos = begin; pos < chunk.end; ++pos) fee += cluster.txs[pos]->GetModifiedFee();
+            BOOST_CHECK_EQUAL(chunk.fee, fee);
+            if (i > 0) {
+                const auto& prev{cluster.chunks[i - 1]};
+                BOOST_CHECK(double(chunk.fee) * prev.size <= double(prev.fee) * chunk.size);
+            }
+            begin = chunk.end;
+        }
+        BOOST_CHECK_EQUAL(begin, cluster.txs.size());
+        for (size_t i = 0; i < cluster.txs.size(); ++i) {
+            BOOST_CHECK_EQUAL(cluster.txs[i]->m_cluster_pos, i);
+            for (const CTxMemPoolEntry& parent : cluster.txs[i]->GetMemPoolParentsConst()) {
+                BOOST_CHECK_LT(parent.m_cluster_pos, i);
+            }
+        }
+    };
+    const size_t n{CTxMemPool::MAX_CLUSTER_SORT_SIZE + 50};
+
+    // [root1] <- [child]... Past MAX_CLUSTER_SORT_SIZE, a new child goes
+    // last instead of in front of the children with lower fees.
+    CTransactionRef root1 = make_tx(/*output_values=*/std::vector<CAmount>(n, COIN));
+    pool.addUnchecked(entry.Fee(1000000LL).FromTx(root1));
+    std::vector<CTransactionRef> children1;
+    for (uint32_t i = 0; i < n; ++i) {
+        children1.push_back(make_tx(/*output_values=*/{COIN}, /*inputs=*/{root1}, /*input_indices=*/{i}));
+        pool.addUnchecked(entry.Fee(1000LL + i).FromTx(children1.back()));
+    }
+    BOOST_REQUIRE_EQUAL(cluster_of(root1).txs.size(), n + 1);
+    BOOST_CHECK(cluster_of(root1).txs[0]->GetTx().GetHash() == root1->GetHash());
+    BOOST_CHECK(cluster_of(root1).txs.back()->GetTx().GetHash() == children1.back()->GetHash());
+    check_linearized(cluster_of(root1));
+
+    // [root2] <- [child]...
+    CTransactionRef root2 = make_tx(/*output_values=*/std::vector<CAmount>(n, 2 * COIN));
+    pool.addUnchecked(entry.Fee(0LL).FromTx(root2));
+    std::vector<CTransactionRef> children2;
+    for (uint32_t i = 0; i < n; ++i) {
+        children2.push_back(make_tx(/*output_values=*/{2 * COIN}, /*inputs=*/{root2}, /*input_indices=*/{i}));
+        pool.addUnchecked(entry.Fee(5000LL).FromTx(children2.back()));
+    }
+    BOOST_CHECK_EQUAL(pool.GetClusters().size(), 2U);
+    check_linearized(cluster_of(root2));
+    const std::vector<uint256> order1{hashes_of(cluster_of(root1))};
+
+    // [child1] <- [merger] -> [child2] merges both clusters by chunk
+    // feerate, each keeping its order.
+    CTransactionRef merger = make_tx(/*output_values=*/{COIN}, /*inputs=*/{children1[0], children2[0]});
+    pool.addUnchecked(entry.Fee(0LL).FromTx(merger));
+    BOOST_CHECK_EQUAL(pool.GetClusters().size(), 1U);
+    const CTxMemPool::Cluster& merged{cluster_of(merger)};
+    BOOST_REQUIRE_EQUAL(merged.txs.size(), 2 * n + 3);
+    BOOST_CHECK(merged.txs.back()->GetTx().GetHash() == merger->GetHash());
+    check_linearized(merged);
+    std::vector<uint256> merged_order1;
+    for (const auto& tx : merged.txs) {
+        if (std::find(order1.begin(), order1.end(), tx->GetTx().GetHash()) != order1.end()) merged_order1.push_back(tx->GetTx().GetHash());
+    }
+    BOOST_CHECK(merged_order1 == order1);
+
+    // Removing root2 with its descendants splits off the first cluster in
+    // its earlier order.
+    pool.removeRecursive(*root2, REMOVAL_REASON_DUMMY);
+    BOOST_CHECK_EQUAL(pool.GetClusters().size(), 1U);
+    BOOST_CHECK(hashes_of(cluster_of(root1)) == order1);
+    check_linearized(cluster_of(root1));
+
+    // Mining root1 leaves each child in a cluster of its own.
+    pool.removeForBlock({root1}, /*nBlockHeight=*/1);
+    BOOST_CHECK_EQUAL(pool.GetClusters().size(), n);
+    for (const auto& child : children1) {
+        BOOST_REQUIRE_EQUAL(cluster_of(child).txs.size(), 1U);
+        check_linearized(cluster_of(child));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MempoolReadIndexTest, BasicTestingSetup)
+{
+    CTxMemPool pool{MemPoolOptionsForTest(m_node)};
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // [tx1] <- [tx2]  [tx3]
+    CTransactionRef tx1 = make_tx(/*output_values=*/{10 * COIN});
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tx1));
+    CTransactionRef tx2 = make_tx(/*output_values=*/{10 * COIN}, /*inputs=*/{tx1});
+    pool.addUnchecked(entry.Fee(50000LL).FromTx(tx2));
+    CTransactionRef tx3 = make_tx(/*output_values=*/{5 * COIN});
+    pool.addUnchecked(entry.Fee(2000LL).FromTx(tx3));
+
+    BOOST_CHECK_EQUAL(pool.size(), 3U);
+    BOOST_CHECK(pool.exists(GenTxid::Txid(tx2->GetHash())));
+    BOOST_CHECK(pool.exists(GenTxid::Wtxid(tx2->GetWitnessHash())));
+    BOOST_CHECK(pool.get(tx3->GetHash()) == tx3);
+    const TxMempoolInfo info{pool.info(GenTxid::Wtxid(tx1->GetWitnessHash()))};
+    BOOST_CHECK(info.tx == tx1);
+    BOOST_CHECK_EQUAL(info.fee, 1000);
+    BOOST_CHECK_EQUAL(info.vsize, GetVirtualTransactionSize(*tx1));
+
+    // Fewer ancestors first, then higher feerate.
+    std::vector<uint256> txids;
+    pool.queryHashes(txids);
+    BOOST_CHECK(txids == std::vector<uint256>({tx3->GetHash(), tx1->GetHash(), tx2->GetHash()}));
+    BOOST_CHECK(pool.CompareDepthAndScore(tx1->GetHash(), tx2->GetHash()));
+
+    pool.PrioritiseTransaction(tx1->GetHash(), 500);
+    BOOST_CHECK_EQUAL(pool.info(GenTxid::Txid(tx1->GetHash())).nFeeDelta, 500);
+
+    // Once its parent is mined, tx2 has no ancestors left and comes first.
+    pool.removeForBlock({tx1}, /*nBlockHeight=*/1);
+    BOOST_CHECK_EQUAL(pool.size(), 2U);
+    BOOST_CHECK(!pool.exists(GenTxid::Txid(tx1->GetHash())));
+    BOOST_CHECK(!pool.exists(GenTxid::Wtxid(tx1->GetWitnessHash())));
+    BOOST_CHECK(!pool.info(GenTxid::Txid(tx1->GetHash())).tx);
+    pool.queryHashes(txids);
+    BOOST_CHECK(txids == std::vector<uint256>({tx2->GetHash(), tx3->GetHash()}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
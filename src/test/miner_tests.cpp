@@ -8,8 +8,10 @@
 #include <consensus/tx_verify.h>
 #include <node/miner.h>
 #include <policy/policy.h>
+#include <pow.h>
 #include <script/standard.h>
 #include <test/util/random.h>
+#include <test/util/script.h>
 #include <test/util/txmempool.h>
 #include <timedata.h>
 #include <txmempool.h>
@@ -22,11 +24,14 @@
 
 #include <test/util/setup_common.h>
 
+#include <chrono>
 #include <memory>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
 using node::BlockAssembler;
+using node::BlockTemplateCache;
 using node::CBlockTemplate;
 
 namespace miner_tests {
@@ -655,4 +660,50 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     TestPrioritisedMining(scriptPubKey, txFirst);
 }
 
+BOOST_AUTO_TEST_CASE(block_template_cache)
+{
+    BlockTemplateCache cache{*m_node.chainman, *m_node.mempool};
+    RegisterValidationInterface(&cache);
+
+    // A template for an unchanged tip and mempool is served from the cache.
+    const BlockTemplateCache::Entry first{cache.Get()};
+    BOOST_REQUIRE(first.block_template);
+    BOOST_CHECK(first.prev == WITH_LOCK(::cs_main, return m_node.chainman->ActiveTip()));
+    BOOST_CHECK(cache.Get().block_template == first.block_template);
+
+    // A mempool change is picked up by the refresh thread.
+    const COutPoint outpoint{InsecureRand256(), 0};
+    {
+        LOCK(::cs_main);
+        m_node.chainman->ActiveChainstate().CoinsTip().AddCoin(outpoint, Coin{CTxOut{COIN, P2WSH_OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+    }
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(outpoint);
+    mtx.vin[0].scriptWitness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
+    mtx.vout.emplace_back(COIN - 10000, P2WSH_OP_TRUE);
+    const CTransactionRef tx{MakeTransactionRef(mtx)};
+    BOOST_REQUIRE_EQUAL(WITH_LOCK(::cs_main, return m_node.chainman->ProcessTransaction(tx)).m_result_type, MempoolAcceptResult::ResultType::VALID);
+    const auto deadline{std::chrono::steady_clock::now() + std::chrono::minutes{1}};
+    BlockTemplateCache::Entry refreshed{cache.Get()};
+    while (refreshed.mempool_sequence != m_node.mempool->GetSequence() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        refreshed = cache.Get();
+    }
+    BOOST_CHECK_EQUAL(refreshed.mempool_sequence, m_node.mempool->GetSequence());
+    BOOST_REQUIRE_EQUAL(refreshed.block_template->block.vtx.size(), 2U);
+    BOOST_CHECK(refreshed.block_template->block.vtx[1]->GetHash() == tx->GetHash());
+
+    // A new tip invalidates the cached template right away.
+    CBlock block{refreshed.block_template->block};
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, m_node.chainman->GetConsensus())) ++block.nNonce;
+    BOOST_REQUIRE(m_node.chainman->ProcessNewBlock(std::make_shared<const CBlock>(block), /*force_processing=*/true, /*min_pow_checked=*/true, /*new_block=*/nullptr));
+    const BlockTemplateCache::Entry next{cache.Get()};
+    BOOST_CHECK(next.prev->GetBlockHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(next.block_template->block.vtx.size(), 1U);
+
+    UnregisterValidationInterface(&cache);
+    SyncWithValidationInterfaceQueue();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -30,6 +30,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 using namespace std::literals;
 
@@ -803,6 +804,34 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
     BOOST_CHECK(!IsLocal(addr));
 }
 
+BOOST_FIXTURE_TEST_CASE(serialized_net_msg_shared_payload, BasicTestingSetup)
+{
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+    const CSerializedNetMsg owned{msg_maker.Make(NetMsgType::BLOCK, Params().GenesisBlock())};
+
+    // A message with a shared payload is framed exactly like one that owns it.
+    const auto buffer{std::make_shared<const std::vector<unsigned char>>(owned.data)};
+    CSerializedNetMsg shared;
+    shared.m_type = NetMsgType::BLOCK;
+    shared.m_shared_owner = buffer;
+    shared.m_shared_data = *buffer;
+    BOOST_CHECK(shared.data.empty());
+    BOOST_CHECK(shared.Payload() == owned.Payload());
+    BOOST_CHECK(shared.Payload().data() == buffer->data());
+
+    const V1TransportSerializer serializer{};
+    CSerializedNetMsg owned_copy{owned.Copy()};
+    std::vector<unsigned char> owned_header, shared_header;
+    serializer.prepareForTransport(owned_copy, owned_header);
+    serializer.prepareForTransport(shared, shared_header);
+    BOOST_CHECK(owned_header == shared_header);
+
+    // Copies refer to the same buffer rather than duplicating it.
+    const CSerializedNetMsg shared_copy{shared.Copy()};
+    BOOST_CHECK(shared_copy.Payload().data() == buffer->data());
+    BOOST_CHECK_EQUAL(buffer.use_count(), 3);
+}
+
 BOOST_AUTO_TEST_CASE(initial_advertise_from_version_message)
 {
     LOCK(NetEventsInterface::g_msgproc_mutex);
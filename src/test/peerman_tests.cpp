@@ -0,0 +1,114 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <net.h>
+#include <net_processing.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <test/util/net.h>
+#include <test/util/setup_common.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(peerman_tests, TestingSetup)
+
+/** The types of the messages that have been pushed to the node, in order. */
+static std::vector<std::string> SentMessageTypes(CNode& node)
+{
+    std::vector<std::string> types;
+    LOCK(node.cs_vSend);
+    for (const CSerializedNetMsg& msg : node.vSendMsg) {
+        // Message headers are queued as separate entries without a type.
+        if (!msg.m_type.empty()) types.push_back(msg.m_type);
+    }
+    return types;
+}
+
+BOOST_AUTO_TEST_CASE(block_reply_before_later_messages)
+{
+    LOCK(NetEventsInterface::g_msgproc_mutex);
+
+    BOOST_REQUIRE_GT(gArgs.GetIntArg("-msgworkers", DEFAULT_MSG_WORKERS), 0);
+
+    ConnmanTestMsg& connman = static_cast<ConnmanTestMsg&>(*m_node.connman);
+    PeerManager& peerman = *m_node.peerman;
+    {
+        // Don't let the replies, which are not actually sent, pause processing.
+        CConnman::Options options;
+        options.m_msgproc = &peerman;
+        options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+        connman.Init(options);
+    }
+
+    CNode node{/*id=*/0,
+               /*sock=*/nullptr,
+               CAddress{},
+               /*nKeyedNetGroupIn=*/0,
+               /*nLocalHostNonceIn=*/0,
+               CAddress{},
+               /*addrNameIn=*/"",
+               ConnectionType::INBOUND,
+               /*inbound_onion=*/false};
+    connman.Handshake(
+        /*node=*/node,
+        /*successfully_connected=*/true,
+        /*remote_services=*/ServiceFlags(NODE_NETWORK | NODE_WITNESS),
+        /*local_services=*/ServiceFlags(NODE_NETWORK | NODE_WITNESS),
+        /*version=*/PROTOCOL_VERSION,
+        /*relay_txs=*/true);
+    {
+        LOCK(node.cs_vSend);
+        node.vSendMsg.clear();
+        node.nSendSize = 0;
+    }
+    node.fPauseSend = false;
+
+    // Ask for the same block twice, so that the second one is served from the
+    // getdata queue, and ping right after.
+    const uint256 block_hash{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash())};
+    const CNetMsgMaker mm{node.GetCommonVersion()};
+    CSerializedNetMsg msg_getdata{mm.Make(NetMsgType::GETDATA, std::vector<CInv>{CInv{MSG_BLOCK, block_hash}, CInv{MSG_BLOCK, block_hash}})};
+    CSerializedNetMsg msg_ping{mm.Make(NetMsgType::PING, uint64_t{1})};
+    (void)connman.ReceiveMsgFrom(node, msg_getdata);
+    (void)connman.ReceiveMsgFrom(node, msg_ping);
+
+    // This hands the first block to a message worker thread. Wait for it.
+    connman.ProcessMessagesOnce(node);
+    peerman.WaitForBlockDataServed(node.GetId());
+    BOOST_CHECK(SentMessageTypes(node) == std::vector<std::string>{NetMsgType::BLOCK});
+
+    // This hands the second block to a worker thread. Hold up the worker
+    // thread, so that the block is still being sent while the ping is due.
+    std::promise<void> send_blocked;
+    std::promise<void> release_send;
+    std::thread blocker{[&] {
+        LOCK(node.cs_vSend);
+        send_blocked.set_value();
+        release_send.get_future().wait();
+    }};
+    send_blocked.get_future().wait();
+    connman.ProcessMessagesOnce(node);
+    // The ping must be left until the block has been sent.
+    connman.ProcessMessagesOnce(node);
+    release_send.set_value();
+    blocker.join();
+    peerman.WaitForBlockDataServed(node.GetId());
+    BOOST_CHECK(SentMessageTypes(node) == (std::vector<std::string>{NetMsgType::BLOCK, NetMsgType::BLOCK}));
+
+    connman.ProcessMessagesOnce(node);
+    BOOST_CHECK(SentMessageTypes(node) == (std::vector<std::string>{NetMsgType::BLOCK, NetMsgType::BLOCK, NetMsgType::PONG}));
+
+    peerman.FinalizeNode(node);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
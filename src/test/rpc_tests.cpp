@@ -2,18 +2,36 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <consensus/merkle.h>
 #include <core_io.h>
 #include <interfaces/chain.h>
+#include <key.h>
 #include <node/context.h>
+#include <node/miner.h>
+#include <pow.h>
 #include <rpc/blockchain.h>
 #include <rpc/client.h>
+#include <rpc/mempool.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <script/standard.h>
+#include <test/util/random.h>
+#include <test/util/script.h>
 #include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
+#include <txmempool.h>
+#include <undo.h>
 #include <univalue.h>
 #include <util/time.h>
+#include <validation.h>
 
 #include <any>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -541,4 +559,211 @@ BOOST_AUTO_TEST_CASE(help_example)
     BOOST_CHECK_NE(HelpExampleRpcNamed("foo", {{"arg", true}}), HelpExampleRpcNamed("foo", {{"arg", "true"}}));
 }
 
+BOOST_FIXTURE_TEST_CASE(rpc_json_writer, BasicTestingSetup)
+{
+    const auto text{[](const auto& write) {
+        JSONWriter out;
+        write(out);
+        return out.Text();
+    }};
+    for (const CAmount amount : {CAmount{0}, CAmount{1}, CAmount{17622195}, COIN, -COIN, -COIN / 10, CAmount{2099999999999999}, COIN * 100000000}) {
+        BOOST_CHECK_EQUAL(text([&](JSONWriter& out) { out.Amount(amount); }), ValueFromAmount(amount).write());
+    }
+    std::string all_chars;
+    for (int c = 0; c < 256; ++c) all_chars += char(c);
+    BOOST_CHECK_EQUAL(text([&](JSONWriter& out) { out.String(all_chars); }), UniValue{all_chars}.write());
+
+    UniValue obj{UniValue::VOBJ};
+    obj.pushKV("a\"b", std::numeric_limits<int64_t>::min());
+    obj.pushKV("c", UniValue{UniValue::VARR});
+    obj.pushKV("d", true);
+    UniValue arr{UniValue::VARR};
+    arr.push_back(UniValue{UniValue::VOBJ});
+    arr.push_back("00ff");
+    obj.pushKV("e", arr);
+    BOOST_CHECK_EQUAL(text([](JSONWriter& out) {
+        out.BeginObject();
+        out.Key("a\"b");
+        out.Int(std::numeric_limits<int64_t>::min());
+        out.Key("c");
+        out.BeginArray();
+        out.EndArray();
+        out.Key("d");
+        out.Bool(true);
+        out.Key("e");
+        out.BeginArray();
+        out.BeginObject();
+        out.EndObject();
+        out.Hex(std::vector<unsigned char>{0x00, 0xff});
+        out.EndArray();
+        out.EndObject();
+    }), obj.write());
+
+    // Transactions with all kinds of inputs and outputs, with and without prevouts.
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey{key.GetPubKey()};
+    CMutableTransaction mtx;
+    mtx.nVersion = -1;
+    mtx.nLockTime = 0xffffffff;
+    mtx.vin.emplace_back(COutPoint{uint256::ONE, 7}, CScript() << OP_0 << std::vector<unsigned char>(71, 0x30), 0xfffffffd);
+    mtx.vin.emplace_back(COutPoint{uint256::ONE, 0});
+    mtx.vin[1].scriptWitness.stack = {std::vector<unsigned char>(72, 1), ToByteVector(pubkey)};
+    mtx.vout.emplace_back(COIN, GetScriptForDestination(PKHash{pubkey}));
+    mtx.vout.emplace_back(CAmount{0}, CScript() << OP_RETURN << std::vector<unsigned char>{'"', '\\', '\n'});
+    mtx.vout.emplace_back(CAmount{1}, GetScriptForRawPubKey(pubkey));
+    mtx.vout.emplace_back(CAmount{2}, GetScriptForMultisig(1, {pubkey, pubkey}));
+    mtx.vout.emplace_back(CAmount{3}, GetScriptForDestination(WitnessV0KeyHash{pubkey}));
+    const CTransaction tx{mtx};
+    CTxUndo txundo;
+    txundo.vprevout.emplace_back(CTxOut{2 * COIN, GetScriptForDestination(ScriptHash{CScript() << OP_TRUE})}, 100, /*fCoinBaseIn=*/true);
+    txundo.vprevout.emplace_back(CTxOut{COIN, GetScriptForDestination(WitnessV0KeyHash{pubkey})}, 200, /*fCoinBaseIn=*/false);
+    for (const CTxUndo* undo : std::vector<const CTxUndo*>{nullptr, &txundo}) {
+        for (const TxVerbosity verbosity : {TxVerbosity::SHOW_DETAILS, TxVerbosity::SHOW_DETAILS_AND_PREVOUT}) {
+            for (const uint256& block_hash : {uint256{}, uint256::ONE}) {
+                UniValue entry{UniValue::VOBJ};
+                TxToUniv(tx, block_hash, entry, /*include_hex=*/true, /*serialize_flags=*/0, undo, verbosity);
+                BOOST_CHECK_EQUAL(text([&](JSONWriter& out) { TxToJSON(tx, block_hash, out, /*include_hex=*/true, /*serialize_flags=*/0, undo, verbosity); }), entry.write());
+            }
+        }
+    }
+
+    // A sink gets the text in pieces.
+    std::string sunk;
+    JSONWriter out{[&](const std::string& chunk) { sunk += chunk; }};
+    out.BeginArray();
+    for (int i = 0; i < 10000; ++i) TxToJSON(tx, uint256{}, out);
+    out.EndArray();
+    out.Flush();
+    BOOST_CHECK(out.Text().empty());
+    BOOST_CHECK_GT(sunk.size(), JSONWriter::FLUSH_SIZE);
+    UniValue parsed;
+    BOOST_CHECK(parsed.read(sunk));
+    BOOST_CHECK_EQUAL(parsed.size(), 10000U);
+}
+
+BOOST_FIXTURE_TEST_CASE(rpc_block_json_writer, TestingSetup)
+{
+    // Mine a block on top of genesis that spends a coin, so that it has undo data.
+    const COutPoint outpoint{InsecureRand256(), 0};
+    {
+        LOCK(cs_main);
+        m_node.chainman->ActiveChainstate().CoinsTip().AddCoin(outpoint, Coin{CTxOut{COIN, P2WSH_OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+    }
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(outpoint);
+    mtx.vin[0].scriptWitness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
+    mtx.vout.emplace_back(COIN - 10000, P2WSH_OP_TRUE);
+    BOOST_REQUIRE_EQUAL(WITH_LOCK(cs_main, return m_node.chainman->ProcessTransaction(MakeTransactionRef(mtx))).m_result_type, MempoolAcceptResult::ResultType::VALID);
+    CBlock block{node::BlockAssembler{m_node.chainman->ActiveChainstate(), m_node.mempool.get()}.CreateNewBlock(CScript() << OP_TRUE)->block};
+    BOOST_REQUIRE_EQUAL(block.vtx.size(), 2U);
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, m_node.chainman->GetConsensus())) ++block.nNonce;
+    BOOST_REQUIRE(m_node.chainman->ProcessNewBlock(std::make_shared<const CBlock>(block), /*force_processing=*/true, /*min_pow_checked=*/true, /*new_block=*/nullptr));
+
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveTip())};
+    BOOST_REQUIRE(tip->GetBlockHash() == block.GetHash());
+    for (const CBlockIndex* index : std::vector<const CBlockIndex*>{tip->pprev, tip}) {
+        const CBlock& indexed_block{index == tip ? block : m_node.chainman->GetParams().GenesisBlock()};
+        for (const TxVerbosity verbosity : {TxVerbosity::SHOW_TXID, TxVerbosity::SHOW_DETAILS, TxVerbosity::SHOW_DETAILS_AND_PREVOUT}) {
+            JSONWriter out;
+            blockToJSON(m_node.chainman->m_blockman, indexed_block, tip, index, verbosity, out);
+            BOOST_CHECK_EQUAL(out.Text(), blockToJSON(m_node.chainman->m_blockman, indexed_block, tip, index, verbosity).write());
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(rpc_batch_parallel, BasicTestingSetup)
+{
+    // Calls with replies that do not depend on when they are executed.
+    UniValue batch{UniValue::VARR};
+    UniValue params{UniValue::VARR};
+    params.push_back("unexpected");
+    for (int i = 0; i < 20; ++i) {
+        batch.push_back(JSONRPCRequestObj(i % 2 ? "uptime" : "nosuchmethod", params, i));
+    }
+    const JSONRPCRequest jreq;
+    const std::string sequential{JSONRPCExecBatch(jreq, batch)};
+    UniValue replies;
+    BOOST_REQUIRE(replies.read(sequential));
+    BOOST_REQUIRE_EQUAL(replies.size(), 20U);
+    for (int i = 0; i < 20; ++i) {
+        BOOST_CHECK_EQUAL(replies[i]["id"].getInt<int>(), i);
+    }
+
+    // Helpers on other threads.
+    std::vector<std::thread> threads;
+    const std::string parallel{JSONRPCExecBatch(jreq, batch, /*max_threads=*/4, [&](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+        return true;
+    })};
+    for (auto& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(threads.size(), 3U);
+    BOOST_CHECK_EQUAL(parallel, sequential);
+
+    // Helpers that only run once the batch was completed by the calling thread.
+    std::vector<std::function<void()>> tasks;
+    const std::string late{JSONRPCExecBatch(jreq, batch, /*max_threads=*/4, [&](std::function<void()> task) {
+        tasks.push_back(std::move(task));
+        return true;
+    })};
+    for (const auto& task : tasks) task();
+    BOOST_CHECK_EQUAL(late, sequential);
+
+    // Helpers that are not accepted.
+    BOOST_CHECK_EQUAL(JSONRPCExecBatch(jreq, batch, /*max_threads=*/4, [](std::function<void()>) { return false; }), sequential);
+}
+
+BOOST_FIXTURE_TEST_CASE(rpc_mempool_stream, BasicTestingSetup)
+{
+    CTxMemPool pool{MemPoolOptionsForTest(m_node)};
+    std::function<void()> on_first_chunk;
+    const auto stream{[&] {
+        std::string json;
+        size_t num_chunks{0};
+        const auto mempool_sequence{MempoolToJSONStream(pool, [&](const std::string& chunk) {
+            // Pieces are written as they are built, without the mempool lock.
+            AssertLockNotHeld(pool.cs);
+            json += chunk;
+            if (num_chunks++ == 0 && on_first_chunk) on_first_chunk();
+        })};
+        return std::make_tuple(json, num_chunks, mempool_sequence);
+    }};
+
+    BOOST_CHECK_EQUAL(std::get<0>(stream()), "{}");
+
+    // Enough transactions for several chunks, some of them spending others.
+    TestMemPoolEntryHelper entry;
+    CTransactionRef last_tx;
+    {
+        LOCK2(cs_main, pool.cs);
+        uint256 prev_hash;
+        for (int i = 0; i < 2500; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].scriptSig = CScript() << i;
+            if (i % 2) tx.vin[0].prevout = COutPoint{prev_hash, 0};
+            tx.vout.resize(1);
+            tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+            tx.vout[0].nValue = 1000;
+            pool.addUnchecked(entry.Fee(i).FromTx(tx));
+            prev_hash = tx.GetHash();
+            last_tx = MakeTransactionRef(tx);
+        }
+    }
+    const auto [json, num_chunks, mempool_sequence]{stream()};
+    BOOST_CHECK_EQUAL(json, MempoolToJSON(pool, /*verbose=*/true).write());
+    BOOST_CHECK_GT(num_chunks, 2U);
+    BOOST_CHECK_EQUAL(mempool_sequence.value(), WITH_LOCK(pool.cs, return pool.GetSequence()));
+
+    // A change while the result is written stops it, rather than mixing
+    // states of the mempool, and is reported.
+    on_first_chunk = [&] { WITH_LOCK(pool.cs, pool.removeForBlock({last_tx}, /*nBlockHeight=*/1)); };
+    const auto [changed_json, changed_num_chunks, changed_sequence]{stream()};
+    BOOST_CHECK(!changed_sequence);
+    BOOST_CHECK_EQUAL(changed_num_chunks, 1U);
+    UniValue changed_result;
+    BOOST_CHECK(!changed_result.read(changed_json));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
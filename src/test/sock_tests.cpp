@@ -11,6 +11,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <cassert>
+#include <memory>
 #include <thread>
 
 using namespace std::chrono_literals;
@@ -128,6 +129,56 @@ BOOST_AUTO_TEST_CASE(wait)
     waiter.join();
 }
 
+BOOST_AUTO_TEST_CASE(wait_set)
+{
+    const auto wait_set{SockWaitSet::Create()};
+#ifndef USE_EPOLL
+    BOOST_CHECK(!wait_set);
+#else
+    BOOST_REQUIRE(wait_set);
+
+    int s[2];
+    CreateSocketPair(s);
+    const auto sock0{std::make_shared<const Sock>(s[0])};
+    const auto sock1{std::make_shared<const Sock>(s[1])};
+
+    BOOST_CHECK(wait_set->Set(sock0, Sock::RECV));
+    BOOST_CHECK(wait_set->Set(sock1, Sock::RECV));
+    BOOST_CHECK_EQUAL(wait_set->Size(), 2U);
+
+    // Nothing is ready yet.
+    Sock::EventsPerSock events_per_sock;
+    BOOST_CHECK(wait_set->Wait(0ms, events_per_sock));
+    BOOST_CHECK(events_per_sock.empty());
+
+    // Only the socket that can be read from is returned.
+    BOOST_REQUIRE_EQUAL(sock1->Send("a", 1, 0), 1);
+    BOOST_CHECK(wait_set->Wait(1min, events_per_sock));
+    BOOST_REQUIRE_EQUAL(events_per_sock.size(), 1U);
+    BOOST_CHECK(events_per_sock.begin()->first == sock0);
+    BOOST_CHECK_EQUAL(events_per_sock.begin()->second.requested, Sock::RECV);
+    BOOST_CHECK_EQUAL(events_per_sock.begin()->second.occurred, Sock::RECV);
+
+    // Changing the requested events takes effect on the next wait.
+    BOOST_CHECK(wait_set->Set(sock0, Sock::SEND));
+    BOOST_CHECK(wait_set->Set(sock1, Sock::SEND));
+    BOOST_CHECK(wait_set->Wait(1min, events_per_sock));
+    BOOST_CHECK_EQUAL(events_per_sock.size(), 2U);
+    for (const auto& [sock, events] : events_per_sock) {
+        BOOST_CHECK_EQUAL(events.occurred, Sock::SEND);
+    }
+
+    // Removed sockets are no longer waited on, and are no longer referenced by the set.
+    events_per_sock.clear();
+    wait_set->Remove(sock0);
+    BOOST_CHECK_EQUAL(wait_set->Size(), 1U);
+    BOOST_CHECK_EQUAL(sock0.use_count(), 1);
+    BOOST_CHECK(wait_set->Wait(1min, events_per_sock));
+    BOOST_REQUIRE_EQUAL(events_per_sock.size(), 1U);
+    BOOST_CHECK(events_per_sock.begin()->first == sock1);
+#endif
+}
+
 BOOST_AUTO_TEST_CASE(recv_until_terminator_limit)
 {
     constexpr auto timeout = 1min; // High enough so that it is never hit.
@@ -3,9 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <index/blockfilterindex.h>
+#include <index/coinstatsindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
+#include <kernel/coinstats.h>
+#include <node/blockstorage.h>
 #include <script/standard.h>
+#include <test/util/mining.h>
 #include <test/util/setup_common.h>
 #include <util/time.h>
 #include <validation.h>
@@ -81,4 +86,84 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
     txindex.Stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(txindex_sync_with_other_indexes, TestingSetup)
+{
+    // Mine more blocks than the indexes keep while syncing, so that the ones
+    // that get ahead wait for the others.
+    std::vector<CTxIn> coinbase_ins;
+    for (int i = 0; i < 12; ++i) {
+        coinbase_ins.push_back(MineBlock(m_node, CScript() << OP_TRUE));
+    }
+
+    // Indexes syncing at the same time share the block and undo data they read.
+    TxIndex txindex(interfaces::MakeChain(m_node), 1 << 20, true);
+    BlockFilterIndex filter_index(interfaces::MakeChain(m_node), BlockFilterType::BASIC, 1 << 20, true);
+    CoinStatsIndex coin_stats_index(interfaces::MakeChain(m_node), 1 << 20, true);
+    BOOST_REQUIRE(txindex.Start());
+    BOOST_REQUIRE(filter_index.Start());
+    BOOST_REQUIRE(coin_stats_index.Start());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain() ||
+           !filter_index.BlockUntilSyncedToCurrentChain() ||
+           !coin_stats_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    for (const CTxIn& in : coinbase_ins) {
+        BOOST_CHECK(txindex.FindTx(in.prevout.hash, block_hash, tx_disk));
+    }
+
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip())};
+    for (const CBlockIndex* block_index{tip}; block_index; block_index = block_index->pprev) {
+        CBlock block;
+        BOOST_REQUIRE(node::ReadBlockFromDisk(block, block_index, m_node.chainman->GetConsensus()));
+        BlockFilter filter;
+        BOOST_CHECK(filter_index.LookupFilter(block_index, filter));
+        BOOST_CHECK(filter.GetBlockHash() == block.GetHash());
+    }
+    BOOST_CHECK(coin_stats_index.LookUpStats(*tip));
+
+    SyncWithValidationInterfaceQueue();
+    txindex.Stop();
+    filter_index.Stop();
+    coin_stats_index.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_parallel_sync, TestingSetup)
+{
+    std::vector<CTxIn> coinbase_ins;
+    for (int i = 0; i < 12; ++i) {
+        coinbase_ins.push_back(MineBlock(m_node, CScript() << OP_TRUE));
+    }
+
+    // Blocks prepared on several threads are all indexed.
+    TxIndex txindex(interfaces::MakeChain(m_node), 1 << 20, true);
+    txindex.SetSyncThreads(4);
+    BOOST_REQUIRE(txindex.Start());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    for (const CTxIn& in : coinbase_ins) {
+        BOOST_REQUIRE(txindex.FindTx(in.prevout.hash, block_hash, tx_disk));
+        BOOST_CHECK_EQUAL(tx_disk->GetHash(), in.prevout.hash);
+        LOCK(cs_main);
+        BOOST_CHECK(m_node.chainman->ActiveChain().Contains(m_node.chainman->m_blockman.LookupBlockIndex(block_hash)));
+    }
+
+    SyncWithValidationInterfaceQueue();
+    txindex.Stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
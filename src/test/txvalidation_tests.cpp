@@ -9,6 +9,8 @@
 #include <primitives/transaction.h>
 #include <script/script.h>
 #include <script/standard.h>
+#include <test/util/random.h>
+#include <test/util/script.h>
 #include <test/util/setup_common.h>
 #include <validation.h>
 
@@ -49,4 +51,44 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK_EQUAL(result.m_state.GetRejectReason(), "coinbase");
     BOOST_CHECK(result.m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
 }
+
+/**
+ * Ensure that the scripts of transactions with many inputs, which are checked
+ * on the script check worker threads, are accepted and rejected the same way
+ * as when they are checked serially.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_parallel_script_checks, TestingSetup)
+{
+    const auto spend_coins = [&](size_t num_inputs, const CScript& witness_script) {
+        CMutableTransaction mtx;
+        for (size_t i = 0; i < num_inputs; ++i) {
+            const COutPoint outpoint{InsecureRand256(), 0};
+            LOCK(cs_main);
+            m_node.chainman->ActiveChainstate().CoinsTip().AddCoin(outpoint, Coin{CTxOut{COIN, P2WSH_OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+            mtx.vin.emplace_back(outpoint);
+            mtx.vin.back().scriptWitness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
+        }
+        // Spend the last coin with the given script, which must match its output.
+        mtx.vin.back().scriptWitness.stack.back() = std::vector<unsigned char>(witness_script.begin(), witness_script.end());
+        mtx.vout.emplace_back(num_inputs * COIN - 100000, P2WSH_OP_TRUE);
+        LOCK(cs_main);
+        return m_node.chainman->ProcessTransaction(MakeTransactionRef(mtx));
+    };
+    // Enough inputs to be checked in parallel, and few enough to be checked serially.
+    constexpr size_t parallel_inputs{8};
+    constexpr size_t serial_inputs{2};
+
+    const MempoolAcceptResult valid{spend_coins(parallel_inputs, CScript() << OP_TRUE)};
+    BOOST_CHECK(valid.m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 1U);
+
+    const MempoolAcceptResult invalid{spend_coins(parallel_inputs, CScript() << OP_FALSE)};
+    const MempoolAcceptResult invalid_serial{spend_coins(serial_inputs, CScript() << OP_FALSE)};
+    BOOST_CHECK(invalid.m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(invalid.m_state.GetResult() == invalid_serial.m_state.GetResult());
+    BOOST_CHECK_EQUAL(invalid.m_state.GetRejectReason(), invalid_serial.m_state.GetRejectReason());
+    BOOST_CHECK_EQUAL(invalid.m_state.GetRejectReason(), "non-mandatory-script-verify-flag (Witness program hash mismatch)");
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
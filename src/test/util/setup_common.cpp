@@ -171,7 +171,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     // from blocking due to queue overrun.
     m_node.scheduler = std::make_unique<CScheduler>();
     m_node.scheduler->m_service_thread = std::thread(util::TraceThread, "scheduler", [&] { m_node.scheduler->serviceQueue(); });
-    GetMainSignals().RegisterBackgroundSignalScheduler(*m_node.scheduler);
+    GetMainSignals().StartBackgroundThreads(m_node.args->GetIntArg("-subscriberthreads", DEFAULT_NOTIFICATION_THREADS));
 
     m_node.fee_estimator = std::make_unique<CBlockPolicyEstimator>(FeeestPath(*m_node.args));
     m_node.mempool = std::make_unique<CTxMemPool>(MemPoolOptionsForTest(m_node));
@@ -192,14 +192,18 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
 
     constexpr int script_check_threads = 2;
     StartScriptCheckWorkerThreads(script_check_threads);
+    constexpr int coins_prefetch_threads = 2;
+    StartCoinsPrefetchWorkerThreads(coins_prefetch_threads);
 }
 
 ChainTestingSetup::~ChainTestingSetup()
 {
     if (m_node.scheduler) m_node.scheduler->stop();
+    GetMainSignals().StopBackgroundThreads();
     StopScriptCheckWorkerThreads();
+    StopCoinsPrefetchWorkerThreads();
     GetMainSignals().FlushBackgroundCallbacks();
-    GetMainSignals().UnregisterBackgroundSignalScheduler();
+    GetMainSignals().UnregisterBackgroundThreads();
     m_node.connman.reset();
     m_node.banman.reset();
     m_node.addrman.reset();
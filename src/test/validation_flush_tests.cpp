@@ -21,106 +21,45 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
 {
     Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
 
-    constexpr bool is_64_bit = sizeof(void*) == 8;
-
     LOCK(::cs_main);
     auto& view = chainstate.CoinsTip();
 
-    // The number of bytes consumed by coin's heap data, i.e. CScript
-    // (prevector<28, unsigned char>) when assigned 56 bytes of data per above.
-    //
-    // See also: Coin::DynamicMemoryUsage().
-    constexpr unsigned int COIN_SIZE = is_64_bit ? 80 : 64;
-
     auto print_view_mem_usage = [](CCoinsViewCache& view) {
         BOOST_TEST_MESSAGE("CCoinsViewCache memory usage: " << view.DynamicMemoryUsage());
     };
 
-    constexpr size_t MAX_COINS_CACHE_BYTES = 1024;
-
-    // Without any coins in the cache, we shouldn't need to flush.
-    BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
-        CoinsCacheSizeState::OK);
-
-    // If the initial memory allocations of cacheCoins don't match these common
-    // cases, we can't really continue to make assertions about memory usage.
-    // End the test early.
-    if (view.DynamicMemoryUsage() != 32 && view.DynamicMemoryUsage() != 16) {
-        // Add a bunch of coins to see that we at least flip over to CRITICAL.
-
-        for (int i{0}; i < 1000; ++i) {
-            const COutPoint res = AddTestCoin(view);
-            BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
-        }
-
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
-            CoinsCacheSizeState::CRITICAL);
-
-        BOOST_TEST_MESSAGE("Exiting cache flush tests early due to unsupported arch");
-        return;
-    }
-
+    // The coins map allocates its entries from chunks of a pool resource, and
+    // allocates the first chunk up front, so size the limits in chunks.
+    const size_t chunk_size{CCoinsMapMemoryResource{}.ChunkSizeBytes()};
     print_view_mem_usage(view);
-    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), is_64_bit ? 32U : 16U);
-
-    // We should be able to add COINS_UNTIL_CRITICAL coins to the cache before going CRITICAL.
-    // This is contingent not only on the dynamic memory usage of the Coins
-    // that we're adding (COIN_SIZE bytes per), but also on how much memory the
-    // cacheCoins (unordered_map) preallocates.
-    constexpr int COINS_UNTIL_CRITICAL{3};
-
-    for (int i{0}; i < COINS_UNTIL_CRITICAL; ++i) {
-        const COutPoint res = AddTestCoin(view);
+    BOOST_CHECK_GE(view.DynamicMemoryUsage(), chunk_size);
+    BOOST_CHECK_LT(view.DynamicMemoryUsage(), chunk_size * 11 / 10);
+
+    const size_t max_coins_cache_bytes{4 * chunk_size};
+    const size_t max_mempool_size_bytes{2 * chunk_size};
+    constexpr int MAX_ATTEMPTS{50000};
+
+    // Grow the cache from OK over LARGE to CRITICAL, first without and then
+    // with additional room from the mempool.
+    for (const size_t mempool_bytes : {size_t{0}, max_mempool_size_bytes}) {
+        const int64_t total_space{int64_t(max_coins_cache_bytes + mempool_bytes)};
+        const int64_t large_threshold{total_space * 9 / 10};
+
+        auto state{chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, mempool_bytes)};
+        for (int i{0}; i < MAX_ATTEMPTS && int64_t(view.DynamicMemoryUsage()) <= large_threshold; ++i) {
+            BOOST_CHECK_EQUAL(state, CoinsCacheSizeState::OK);
+            AddTestCoin(view);
+            state = chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, mempool_bytes);
+        }
         print_view_mem_usage(view);
-        BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
-            CoinsCacheSizeState::OK);
-    }
 
-    // Adding some additional coins will push us over the edge to CRITICAL.
-    for (int i{0}; i < 4; ++i) {
-        AddTestCoin(view);
-        print_view_mem_usage(view);
-        if (chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0) ==
-            CoinsCacheSizeState::CRITICAL) {
-            break;
+        for (int i{0}; i < MAX_ATTEMPTS && int64_t(view.DynamicMemoryUsage()) <= total_space; ++i) {
+            BOOST_CHECK_EQUAL(state, CoinsCacheSizeState::LARGE);
+            AddTestCoin(view);
+            state = chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, mempool_bytes);
         }
-    }
-
-    BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
-        CoinsCacheSizeState::CRITICAL);
-
-    // Passing non-zero max mempool usage should allow us more headroom.
-    BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/1 << 10),
-        CoinsCacheSizeState::OK);
-
-    for (int i{0}; i < 3; ++i) {
-        AddTestCoin(view);
         print_view_mem_usage(view);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/1 << 10),
-            CoinsCacheSizeState::OK);
-    }
-
-    // Adding another coin with the additional mempool room will put us >90%
-    // but not yet critical.
-    AddTestCoin(view);
-    print_view_mem_usage(view);
-
-    // Only perform these checks on 64 bit hosts; I haven't done the math for 32.
-    if (is_64_bit) {
-        float usage_percentage = (float)view.DynamicMemoryUsage() / (MAX_COINS_CACHE_BYTES + (1 << 10));
-        BOOST_TEST_MESSAGE("CoinsTip usage percentage: " << usage_percentage);
-        BOOST_CHECK(usage_percentage >= 0.9);
-        BOOST_CHECK(usage_percentage < 1);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 1 << 10),
-            CoinsCacheSizeState::LARGE);
+        BOOST_CHECK_EQUAL(state, CoinsCacheSizeState::CRITICAL);
     }
 
     // Using the default max_* values permits way more coins to be added.
@@ -131,11 +70,11 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
             CoinsCacheSizeState::OK);
     }
 
-    // Flushing the view doesn't take us back to OK because cacheCoins has
-    // preallocated memory that doesn't get reclaimed even after flush.
+    // Flushing the view doesn't take us back to OK because the pool resource
+    // keeps its chunks after the flush.
 
     BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
+        chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, 0),
         CoinsCacheSizeState::CRITICAL);
 
     view.SetBestBlock(InsecureRand256());
@@ -143,7 +82,7 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
     print_view_mem_usage(view);
 
     BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
+        chainstate.GetCoinsCacheSizeState(max_coins_cache_bytes, 0),
         CoinsCacheSizeState::CRITICAL);
 }
 
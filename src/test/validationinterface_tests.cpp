@@ -10,6 +10,8 @@
 #include <util/check.h>
 #include <validationinterface.h>
 
+#include <future>
+
 BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
 
 struct TestSubscriberNoop final : public CValidationInterface {
@@ -91,4 +93,64 @@ BOOST_AUTO_TEST_CASE(unregister_all_during_call)
     BOOST_CHECK(destroyed);
 }
 
+class TestMempoolSubscriber : public CValidationInterface
+{
+public:
+    explicit TestMempoolSubscriber(std::shared_future<void> release = {}) : m_release{std::move(release)} {}
+    void TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) override
+    {
+        if (m_release.valid()) m_release.wait();
+        m_sequences.push_back(mempool_sequence);
+        ++m_count;
+    }
+    std::shared_future<void> m_release;
+    std::vector<uint64_t> m_sequences;
+    std::atomic<int> m_count{0};
+};
+
+struct TwoNotificationThreadsSetup : public ChainTestingSetup {
+    TwoNotificationThreadsSetup() : ChainTestingSetup{CBaseChainParams::MAIN, {"-subscriberthreads=2"}} {}
+};
+
+// A subscriber that does not return from its callback must not hold up the
+// notifications of the other subscribers, when there is more than one thread.
+BOOST_FIXTURE_TEST_CASE(slow_subscriber_does_not_block_others, TwoNotificationThreadsSetup)
+{
+    constexpr int NUM_EVENTS{200};
+
+    std::promise<void> release;
+    auto slow{std::make_shared<TestMempoolSubscriber>(release.get_future().share())};
+    auto fast{std::make_shared<TestMempoolSubscriber>()};
+    RegisterSharedValidationInterface(slow);
+    RegisterSharedValidationInterface(fast);
+
+    const CTransactionRef tx{MakeTransactionRef(CMutableTransaction{})};
+    for (int i = 0; i < NUM_EVENTS; ++i) {
+        GetMainSignals().TransactionAddedToMempool(tx, i);
+    }
+    while (fast->m_count < NUM_EVENTS) {
+        UninterruptibleSleep(std::chrono::milliseconds{1});
+    }
+    BOOST_CHECK_EQUAL(slow->m_count, 0);
+    const ValidationQueueInfo info{GetMainSignals().GetQueueInfo()};
+    BOOST_CHECK_GE(info.subscribers, 2U);
+    // The slow subscriber took at most one batch of notifications off its queue.
+    BOOST_CHECK_GE(info.max_pending, size_t{NUM_EVENTS / 2});
+    BOOST_CHECK_GE(info.peak_pending, info.max_pending);
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), info.max_pending);
+
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), 0U);
+    for (const auto& subscriber : {slow, fast}) {
+        BOOST_REQUIRE_EQUAL(subscriber->m_sequences.size(), size_t{NUM_EVENTS});
+        for (int i = 0; i < NUM_EVENTS; ++i) {
+            BOOST_CHECK_EQUAL(subscriber->m_sequences[i], uint64_t(i));
+        }
+    }
+
+    UnregisterSharedValidationInterface(slow);
+    UnregisterSharedValidationInterface(fast);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,13 +7,22 @@
 
 #include <chain.h>
 #include <logging.h>
+#include <memusage.h>
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
 #include <uint256.h>
+#include <util/syscall_sandbox.h>
+#include <util/system.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <util/vector.h>
 
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <optional>
+#include <stdexcept>
 #include <stdint.h>
 
 static constexpr uint8_t DB_COIN{'C'};
@@ -75,8 +84,14 @@ CCoinsViewDB::CCoinsViewDB(DBParams db_params, CoinsViewOptions options) :
     m_options{std::move(options)},
     m_db{std::make_unique<CDBWrapper>(m_db_params)} { }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    WaitForBackgroundWrite();
+}
+
 void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 {
+    WaitForBackgroundWrite();
     // We can't do this operation with an in-memory DB since we'll lose all the coins upon
     // reset.
     if (!m_db_params.memory_only) {
@@ -90,14 +105,33 @@ void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (const auto pending{WITH_LOCK(m_pending_mutex, return m_pending)}) {
+        if (const auto it{pending->coins.find(outpoint)}; it != pending->coins.end()) {
+            if (it->second.coin.IsSpent()) return false;
+            coin = it->second.coin;
+            return true;
+        }
+    }
     return m_db->Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (const auto pending{WITH_LOCK(m_pending_mutex, return m_pending)}) {
+        if (const auto it{pending->coins.find(outpoint)}; it != pending->coins.end()) {
+            return !it->second.coin.IsSpent();
+        }
+    }
     return m_db->Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    if (const auto pending{WITH_LOCK(m_pending_mutex, return m_pending)}) {
+        return pending->best_block;
+    }
+    return ReadBestBlock();
+}
+
+uint256 CCoinsViewDB::ReadBestBlock() const {
     uint256 hashBestChain;
     if (!m_db->Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -113,12 +147,78 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) {
+    // Writes must reach the database in order.
+    if (!WaitForBackgroundWrite()) return false;
+    m_coins_written = 0;
+    m_coins_total = mapCoins.size();
+    return WriteCoins(mapCoins, hashBlock, erase);
+}
+
+void CCoinsViewDB::BatchWriteInBackground(std::unique_ptr<PendingCoinsWrite> write, std::function<void()> on_written)
+{
+    assert(!m_write_thread.joinable());
+    std::shared_ptr<PendingCoinsWrite> pending{std::move(write)};
+    size_t pending_usage{memusage::DynamicUsage(pending->coins)};
+    for (const auto& [outpoint, entry] : pending->coins) {
+        pending_usage += entry.coin.DynamicMemoryUsage();
+    }
+    m_pending_usage = pending_usage;
+    WITH_LOCK(m_pending_mutex, m_pending = pending);
+    m_coins_written = 0;
+    m_coins_total = pending->coins.size();
+    m_write_thread = std::thread(&util::TraceThread, "coinsflush", [this, pending, on_written = std::move(on_written)] {
+        SetSyscallSandboxPolicy(SyscallSandboxPolicy::VALIDATION_COINS_FLUSH);
+        bool ok{false};
+        try {
+            ok = WriteCoins(pending->coins, pending->best_block, /*erase=*/false);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("Error writing coin database in the background: %s\n", e.what());
+        }
+        if (!ok) {
+            // Keep serving the coins from memory; the next flush reports the failure.
+            WITH_LOCK(m_pending_mutex, m_write_failed = true);
+            m_pending_cv.notify_all();
+            return;
+        }
+        WITH_LOCK(m_pending_mutex, m_pending.reset());
+        m_pending_cv.notify_all();
+        m_pending_usage = 0;
+        if (on_written) on_written();
+    });
+}
+
+bool CCoinsViewDB::WaitForBackgroundWrite()
+{
+    if (m_write_thread.joinable()) m_write_thread.join();
+    return !m_write_failed;
+}
+
+bool CCoinsViewDB::WaitForCommitted(const uint256& block_hash)
+{
+    WAIT_LOCK(m_pending_mutex, lock);
+    m_pending_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_pending_mutex) {
+        return !m_pending || m_pending->best_block != block_hash || m_write_failed;
+    });
+    return !m_write_failed;
+}
+
+CoinsWriteProgress CCoinsViewDB::GetBackgroundWriteProgress() const
+{
+    return {
+        .in_progress = WITH_LOCK(m_pending_mutex, return m_pending != nullptr) && !m_write_failed,
+        .coins_written = m_coins_written,
+        .coins_total = m_coins_total,
+    };
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase)
+{
     CDBBatch batch(*m_db);
     size_t count = 0;
     size_t changed = 0;
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = ReadBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -150,6 +250,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, boo
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
             batch.Clear();
+            m_coins_written = count;
             if (m_options.simulate_crash_ratio) {
                 static FastRandomContext rng;
                 if (rng.randrange(m_options.simulate_crash_ratio) == 0) {
@@ -166,6 +267,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, boo
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = m_db->WriteBatch(batch);
+    m_coins_written = count;
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return ret;
 }
@@ -291,44 +393,137 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+namespace {
+/**
+ * A block index entry as stored by CDiskBlockIndex. Unlike CDiskBlockIndex,
+ * it can be deserialized without holding cs_main, so in any thread.
+ */
+struct DiskBlockIndexEntry {
+    int height{0};
+    uint32_t status{0};
+    unsigned int tx{0};
+    int file{0};
+    unsigned int data_pos{0};
+    unsigned int undo_pos{0};
+    CBlockHeader header;
+
+    SERIALIZE_METHODS(DiskBlockIndexEntry, obj)
+    {
+        int _nVersion = s.GetVersion();
+        READWRITE(VARINT_MODE(_nVersion, VarIntMode::NONNEGATIVE_SIGNED));
+
+        READWRITE(VARINT_MODE(obj.height, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(obj.status));
+        READWRITE(VARINT(obj.tx));
+        if (obj.status & (BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO)) READWRITE(VARINT_MODE(obj.file, VarIntMode::NONNEGATIVE_SIGNED));
+        if (obj.status & BLOCK_HAVE_DATA) READWRITE(VARINT(obj.data_pos));
+        if (obj.status & BLOCK_HAVE_UNDO) READWRITE(VARINT(obj.undo_pos));
+
+        READWRITE(obj.header);
+    }
+};
+
+/** Block index entries read from one key range of the block tree database. */
+struct BlockIndexRange {
+    std::vector<std::pair<uint256, DiskBlockIndexEntry>> entries;
+    std::string error;
+    bool interrupted{false};
+};
+} // namespace
+
+/** Number of key ranges the block index is split into for loading it in parallel. */
+static constexpr int BLOCK_INDEX_LOAD_RANGES{64};
+/** Maximum number of threads that read block index key ranges at the same time. */
+static constexpr int MAX_BLOCK_INDEX_LOAD_THREADS{8};
+
+/**
+ * Read, deserialize and check the block index entries with hashes in [begin, end),
+ * or in [begin, ...) if end is not set. Keys are ordered by the bytes of the hash.
+ */
+static BlockIndexRange ReadBlockIndexRange(CBlockTreeDB& db, const Consensus::Params& consensusParams, const uint256& begin, const std::optional<uint256>& end)
+{
+    BlockIndexRange range;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, begin));
+
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) {
+            range.interrupted = true;
+            return range;
+        }
+        std::pair<uint8_t, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || (end && !(key.second < *end))) break;
+        DiskBlockIndexEntry entry;
+        if (!pcursor->GetValue(entry)) {
+            range.error = "failed to read value";
+            return range;
+        }
+        const uint256 hash{entry.header.GetHash()};
+        if (!CheckProofOfWork(hash, entry.header.nBits, consensusParams)) {
+            range.error = strprintf("CheckProofOfWork failed: %s", hash.ToString());
+            return range;
+        }
+        range.entries.emplace_back(hash, std::move(entry));
+        pcursor->Next();
+    }
+
+    return range;
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     AssertLockHeld(::cs_main);
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+
+    // Reading the entries and checking their proof of work is done for several
+    // key ranges in parallel, while this thread adds the entries of the ranges
+    // that are done to m_block_index, in key order. Only a few ranges are held
+    // in memory at the same time.
+    const int num_threads{std::clamp(GetNumCores(), 1, MAX_BLOCK_INDEX_LOAD_THREADS)};
+    std::deque<std::future<BlockIndexRange>> reads;
+    int next_range{0};
+    const auto read_next_range{[&] {
+        // The first byte of the hash decides the range of an entry.
+        uint256 begin;
+        *begin.begin() = next_range * 256 / BLOCK_INDEX_LOAD_RANGES;
+        std::optional<uint256> end;
+        if (next_range + 1 < BLOCK_INDEX_LOAD_RANGES) {
+            end.emplace();
+            *end->begin() = (next_range + 1) * 256 / BLOCK_INDEX_LOAD_RANGES;
+        }
+        reads.push_back(std::async(std::launch::async, ReadBlockIndexRange, std::ref(*this), std::cref(consensusParams), begin, end));
+        ++next_range;
+    }};
+    while (next_range < BLOCK_INDEX_LOAD_RANGES && int(reads.size()) < num_threads) {
+        read_next_range();
+    }
 
     // Load m_block_index
-    while (pcursor->Valid()) {
-        if (ShutdownRequested()) return false;
-        std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.ConstructBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams)) {
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-                }
+    while (!reads.empty()) {
+        const BlockIndexRange range{reads.front().get()};
+        reads.pop_front();
+        if (range.interrupted) return false;
+        if (!range.error.empty()) {
+            return error("%s: %s", __func__, range.error);
+        }
+        if (next_range < BLOCK_INDEX_LOAD_RANGES) {
+            read_next_range();
+        }
 
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
-            }
-        } else {
-            break;
+        for (const auto& [hash, entry] : range.entries) {
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(hash);
+            pindexNew->pprev          = insertBlockIndex(entry.header.hashPrevBlock);
+            pindexNew->nHeight        = entry.height;
+            pindexNew->nFile          = entry.file;
+            pindexNew->nDataPos       = entry.data_pos;
+            pindexNew->nUndoPos       = entry.undo_pos;
+            pindexNew->nVersion       = entry.header.nVersion;
+            pindexNew->hashMerkleRoot = entry.header.hashMerkleRoot;
+            pindexNew->nTime          = entry.header.nTime;
+            pindexNew->nBits          = entry.header.nBits;
+            pindexNew->nNonce         = entry.header.nNonce;
+            pindexNew->nStatus        = entry.status;
+            pindexNew->nTx            = entry.tx;
         }
     }
 
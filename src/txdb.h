@@ -10,17 +10,23 @@
 #include <dbwrapper.h>
 #include <kernel/cs_main.h>
 #include <sync.h>
+#include <threadsafety.h>
+#include <uint256.h>
 #include <util/fs.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 class CBlockFileInfo;
 class CBlockIndex;
-class uint256;
 namespace Consensus {
 struct Params;
 };
@@ -30,6 +36,8 @@ struct bilingual_str;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -dbbackgroundflush default
+static constexpr bool DEFAULT_DB_BACKGROUND_FLUSH{false};
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -52,6 +60,22 @@ struct CoinsViewOptions {
     //! If non-zero, randomly exit when the database is flushed with (1/ratio)
     //! probability.
     int simulate_crash_ratio = 0;
+    //! Write the coins cache to the database from a background thread.
+    bool background_flush = DEFAULT_DB_BACKGROUND_FLUSH;
+};
+
+/** Modified coins handed to CCoinsViewDB::BatchWriteInBackground(). */
+struct PendingCoinsWrite {
+    CCoinsMapMemoryResource resource{};
+    CCoinsMap coins{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+    uint256 best_block;
+};
+
+/** Progress of the current or last background write of the coin database. */
+struct CoinsWriteProgress {
+    bool in_progress{false};
+    size_t coins_written{0};
+    size_t coins_total{0};
 };
 
 /** CCoinsView backed by the coin database (chainstate/) */
@@ -61,16 +85,58 @@ protected:
     DBParams m_db_params;
     CoinsViewOptions m_options;
     std::unique_ptr<CDBWrapper> m_db;
+
+    //! Coins that m_write_thread is writing. Reads are served from these
+    //! until the write is committed.
+    mutable Mutex m_pending_mutex;
+    std::shared_ptr<const PendingCoinsWrite> m_pending GUARDED_BY(m_pending_mutex);
+    //! Notified when m_pending is committed or its write failed.
+    std::condition_variable m_pending_cv;
+    std::thread m_write_thread;
+    std::atomic<bool> m_write_failed{false};
+    std::atomic<size_t> m_coins_written{0};
+    std::atomic<size_t> m_coins_total{0};
+    //! Memory used by m_pending, which counts against the coins cache size.
+    std::atomic<size_t> m_pending_usage{0};
+
+    uint256 ReadBestBlock() const;
+    bool WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase);
+
 public:
     explicit CCoinsViewDB(DBParams db_params, CoinsViewOptions options);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
+    //! Iterate over the coins on disk. Coins of a background write that is
+    //! still in progress are not visible; call WaitForBackgroundWrite() first.
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
 
+    /**
+     * Write the DIRTY entries of write->coins to the database from a separate
+     * thread and return immediately. Until the write is committed, the coins
+     * and best block of this view are served from write. on_written is called
+     * from the writing thread once the write has been committed.
+     * Only one background write can be in progress; call
+     * WaitForBackgroundWrite() first.
+     */
+    void BatchWriteInBackground(std::unique_ptr<PendingCoinsWrite> write, std::function<void()> on_written)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    //! Wait for the background write, if any, to finish. Returns false if it failed.
+    bool WaitForBackgroundWrite();
+    /**
+     * Wait until the coins of block_hash are committed, if a background write
+     * of them is in progress. Unlike WaitForBackgroundWrite(), this can be
+     * called from any thread. Returns false if the write failed.
+     */
+    bool WaitForCommitted(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    CoinsWriteProgress GetBackgroundWriteProgress() const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    //! Memory used by the coins of the background write until it is committed.
+    size_t PendingMemoryUsage() const { return m_pending_usage; }
+
     //! Whether an unsupported database format is used.
     bool NeedsUpgrade();
     size_t EstimateSize() const override;
@@ -24,9 +24,12 @@
 #include <util/translation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <cmath>
 #include <optional>
+#include <queue>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 
 bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp)
@@ -46,28 +49,95 @@ bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp)
     return true;
 }
 
+void TxMempoolReadIndex::Update(const CTxMemPoolEntry& entry)
+{
+    const Entry update{
+        .info = TxMempoolInfo{entry.GetSharedTx(), entry.GetTime(), entry.GetFee(), entry.GetTxSize(), entry.GetModifiedFee() - entry.GetFee()},
+        .count_with_ancestors = entry.GetCountWithAncestors(),
+    };
+    {
+        Shard& shard{m_txid_shards[ShardIndex(entry.GetTx().GetHash())]};
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        const auto [it, inserted]{shard.entries.try_emplace(entry.GetTx().GetHash(), update)};
+        if (inserted) {
+            m_size.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            it->second = update;
+        }
+    }
+    Shard& shard{m_wtxid_shards[ShardIndex(entry.GetTx().GetWitnessHash())]};
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.entries.insert_or_assign(entry.GetTx().GetWitnessHash(), update);
+}
+
+void TxMempoolReadIndex::Erase(const CTransaction& tx)
+{
+    {
+        Shard& shard{m_txid_shards[ShardIndex(tx.GetHash())]};
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (shard.entries.erase(tx.GetHash())) m_size.fetch_sub(1, std::memory_order_relaxed);
+    }
+    Shard& shard{m_wtxid_shards[ShardIndex(tx.GetWitnessHash())]};
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.entries.erase(tx.GetWitnessHash());
+}
+
+std::optional<TxMempoolReadIndex::Entry> TxMempoolReadIndex::Find(const GenTxid& gtxid) const
+{
+    const Shard& shard{(gtxid.IsWtxid() ? m_wtxid_shards : m_txid_shards)[ShardIndex(gtxid.GetHash())]};
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto it{shard.entries.find(gtxid.GetHash())};
+    if (it == shard.entries.end()) return std::nullopt;
+    return it->second;
+}
+
+std::vector<TxMempoolReadIndex::Entry> TxMempoolReadIndex::GetAll() const
+{
+    std::vector<Entry> entries;
+    entries.reserve(Size());
+    for (const Shard& shard : m_txid_shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& [txid, entry] : shard.entries) {
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+size_t TxMempoolReadIndex::DynamicMemoryUsage() const
+{
+    // Estimate each of the two hash table entries of a transaction as a node
+    // allocation plus a bucket pointer.
+    return 2 * (memusage::MallocUsage(sizeof(std::pair<const uint256, Entry>) + sizeof(void*)) + sizeof(void*)) * Size();
+}
+
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendants,
                                       const std::set<uint256>& setExclude, std::set<uint256>& descendants_to_remove)
 {
-    CTxMemPoolEntry::Children stageEntries, descendants;
-    stageEntries = updateIt->GetMemPoolChildrenConst();
-
-    while (!stageEntries.empty()) {
-        const CTxMemPoolEntry& descendant = *stageEntries.begin();
-        descendants.insert(descendant);
-        stageEntries.erase(descendant);
-        const CTxMemPoolEntry::Children& children = descendant.GetMemPoolChildrenConst();
-        for (const CTxMemPoolEntry& childEntry : children) {
-            cacheMap::iterator cacheIt = cachedDescendants.find(mapTx.iterator_to(childEntry));
-            if (cacheIt != cachedDescendants.end()) {
-                // We've already calculated this one, just add the entries for this set
-                // but don't traverse again.
-                for (txiter cacheEntry : cacheIt->second) {
-                    descendants.insert(*cacheEntry);
+    vecEntries stage, descendants;
+    {
+        WITH_FRESH_EPOCH(m_epoch);
+        for (const CTxMemPoolEntry& child : updateIt->GetMemPoolChildrenConst()) {
+            const txiter childit{mapTx.iterator_to(child)};
+            if (!visited(childit)) stage.push_back(childit);
+        }
+        while (!stage.empty()) {
+            const txiter descendant{stage.back()};
+            stage.pop_back();
+            descendants.push_back(descendant);
+            for (const CTxMemPoolEntry& childEntry : descendant->GetMemPoolChildrenConst()) {
+                const txiter childit{mapTx.iterator_to(childEntry)};
+                cacheMap::iterator cacheIt = cachedDescendants.find(childit);
+                if (cacheIt != cachedDescendants.end()) {
+                    // We've already calculated this one, just add the entries for this set
+                    // but don't traverse again.
+                    for (txiter cacheEntry : cacheIt->second) {
+                        if (!visited(cacheEntry)) descendants.push_back(cacheEntry);
+                    }
+                } else if (!visited(childit)) {
+                    // Schedule for later processing
+                    stage.push_back(childit);
                 }
-            } else if (!descendants.count(childEntry)) {
-                // Schedule for later processing
-                stageEntries.insert(childEntry);
             }
         }
     }
@@ -76,21 +146,22 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendan
     int64_t modifySize = 0;
     CAmount modifyFee = 0;
     int64_t modifyCount = 0;
-    for (const CTxMemPoolEntry& descendant : descendants) {
-        if (!setExclude.count(descendant.GetTx().GetHash())) {
-            modifySize += descendant.GetTxSize();
-            modifyFee += descendant.GetModifiedFee();
+    for (txiter descendant : descendants) {
+        if (!setExclude.count(descendant->GetTx().GetHash())) {
+            modifySize += descendant->GetTxSize();
+            modifyFee += descendant->GetModifiedFee();
             modifyCount++;
-            cachedDescendants[updateIt].insert(mapTx.iterator_to(descendant));
+            cachedDescendants[updateIt].push_back(descendant);
             // Update ancestor state for each descendant
-            mapTx.modify(mapTx.iterator_to(descendant), [=](CTxMemPoolEntry& e) {
+            mapTx.modify(descendant, [=](CTxMemPoolEntry& e) {
               e.UpdateAncestorState(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost());
             });
+            m_read_index.Update(*descendant);
             // Don't directly remove the transaction here -- doing so would
             // invalidate iterators in cachedDescendants. Mark it for removal
             // by inserting into descendants_to_remove.
-            if (descendant.GetCountWithAncestors() > uint64_t(m_limits.ancestor_count) || descendant.GetSizeWithAncestors() > uint64_t(m_limits.ancestor_size_vbytes)) {
-                descendants_to_remove.insert(descendant.GetTx().GetHash());
+            if (descendant->GetCountWithAncestors() > uint64_t(m_limits.ancestor_count) || descendant->GetSizeWithAncestors() > uint64_t(m_limits.ancestor_size_vbytes)) {
+                descendants_to_remove.insert(descendant->GetTx().GetHash());
             }
         }
     }
@@ -140,6 +211,7 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256>& vHashes
                 }
             }
         } // release epoch guard for UpdateForDescendants
+        MergeClusters(it);
         UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded, descendants_to_remove);
     }
 
@@ -150,23 +222,27 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256>& vHashes
             removeRecursive((*txiter)->GetTx(), MemPoolRemovalReason::SIZELIMIT);
         }
     }
+    LinearizeClusters();
 }
 
-util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateAncestorsAndCheckLimits(
+util::Result<CTxMemPool::vecEntries> CTxMemPool::CalculateAncestorsAndCheckLimits(
     size_t entry_size,
     size_t entry_count,
-    CTxMemPoolEntry::Parents& staged_ancestors,
+    const CTxMemPoolEntry::Parents& staged_ancestors,
     const Limits& limits) const
 {
     size_t totalSizeWithAncestors = entry_size;
-    setEntries ancestors;
-
-    while (!staged_ancestors.empty()) {
-        const CTxMemPoolEntry& stage = staged_ancestors.begin()->get();
-        txiter stageit = mapTx.iterator_to(stage);
+    // ancestors doubles as the queue of entries whose parents are still to be walked.
+    vecEntries ancestors;
+    ancestors.reserve(staged_ancestors.size());
+    WITH_FRESH_EPOCH(m_epoch);
+    for (const CTxMemPoolEntry& stage : staged_ancestors) {
+        const txiter stageit{mapTx.iterator_to(stage)};
+        if (!visited(stageit)) ancestors.push_back(stageit);
+    }
 
-        ancestors.insert(stageit);
-        staged_ancestors.erase(stage);
+    for (size_t i = 0; i < ancestors.size(); ++i) {
+        const txiter stageit{ancestors[i]};
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry_size > static_cast<uint64_t>(limits.descendant_size_vbytes)) {
@@ -182,10 +258,10 @@ util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateAncestorsAndCheckLimit
             txiter parent_it = mapTx.iterator_to(parent);
 
             // If this is a new ancestor, add it.
-            if (ancestors.count(parent_it) == 0) {
-                staged_ancestors.insert(parent);
+            if (!visited(parent_it)) {
+                ancestors.push_back(parent_it);
             }
-            if (staged_ancestors.size() + ancestors.size() + entry_count > static_cast<uint64_t>(limits.ancestor_count)) {
+            if (ancestors.size() + entry_count > static_cast<uint64_t>(limits.ancestor_count)) {
                 return util::Error{Untranslated(strprintf("too many unconfirmed ancestors [limit: %u]", limits.ancestor_count))};
             }
         }
@@ -219,19 +295,51 @@ bool CTxMemPool::CheckPackageLimits(const Package& package,
     const auto ancestors{CalculateAncestorsAndCheckLimits(total_size, package.size(),
                                                           staged_ancestors, limits)};
     // It's possible to overestimate the ancestor/descendant totals.
-    if (!ancestors.has_value()) errString = "possibly " + util::ErrorString(ancestors).original;
-    return ancestors.has_value();
+    if (!ancestors.has_value()) {
+        errString = "possibly " + util::ErrorString(ancestors).original;
+        return false;
+    }
+    if (const auto err_string{CheckClusterLimit(*ancestors, /*conflicts=*/{}, package.size(), limits)}) {
+        errString = *err_string;
+        return false;
+    }
+    return true;
 }
 
-util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateMemPoolAncestors(
+std::optional<std::string> CTxMemPool::CheckClusterLimit(const vecEntries& ancestors,
+                                                         const setEntries& conflicts,
+                                                         size_t entry_count,
+                                                         const Limits& limits) const
+{
+    AssertLockHeld(cs);
+    // Clusters are linearized, and thus split into connected components,
+    // whenever the mempool is updated.
+    Assume(m_dirty_clusters.empty());
+    std::set<uint64_t> ids;
+    for (const txiter ancestor : ancestors) ids.insert(ancestor->m_cluster_id);
+
+    uint64_t cluster_count{entry_count};
+    for (const uint64_t id : ids) cluster_count += m_clusters.at(id).txs.size();
+    setEntries removed;
+    for (const txiter conflict : conflicts) CalculateDescendants(conflict, removed);
+    for (const txiter it : removed) {
+        if (ids.count(it->m_cluster_id)) --cluster_count;
+    }
+    if (cluster_count > static_cast<uint64_t>(limits.cluster_count)) {
+        return strprintf("too many transactions in the cluster [limit: %u]", limits.cluster_count);
+    }
+    return std::nullopt;
+}
+
+util::Result<CTxMemPool::vecEntries> CTxMemPool::CalculateMemPoolAncestors(
     const CTxMemPoolEntry &entry,
     const Limits& limits,
     bool fSearchForParents /* = true */) const
 {
-    CTxMemPoolEntry::Parents staged_ancestors;
     const CTransaction &tx = entry.GetTx();
 
     if (fSearchForParents) {
+        CTxMemPoolEntry::Parents staged_ancestors;
         // Get parents of this transaction that are in the mempool
         // GetMemPoolParents() is only valid for entries in the mempool, so we
         // iterate mapTx to find parents.
@@ -244,18 +352,18 @@ util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateMemPoolAncestors(
                 }
             }
         }
+        return CalculateAncestorsAndCheckLimits(entry.GetTxSize(), /*entry_count=*/1, staged_ancestors,
+                                                limits);
     } else {
         // If we're not searching for parents, we require this to already be an
         // entry in the mempool and use the entry's cached parents.
         txiter it = mapTx.iterator_to(entry);
-        staged_ancestors = it->GetMemPoolParentsConst();
+        return CalculateAncestorsAndCheckLimits(entry.GetTxSize(), /*entry_count=*/1, it->GetMemPoolParentsConst(),
+                                                limits);
     }
-
-    return CalculateAncestorsAndCheckLimits(entry.GetTxSize(), /*entry_count=*/1, staged_ancestors,
-                                            limits);
 }
 
-CTxMemPool::setEntries CTxMemPool::AssumeCalculateMemPoolAncestors(
+CTxMemPool::vecEntries CTxMemPool::AssumeCalculateMemPoolAncestors(
     std::string_view calling_fn_name,
     const CTxMemPoolEntry &entry,
     const Limits& limits,
@@ -266,10 +374,10 @@ CTxMemPool::setEntries CTxMemPool::AssumeCalculateMemPoolAncestors(
         LogPrintLevel(BCLog::MEMPOOL, BCLog::Level::Error, "%s: CalculateMemPoolAncestors failed unexpectedly, continuing with empty ancestor set (%s)\n",
                       calling_fn_name, util::ErrorString(result).original);
     }
-    return std::move(result).value_or(CTxMemPool::setEntries{});
+    return std::move(result).value_or(CTxMemPool::vecEntries{});
 }
 
-void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
+void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, const vecEntries& ancestors)
 {
     const CTxMemPoolEntry::Parents& parents = it->GetMemPoolParentsConst();
     // add or remove this tx as a child of each parent
@@ -279,18 +387,18 @@ void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors
     const int64_t updateCount = (add ? 1 : -1);
     const int64_t updateSize = updateCount * it->GetTxSize();
     const CAmount updateFee = updateCount * it->GetModifiedFee();
-    for (txiter ancestorIt : setAncestors) {
+    for (txiter ancestorIt : ancestors) {
         mapTx.modify(ancestorIt, [=](CTxMemPoolEntry& e) { e.UpdateDescendantState(updateSize, updateFee, updateCount); });
     }
 }
 
-void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncestors)
+void CTxMemPool::UpdateEntryForAncestors(txiter it, const vecEntries& ancestors)
 {
-    int64_t updateCount = setAncestors.size();
+    int64_t updateCount = ancestors.size();
     int64_t updateSize = 0;
     CAmount updateFee = 0;
     int64_t updateSigOpsCost = 0;
-    for (txiter ancestorIt : setAncestors) {
+    for (txiter ancestorIt : ancestors) {
         updateSize += ancestorIt->GetTxSize();
         updateFee += ancestorIt->GetModifiedFee();
         updateSigOpsCost += ancestorIt->GetSigOpCost();
@@ -306,7 +414,7 @@ void CTxMemPool::UpdateChildrenForRemoval(txiter it)
     }
 }
 
-void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants)
+void CTxMemPool::UpdateForRemoveFromMempool(const vecEntries& entriesToRemove, bool updateDescendants)
 {
     // For each entry, walk back all ancestors and decrement size associated with this
     // transaction
@@ -317,15 +425,20 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // Here we only update statistics and not data in CTxMemPool::Parents
         // and CTxMemPoolEntry::Children (which we need to preserve until we're
         // finished with all operations that need to traverse the mempool).
+        vecEntries descendants;
         for (txiter removeIt : entriesToRemove) {
-            setEntries setDescendants;
-            CalculateDescendants(removeIt, setDescendants);
-            setDescendants.erase(removeIt); // don't update state for self
+            descendants.clear();
+            {
+                WITH_FRESH_EPOCH(m_epoch);
+                CalculateDescendants(removeIt, descendants);
+            }
             int64_t modifySize = -((int64_t)removeIt->GetTxSize());
             CAmount modifyFee = -removeIt->GetModifiedFee();
             int modifySigOps = -removeIt->GetSigOpCost();
-            for (txiter dit : setDescendants) {
-                mapTx.modify(dit, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(modifySize, modifyFee, -1, modifySigOps); });
+            // descendants starts with removeIt itself, don't update state for self
+            for (auto dit = std::next(descendants.begin()); dit != descendants.end(); ++dit) {
+                mapTx.modify(*dit, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(modifySize, modifyFee, -1, modifySigOps); });
+                m_read_index.Update(**dit);
             }
         }
     }
@@ -415,11 +528,16 @@ void CTxMemPool::AddTransactionsUpdated(unsigned int n)
     nTransactionsUpdated += n;
 }
 
-void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAncestors, bool validFeeEstimate)
+void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, const vecEntries& ancestors, bool validFeeEstimate)
 {
     // Add to memory pool without checking anything.
     // Used by AcceptToMemoryPool(), which DOES do
     // all the appropriate checks.
+
+    // Drop the transactions that this one replaced from their clusters
+    // first, so that it joins clusters that are linearized.
+    LinearizeClusters();
+
     indexed_transaction_set::iterator newit = mapTx.insert(entry).first;
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
@@ -453,8 +571,12 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     for (const auto& pit : GetIterSet(setParentTransactions)) {
             UpdateParent(newit, pit, true);
     }
-    UpdateAncestorsOf(true, newit, setAncestors);
-    UpdateEntryForAncestors(newit, setAncestors);
+    UpdateAncestorsOf(true, newit, ancestors);
+    UpdateEntryForAncestors(newit, ancestors);
+    m_read_index.Update(*newit);
+    newit->m_cluster_id = 0;
+    MergeClusters(newit);
+    LinearizeClusters();
 
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
@@ -500,6 +622,18 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     RemoveUnbroadcastTx(hash, true /* add logging because unchecked */ );
 
+    // The entry is dropped from its cluster, which is split up if needed,
+    // when the cluster is linearized again.
+    const auto cluster_it{m_clusters.find(it->m_cluster_id)};
+    auto& cluster{cluster_it->second};
+    cluster.removed.push_back(it->m_cluster_pos);
+    if (cluster.removed.size() == cluster.txs.size()) {
+        m_clusters.erase(cluster_it);
+        m_dirty_clusters.erase(it->m_cluster_id);
+    } else {
+        m_dirty_clusters.insert(it->m_cluster_id);
+    }
+
     if (vTxHashes.size() > 1) {
         vTxHashes[it->vTxHashesIdx] = std::move(vTxHashes.back());
         vTxHashes[it->vTxHashesIdx].second->vTxHashesIdx = it->vTxHashesIdx;
@@ -513,6 +647,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     m_total_fee -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    m_read_index.Erase(it->GetTx());
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
@@ -526,36 +661,49 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 // can save time by not iterating over those entries.
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries& setDescendants) const
 {
-    setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
-        stage.insert(entryit);
-    }
+    if (!setDescendants.insert(entryit).second) return;
+    vecEntries stage{entryit};
     // Traverse down the children of entry, only adding children that are not
     // accounted for in setDescendants already (because those children have either
     // already been walked, or will be walked in this iteration).
     while (!stage.empty()) {
-        txiter it = *stage.begin();
-        setDescendants.insert(it);
-        stage.erase(it);
+        const txiter it{stage.back()};
+        stage.pop_back();
 
         const CTxMemPoolEntry::Children& children = it->GetMemPoolChildrenConst();
         for (const CTxMemPoolEntry& child : children) {
             txiter childiter = mapTx.iterator_to(child);
-            if (!setDescendants.count(childiter)) {
-                stage.insert(childiter);
+            if (setDescendants.insert(childiter).second) {
+                stage.push_back(childiter);
             }
         }
     }
 }
 
+void CTxMemPool::CalculateDescendants(txiter entryit, vecEntries& descendants) const
+{
+    if (visited(entryit)) return;
+    // The entries from first on double as the queue of entries whose children
+    // are still to be walked.
+    size_t next{descendants.size()};
+    descendants.push_back(entryit);
+    while (next < descendants.size()) {
+        const txiter it{descendants[next++]};
+        for (const CTxMemPoolEntry& child : it->GetMemPoolChildrenConst()) {
+            const txiter childiter{mapTx.iterator_to(child)};
+            if (!visited(childiter)) descendants.push_back(childiter);
+        }
+    }
+}
+
 void CTxMemPool::removeRecursive(const CTransaction &origTx, MemPoolRemovalReason reason)
 {
     // Remove transaction from memory pool
     AssertLockHeld(cs);
-        setEntries txToRemove;
+        vecEntries txToRemove;
         txiter origit = mapTx.find(origTx.GetHash());
         if (origit != mapTx.end()) {
-            txToRemove.insert(origit);
+            txToRemove.push_back(origit);
         } else {
             // When recursively removing but origTx isn't in the mempool
             // be sure to remove any children that are in the pool. This can
@@ -567,15 +715,19 @@ void CTxMemPool::removeRecursive(const CTransaction &origTx, MemPoolRemovalReaso
                     continue;
                 txiter nextit = mapTx.find(it->second->GetHash());
                 assert(nextit != mapTx.end());
-                txToRemove.insert(nextit);
+                txToRemove.push_back(nextit);
             }
         }
-        setEntries setAllRemoves;
-        for (txiter it : txToRemove) {
-            CalculateDescendants(it, setAllRemoves);
+        vecEntries all_removes;
+        {
+            WITH_FRESH_EPOCH(m_epoch);
+            for (txiter it : txToRemove) {
+                CalculateDescendants(it, all_removes);
+            }
         }
 
-        RemoveStaged(setAllRemoves, false, reason);
+        RemoveStaged(all_removes, false, reason);
+        LinearizeClusters();
 }
 
 void CTxMemPool::removeForReorg(CChain& chain, std::function<bool(txiter)> check_final_and_mature)
@@ -584,15 +736,19 @@ void CTxMemPool::removeForReorg(CChain& chain, std::function<bool(txiter)> check
     AssertLockHeld(cs);
     AssertLockHeld(::cs_main);
 
-    setEntries txToRemove;
+    vecEntries txToRemove;
     for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
-        if (check_final_and_mature(it)) txToRemove.insert(it);
+        if (check_final_and_mature(it)) txToRemove.push_back(it);
     }
-    setEntries setAllRemoves;
-    for (txiter it : txToRemove) {
-        CalculateDescendants(it, setAllRemoves);
+    vecEntries all_removes;
+    {
+        WITH_FRESH_EPOCH(m_epoch);
+        for (txiter it : txToRemove) {
+            CalculateDescendants(it, all_removes);
+        }
     }
-    RemoveStaged(setAllRemoves, false, MemPoolRemovalReason::REORG);
+    RemoveStaged(all_removes, false, MemPoolRemovalReason::REORG);
+    LinearizeClusters();
     for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
         assert(TestLockPointValidity(chain, it->GetLockPoints()));
     }
@@ -636,13 +792,12 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     {
         txiter it = mapTx.find(tx->GetHash());
         if (it != mapTx.end()) {
-            setEntries stage;
-            stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+            RemoveStaged(vecEntries{it}, true, MemPoolRemovalReason::BLOCK);
         }
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
     }
+    LinearizeClusters();
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = true;
 }
@@ -694,6 +849,13 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
         };
         assert(setParentCheck.size() == it->GetMemPoolParentsConst().size());
         assert(std::equal(setParentCheck.begin(), setParentCheck.end(), it->GetMemPoolParentsConst().begin(), comp));
+        // Check that the entry shares its cluster with its parents.
+        const auto& cluster_txs{m_clusters.at(it->m_cluster_id).txs};
+        assert(cluster_txs.at(it->m_cluster_pos) == it);
+        for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) {
+            assert(parent.m_cluster_id == it->m_cluster_id);
+            assert(parent.m_cluster_pos < it->m_cluster_pos);
+        }
         // Verify ancestor state is correct.
         auto ancestors{AssumeCalculateMemPoolAncestors(__func__, *it, Limits::NoLimits())};
         uint64_t nCountCheck = ancestors.size() + 1;
@@ -747,31 +909,16 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
         assert(&tx == it->second);
     }
 
+    size_t cluster_tx_count{0};
+    for (const auto& [_, cluster] : m_clusters) cluster_tx_count += cluster.txs.size();
+    assert(cluster_tx_count == mapTx.size());
+    assert(m_dirty_clusters.empty());
+
     assert(totalTxSize == checkTotal);
     assert(m_total_fee == check_total_fee);
     assert(innerUsage == cachedInnerUsage);
 }
 
-bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid)
-{
-    /* Return `true` if hasha should be considered sooner than hashb. Namely when:
-     *   a is not in the mempool, but b is
-     *   both are in the mempool and a has fewer ancestors than b
-     *   both are in the mempool and a has a higher score than b
-     */
-    LOCK(cs);
-    indexed_transaction_set::const_iterator j = wtxid ? get_iter_from_wtxid(hashb) : mapTx.find(hashb);
-    if (j == mapTx.end()) return false;
-    indexed_transaction_set::const_iterator i = wtxid ? get_iter_from_wtxid(hasha) : mapTx.find(hasha);
-    if (i == mapTx.end()) return true;
-    uint64_t counta = i->GetCountWithAncestors();
-    uint64_t countb = j->GetCountWithAncestors();
-    if (counta == countb) {
-        return CompareTxMemPoolEntryByScore()(*i, *j);
-    }
-    return counta < countb;
-}
-
 namespace {
 class DepthAndScoreComparator
 {
@@ -785,9 +932,38 @@ public:
         }
         return counta < countb;
     }
+
+    /** Same order for read index entries. */
+    bool operator()(const TxMempoolReadIndex::Entry& a, const TxMempoolReadIndex::Entry& b) const
+    {
+        if (a.count_with_ancestors == b.count_with_ancestors) {
+            // See CompareTxMemPoolEntryByScore
+            double f1 = (double)a.info.fee * b.info.vsize;
+            double f2 = (double)b.info.fee * a.info.vsize;
+            if (f1 == f2) {
+                return b.info.tx->GetHash() < a.info.tx->GetHash();
+            }
+            return f1 > f2;
+        }
+        return a.count_with_ancestors < b.count_with_ancestors;
+    }
 };
 } // namespace
 
+bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid)
+{
+    /* Return `true` if hasha should be considered sooner than hashb. Namely when:
+     *   a is not in the mempool, but b is
+     *   both are in the mempool and a has fewer ancestors than b
+     *   both are in the mempool and a has a higher score than b
+     */
+    const auto j{m_read_index.Find(wtxid ? GenTxid::Wtxid(hashb) : GenTxid::Txid(hashb))};
+    if (!j) return false;
+    const auto i{m_read_index.Find(wtxid ? GenTxid::Wtxid(hasha) : GenTxid::Txid(hasha))};
+    if (!i) return true;
+    return DepthAndScoreComparator()(*i, *j);
+}
+
 std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::GetSortedDepthAndScore() const
 {
     std::vector<indexed_transaction_set::const_iterator> iters;
@@ -804,30 +980,26 @@ std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::Get
 
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid) const
 {
-    LOCK(cs);
-    auto iters = GetSortedDepthAndScore();
+    auto entries{m_read_index.GetAll()};
+    std::sort(entries.begin(), entries.end(), DepthAndScoreComparator());
 
     vtxid.clear();
-    vtxid.reserve(mapTx.size());
+    vtxid.reserve(entries.size());
 
-    for (auto it : iters) {
-        vtxid.push_back(it->GetTx().GetHash());
+    for (const auto& entry : entries) {
+        vtxid.push_back(entry.info.tx->GetHash());
     }
 }
 
-static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
-    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), it->GetFee(), it->GetTxSize(), it->GetModifiedFee() - it->GetFee()};
-}
-
 std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
 {
-    LOCK(cs);
-    auto iters = GetSortedDepthAndScore();
+    auto entries{m_read_index.GetAll()};
+    std::sort(entries.begin(), entries.end(), DepthAndScoreComparator());
 
     std::vector<TxMempoolInfo> ret;
-    ret.reserve(mapTx.size());
-    for (auto it : iters) {
-        ret.push_back(GetInfo(it));
+    ret.reserve(entries.size());
+    for (auto& entry : entries) {
+        ret.push_back(std::move(entry.info));
     }
 
     return ret;
@@ -835,20 +1007,18 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
 
 CTransactionRef CTxMemPool::get(const uint256& hash) const
 {
-    LOCK(cs);
-    indexed_transaction_set::const_iterator i = mapTx.find(hash);
-    if (i == mapTx.end())
+    const auto entry{m_read_index.Find(GenTxid::Txid(hash))};
+    if (!entry)
         return nullptr;
-    return i->GetSharedTx();
+    return entry->info.tx;
 }
 
 TxMempoolInfo CTxMemPool::info(const GenTxid& gtxid) const
 {
-    LOCK(cs);
-    indexed_transaction_set::const_iterator i = (gtxid.IsWtxid() ? get_iter_from_wtxid(gtxid.GetHash()) : mapTx.find(gtxid.GetHash()));
-    if (i == mapTx.end())
+    const auto entry{m_read_index.Find(gtxid)};
+    if (!entry)
         return TxMempoolInfo();
-    return GetInfo(i);
+    return entry->info;
 }
 
 void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeDelta)
@@ -860,19 +1030,25 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
             mapTx.modify(it, [&nFeeDelta](CTxMemPoolEntry& e) { e.UpdateModifiedFee(nFeeDelta); });
+            m_read_index.Update(*it);
+            m_clusters.at(it->m_cluster_id).needs_sort = true;
+            m_dirty_clusters.insert(it->m_cluster_id);
             // Now update all ancestors' modified fees with descendants
             auto ancestors{AssumeCalculateMemPoolAncestors(__func__, *it, Limits::NoLimits(), /*fSearchForParents=*/false)};
             for (txiter ancestorIt : ancestors) {
                 mapTx.modify(ancestorIt, [=](CTxMemPoolEntry& e){ e.UpdateDescendantState(0, nFeeDelta, 0);});
             }
             // Now update all descendants' modified fees with ancestors
-            setEntries setDescendants;
-            CalculateDescendants(it, setDescendants);
-            setDescendants.erase(it);
-            for (txiter descendantIt : setDescendants) {
-                mapTx.modify(descendantIt, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(0, nFeeDelta, 0, 0); });
+            vecEntries descendants;
+            {
+                WITH_FRESH_EPOCH(m_epoch);
+                CalculateDescendants(it, descendants);
+            }
+            for (auto descendantIt = std::next(descendants.begin()); descendantIt != descendants.end(); ++descendantIt) {
+                mapTx.modify(*descendantIt, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(0, nFeeDelta, 0, 0); });
             }
             ++nTransactionsUpdated;
+            LinearizeClusters();
         }
     }
     LogPrintf("PrioritiseTransaction: %s fee += %s\n", hash.ToString(), FormatMoney(nFeeDelta));
@@ -960,7 +1136,10 @@ void CCoinsViewMemPool::PackageAddTransaction(const CTransactionRef& tx)
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // Estimate each entry as an iterator and at most one chunk in its cluster,
+    // plus at most one cluster node and bucket pointer in m_clusters.
+    const size_t cluster_usage{(sizeof(txiter) + sizeof(Cluster::Chunk) + memusage::MallocUsage(sizeof(std::pair<const uint64_t, Cluster>) + sizeof(void*)) + sizeof(void*)) * mapTx.size()};
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + m_read_index.DynamicMemoryUsage() + cachedInnerUsage + cluster_usage;
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -973,6 +1152,12 @@ void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked)
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
+    AssertLockHeld(cs);
+    RemoveStaged(vecEntries(stage.begin(), stage.end()), updateDescendants, reason);
+}
+
+void CTxMemPool::RemoveStaged(const vecEntries& stage, bool updateDescendants, MemPoolRemovalReason reason)
+{
     AssertLockHeld(cs);
     UpdateForRemoveFromMempool(stage, updateDescendants);
     for (txiter it : stage) {
@@ -984,16 +1169,16 @@ int CTxMemPool::Expire(std::chrono::seconds time)
 {
     AssertLockHeld(cs);
     indexed_transaction_set::index<entry_time>::type::iterator it = mapTx.get<entry_time>().begin();
-    setEntries toremove;
-    while (it != mapTx.get<entry_time>().end() && it->GetTime() < time) {
-        toremove.insert(mapTx.project<0>(it));
-        it++;
-    }
-    setEntries stage;
-    for (txiter removeit : toremove) {
-        CalculateDescendants(removeit, stage);
+    vecEntries stage;
+    {
+        WITH_FRESH_EPOCH(m_epoch);
+        while (it != mapTx.get<entry_time>().end() && it->GetTime() < time) {
+            CalculateDescendants(mapTx.project<0>(it), stage);
+            it++;
+        }
     }
     RemoveStaged(stage, false, MemPoolRemovalReason::EXPIRY);
+    LinearizeClusters();
     return stage.size();
 }
 
@@ -1025,6 +1210,251 @@ void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
     }
 }
 
+namespace {
+bool HigherFeerate(CAmount fee_a, int64_t size_a, CAmount fee_b, int64_t size_b)
+{
+    return double(fee_a) * size_b > double(fee_b) * size_a;
+}
+
+/** Add txs[pos] as a chunk, merged into the chunks before it while that raises their feerate. */
+void AppendToChunks(CTxMemPool::Cluster& cluster, size_t pos)
+{
+    const CTxMemPool::txiter tx{cluster.txs[pos]};
+    tx->m_cluster_pos = pos;
+    CTxMemPool::Cluster::Chunk chunk{tx->GetModifiedFee(), int64_t(tx->GetTxSize()), tx->GetSigOpCost(), pos + 1};
+    while (!cluster.chunks.empty() && HigherFeerate(chunk.fee, chunk.size, cluster.chunks.back().fee, cluster.chunks.back().size)) {
+        chunk.fee += cluster.chunks.back().fee;
+        chunk.size += cluster.chunks.back().size;
+        chunk.sigop_cost += cluster.chunks.back().sigop_cost;
+        cluster.chunks.pop_back();
+    }
+    cluster.chunks.push_back(chunk);
+}
+
+/** Order the transactions of a connected cluster for a block and split them into chunks. */
+void LinearizeComponent(CTxMemPool::Cluster& cluster)
+{
+    auto& txs{cluster.txs};
+    const size_t n{txs.size()};
+
+    // Take the transactions by ancestor score, each after its remaining
+    // ancestors. Sorting keeps this at O(n log n) for a cluster of n entries.
+    std::sort(txs.begin(), txs.end(), [](CTxMemPool::txiter a, CTxMemPool::txiter b) {
+        return CompareTxMemPoolEntryByAncestorFee{}(*a, *b);
+    });
+    std::unordered_map<const CTxMemPoolEntry*, size_t> index;
+    index.reserve(n);
+    for (size_t i = 0; i < n; ++i) index.emplace(&*txs[i], i);
+
+    std::vector<CTxMemPool::txiter> sorted;
+    sorted.reserve(n);
+    std::vector<bool> included(n);
+    std::vector<std::pair<size_t, bool>> stack;
+    for (size_t i = 0; i < n; ++i) {
+        stack.emplace_back(i, false);
+        while (!stack.empty()) {
+            const auto [pos, parents_included]{stack.back()};
+            stack.pop_back();
+            if (included[pos]) continue;
+            if (parents_included) {
+                included[pos] = true;
+                sorted.push_back(txs[pos]);
+                continue;
+            }
+            stack.emplace_back(pos, true);
+            for (const CTxMemPoolEntry& parent : txs[pos]->GetMemPoolParentsConst()) {
+                const size_t parent_pos{index.at(&parent)};
+                if (!included[parent_pos]) stack.emplace_back(parent_pos, false);
+            }
+        }
+    }
+    assert(sorted.size() == n);
+    txs = std::move(sorted);
+
+    cluster.chunks.clear();
+    for (size_t i = 0; i < n; ++i) AppendToChunks(cluster, i);
+}
+
+/** Drop the entries removed from the mempool from txs, keeping the order of the others. */
+void DropRemoved(CTxMemPool::Cluster& cluster)
+{
+    if (cluster.removed.empty()) return;
+    // The removed entries are gone from mapTx, only their positions are known.
+    std::vector<bool> removed(cluster.txs.size());
+    for (const size_t pos : cluster.removed) removed[pos] = true;
+    size_t kept{0};
+    for (size_t pos = 0; pos < cluster.txs.size(); ++pos) {
+        if (removed[pos]) continue;
+        cluster.txs[kept] = cluster.txs[pos];
+        cluster.txs[kept]->m_cluster_pos = kept;
+        ++kept;
+    }
+    cluster.txs.resize(kept);
+    cluster.removed.clear();
+    cluster.chunks.clear();
+}
+
+/**
+ * Fill cluster with the linearized clusters in sources, taking their chunks
+ * by feerate. Each source keeps the order of its transactions, so the result
+ * is valid for a block as long as no source depends on another.
+ */
+void MergeLinearizations(CTxMemPool::Cluster& cluster, const std::vector<CTxMemPool::Cluster>& sources)
+{
+    // Next chunk to take, as the index of its source and of the chunk in it.
+    using Cursor = std::pair<size_t, size_t>;
+    const auto lower_feerate{[&sources](const Cursor& a, const Cursor& b) {
+        const auto& chunk_a{sources[a.first].chunks[a.second]};
+        const auto& chunk_b{sources[b.first].chunks[b.second]};
+        return HigherFeerate(chunk_b.fee, chunk_b.size, chunk_a.fee, chunk_a.size);
+    }};
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(lower_feerate)> next{lower_feerate};
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!sources[i].chunks.empty()) next.emplace(i, 0);
+    }
+    cluster.txs.clear();
+    cluster.chunks.clear();
+    while (!next.empty()) {
+        const auto [source, chunk]{next.top()};
+        next.pop();
+        const auto& from{sources[source]};
+        for (size_t pos = chunk == 0 ? 0 : from.chunks[chunk - 1].end; pos < from.chunks[chunk].end; ++pos) {
+            cluster.txs.push_back(from.txs[pos]);
+            AppendToChunks(cluster, cluster.txs.size() - 1);
+        }
+        if (chunk + 1 < from.chunks.size()) next.emplace(source, chunk + 1);
+    }
+}
+} // namespace
+
+void CTxMemPool::MergeClusters(txiter it)
+{
+    AssertLockHeld(cs);
+    std::set<uint64_t> ids;
+    if (it->m_cluster_id != 0) ids.insert(it->m_cluster_id);
+    for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) ids.insert(parent.m_cluster_id);
+    for (const CTxMemPoolEntry& child : it->GetMemPoolChildrenConst()) ids.insert(child.m_cluster_id);
+
+    // Move everything into the largest cluster.
+    uint64_t target{0};
+    // A new entry without children that joins linearized clusters can go
+    // last, after all of its parents.
+    bool incremental{it->m_cluster_id == 0 && it->GetMemPoolChildrenConst().empty()};
+    size_t merged_size{1};
+    for (const uint64_t id : ids) {
+        const auto& other{m_clusters.at(id)};
+        if (target == 0 || other.txs.size() > m_clusters.at(target).txs.size()) target = id;
+        incremental = incremental && !m_dirty_clusters.count(id);
+        merged_size += other.txs.size();
+    }
+    if (target == 0) target = m_next_cluster_id++;
+    auto& cluster{m_clusters[target]};
+    // Small clusters are sorted again when they are merged, or when the
+    // entry would pay for earlier chunks.
+    const bool fits_last{ids.size() <= 1 && (cluster.chunks.empty() || !HigherFeerate(it->GetModifiedFee(), it->GetTxSize(), cluster.chunks.back().fee, cluster.chunks.back().size))};
+    if (incremental && (fits_last || merged_size > MAX_CLUSTER_SORT_SIZE)) {
+        if (ids.size() > 1) {
+            std::vector<Cluster> sources;
+            sources.push_back(std::move(cluster));
+            for (const uint64_t id : ids) {
+                if (id == target) continue;
+                const auto other{m_clusters.find(id)};
+                for (const txiter member : other->second.txs) member->m_cluster_id = target;
+                sources.push_back(std::move(other->second));
+                m_clusters.erase(other);
+            }
+            MergeLinearizations(cluster, sources);
+        }
+        it->m_cluster_id = target;
+        cluster.txs.push_back(it);
+        AppendToChunks(cluster, cluster.txs.size() - 1);
+        return;
+    }
+    DropRemoved(cluster);
+    for (const uint64_t id : ids) {
+        if (id == target) continue;
+        const auto other{m_clusters.find(id)};
+        DropRemoved(other->second);
+        for (const txiter member : other->second.txs) {
+            member->m_cluster_id = target;
+            member->m_cluster_pos = cluster.txs.size();
+            cluster.txs.push_back(member);
+        }
+        m_clusters.erase(other);
+        m_dirty_clusters.erase(id);
+    }
+    if (it->m_cluster_id != target) {
+        it->m_cluster_id = target;
+        it->m_cluster_pos = cluster.txs.size();
+        cluster.txs.push_back(it);
+    }
+    cluster.needs_sort = true;
+    m_dirty_clusters.insert(target);
+}
+
+void CTxMemPool::LinearizeCluster(uint64_t id)
+{
+    AssertLockHeld(cs);
+    if (!m_dirty_clusters.erase(id)) return;
+    const auto cluster_it{m_clusters.find(id)};
+    if (cluster_it == m_clusters.end()) return;
+    DropRemoved(cluster_it->second);
+    const bool needs_sort{cluster_it->second.needs_sort};
+    const std::vector<txiter> members{std::move(cluster_it->second.txs)};
+    m_clusters.erase(cluster_it);
+
+    // Removals may have split the cluster. The first component keeps
+    // the id, every other one gets a new cluster.
+    std::vector<uint64_t> component_ids;
+    {
+        WITH_FRESH_EPOCH(m_epoch);
+        std::vector<txiter> todo;
+        for (const txiter member : members) {
+            if (visited(member)) continue;
+            const uint64_t component_id{component_ids.empty() ? id : m_next_cluster_id++};
+            component_ids.push_back(component_id);
+            todo.push_back(member);
+            while (!todo.empty()) {
+                const txiter tx{todo.back()};
+                todo.pop_back();
+                tx->m_cluster_id = component_id;
+                for (const CTxMemPoolEntry& parent : tx->GetMemPoolParentsConst()) {
+                    const txiter parent_it{mapTx.iterator_to(parent)};
+                    if (!visited(parent_it)) todo.push_back(parent_it);
+                }
+                for (const CTxMemPoolEntry& child : tx->GetMemPoolChildrenConst()) {
+                    const txiter child_it{mapTx.iterator_to(child)};
+                    if (!visited(child_it)) todo.push_back(child_it);
+                }
+            }
+        }
+    }
+    // Every component keeps the order its transactions had in the cluster,
+    // which is still valid for a block.
+    for (const txiter member : members) m_clusters[member->m_cluster_id].txs.push_back(member);
+    for (const uint64_t component_id : component_ids) {
+        auto& cluster{m_clusters.at(component_id)};
+        if (needs_sort || cluster.txs.size() <= MAX_CLUSTER_SORT_SIZE) {
+            LinearizeComponent(cluster);
+        } else {
+            for (size_t i = 0; i < cluster.txs.size(); ++i) AppendToChunks(cluster, i);
+        }
+    }
+}
+
+void CTxMemPool::LinearizeClusters()
+{
+    AssertLockHeld(cs);
+    while (!m_dirty_clusters.empty()) LinearizeCluster(*m_dirty_clusters.begin());
+}
+
+const std::unordered_map<uint64_t, CTxMemPool::Cluster>& CTxMemPool::GetClusters() const
+{
+    AssertLockHeld(cs);
+    Assume(m_dirty_clusters.empty());
+    return m_clusters;
+}
+
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
     LOCK(cs);
     if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
@@ -1074,8 +1504,11 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
-        setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
+        vecEntries stage;
+        {
+            WITH_FRESH_EPOCH(m_epoch);
+            CalculateDescendants(mapTx.project<0>(it), stage);
+        }
         nTxnRemoved += stage.size();
 
         std::vector<CTransaction> txn;
@@ -1095,6 +1528,8 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
         }
     }
 
+    LinearizeClusters();
+
     if (maxFeeRateRemoved > CFeeRate(0)) {
         LogPrint(BCLog::MEMPOOL, "Removed %u txn, rolling minimum fee bumped to %s\n", nTxnRemoved, maxFeeRateRemoved.ToString());
     }
@@ -1103,13 +1538,13 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
 uint64_t CTxMemPool::CalculateDescendantMaximum(txiter entry) const {
     // find parent with highest descendant count
     std::vector<txiter> candidates;
-    setEntries counted;
     candidates.push_back(entry);
     uint64_t maximum = 0;
+    WITH_FRESH_EPOCH(m_epoch);
     while (candidates.size()) {
         txiter candidate = candidates.back();
         candidates.pop_back();
-        if (!counted.insert(candidate).second) continue;
+        if (visited(candidate)) continue;
         const CTxMemPoolEntry::Parents& parents = candidate->GetMemPoolParentsConst();
         if (parents.size() == 0) {
             maximum = std::max(maximum, candidate->GetCountWithDescendants());
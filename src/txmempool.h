@@ -6,12 +6,16 @@
 #ifndef MYTHERRA_TXMEMPOOL_H
 #define MYTHERRA_TXMEMPOOL_H
 
+#include <array>
 #include <atomic>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -225,6 +229,48 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * Copy of the relay data of the mempool entries that can be read without
+ * CTxMemPool::cs, so that lookups from RPC and transaction relay don't wait
+ * for transaction acceptance or block connection. CTxMemPool updates an
+ * entry, while holding cs, whenever the fields kept here change.
+ *
+ * Entries are spread over shards by txid and by wtxid. Each shard has its
+ * own lock, which readers take shared and writers take for a single update.
+ * Lookups see every update as soon as it is made, but iterating all entries
+ * is not atomic with respect to concurrent updates.
+ */
+class TxMempoolReadIndex
+{
+public:
+    struct Entry {
+        TxMempoolInfo info;
+        uint64_t count_with_ancestors{0};
+    };
+
+    /** Add or update the entry for a mempool transaction. */
+    void Update(const CTxMemPoolEntry& entry);
+    void Erase(const CTransaction& tx);
+    std::optional<Entry> Find(const GenTxid& gtxid) const;
+    std::vector<Entry> GetAll() const;
+    size_t Size() const { return m_size.load(std::memory_order_relaxed); }
+    size_t DynamicMemoryUsage() const;
+
+private:
+    static constexpr size_t NUM_SHARDS{32};
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<uint256, Entry, SaltedTxidHasher> entries;
+    };
+
+    std::array<Shard, NUM_SHARDS> m_txid_shards;
+    std::array<Shard, NUM_SHARDS> m_wtxid_shards;
+    std::atomic<size_t> m_size{0};
+
+    static size_t ShardIndex(const uint256& hash) { return hash.GetUint64(0) % NUM_SHARDS; }
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -330,8 +376,9 @@ protected:
 
     // In-memory counter for external mempool tracking purposes.
     // This number is incremented once every time a transaction
-    // is added or removed from the mempool for any reason.
-    mutable uint64_t m_sequence_number GUARDED_BY(cs){1};
+    // is added or removed from the mempool for any reason. Only
+    // incremented while holding cs, but may be read without it.
+    mutable std::atomic<uint64_t> m_sequence_number{1};
 
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -409,12 +456,46 @@ public:
     std::vector<std::pair<uint256, txiter>> vTxHashes GUARDED_BY(cs); //!< All tx witness hashes/entries in mapTx, in random order
 
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
+    //! Entries collected by an epoch-marked walk, each at most once, in the order they were visited.
+    typedef std::vector<txiter> vecEntries;
+
+    /**
+     * A connected component of the transaction graph of the mempool. Once
+     * linearized, txs is in an order that is valid for a block, and is split
+     * into chunks of non-increasing feerate: a block that includes a chunk
+     * must include all chunks before it.
+     */
+    struct Cluster {
+        struct Chunk {
+            CAmount fee{0};
+            int64_t size{0};
+            int64_t sigop_cost{0};
+            //! Index in txs past the last transaction of the chunk.
+            size_t end{0};
+        };
+        std::vector<txiter> txs;
+        std::vector<Chunk> chunks;
+        //! Positions in txs of the entries removed from the mempool since the
+        //! cluster was last linearized. They are dropped from txs then.
+        std::vector<size_t> removed;
+        //! Whether txs has to be sorted again when the cluster is linearized,
+        //! rather than keep its order.
+        bool needs_sort{false};
+    };
+
+    /**
+     * Clusters up to this many transactions are sorted again whenever they
+     * change. Larger ones keep the order of their transactions and take new
+     * ones incrementally, so that accepting a transaction costs time linear
+     * in the size of its cluster.
+     */
+    static constexpr size_t MAX_CLUSTER_SORT_SIZE{100};
 
     using Limits = kernel::MemPoolLimits;
 
-    uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs) LOCKS_EXCLUDED(m_epoch);
 private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
+    typedef std::map<txiter, vecEntries, CompareIteratorByHash> cacheMap;
 
 
     void UpdateParent(txiter entry, txiter parent, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -427,6 +508,32 @@ private:
      */
     std::set<uint256> m_unbroadcast_txids GUARDED_BY(cs);
 
+    //! Relay data of mapTx, for readers that don't hold cs. Only updated while holding cs.
+    TxMempoolReadIndex m_read_index;
+
+    //! Clusters of the mempool, by CTxMemPoolEntry::m_cluster_id.
+    std::unordered_map<uint64_t, Cluster> m_clusters GUARDED_BY(cs);
+    //! Clusters that were modified since they were last linearized.
+    std::set<uint64_t> m_dirty_clusters GUARDED_BY(cs);
+    uint64_t m_next_cluster_id GUARDED_BY(cs){1};
+
+    /**
+     * Put an entry into one cluster with its in-mempool parents and children.
+     * A new entry without children is added to the linearization of its
+     * parents' clusters, which are merged by chunk feerate, without sorting
+     * them again. See MAX_CLUSTER_SORT_SIZE.
+     */
+    void MergeClusters(txiter it) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /**
+     * If the cluster was modified, split it into connected components and
+     * linearize them. Small components, and those that need it, are sorted
+     * again. Others keep the order of their transactions and are only split
+     * into chunks again.
+     */
+    void LinearizeCluster(uint64_t id) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Split the modified clusters into connected components and linearize them. */
+    void LinearizeClusters() EXCLUSIVE_LOCKS_REQUIRED(cs);
+
 
     /**
      * Helper function to calculate all in-mempool ancestors of staged_ancestors and apply ancestor
@@ -437,13 +544,14 @@ private:
      * @param[in]   staged_ancestors    Should contain entries in the mempool.
      * @param[in]   limits              Maximum number and size of ancestors and descendants
      *
-     * @return all in-mempool ancestors, or an error if any ancestor or descendant limits were hit
+     * @return all in-mempool ancestors, each once and in no particular order, or an error if any
+     *         ancestor or descendant limits were hit
      */
-    util::Result<setEntries> CalculateAncestorsAndCheckLimits(size_t entry_size,
+    util::Result<vecEntries> CalculateAncestorsAndCheckLimits(size_t entry_size,
                                                               size_t entry_count,
-                                                              CTxMemPoolEntry::Parents &staged_ancestors,
+                                                              const CTxMemPoolEntry::Parents& staged_ancestors,
                                                               const Limits& limits
-                                                              ) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+                                                              ) const EXCLUSIVE_LOCKS_REQUIRED(cs) LOCKS_EXCLUDED(m_epoch);
 
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
@@ -486,7 +594,7 @@ public:
     // and any other callers may break wallet's in-mempool tracking (due to
     // lack of CValidationInterface::TransactionAddedToMempool callbacks).
     void addUnchecked(const CTxMemPoolEntry& entry, bool validFeeEstimate = true) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
-    void addUnchecked(const CTxMemPoolEntry& entry, setEntries& setAncestors, bool validFeeEstimate = true) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
+    void addUnchecked(const CTxMemPoolEntry& entry, const vecEntries& ancestors, bool validFeeEstimate = true) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
 
     void removeRecursive(const CTransaction& tx, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** After reorg, filter the entries that would no longer be valid in the next block, and update
@@ -533,6 +641,7 @@ public:
      *  that any in-mempool descendants have their ancestor state updated.
      */
     void RemoveStaged(setEntries& stage, bool updateDescendants, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void RemoveStaged(const vecEntries& stage, bool updateDescendants, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     /** UpdateTransactionsFromBlock is called when adding transactions from a
      * disconnected block back to the mempool, new mempool entries may have
@@ -559,27 +668,29 @@ public:
      *                                  up parents from mapLinks. Must be true for entries not in
      *                                  the mempool
      *
-     * @return all in-mempool ancestors, or an error if any ancestor or descendant limits were hit
+     * @return all in-mempool ancestors, each once and in no particular order, or an error if any
+     *         ancestor or descendant limits were hit. Callers that look entries up can build a
+     *         setEntries from it.
      */
-    util::Result<setEntries> CalculateMemPoolAncestors(const CTxMemPoolEntry& entry,
+    util::Result<vecEntries> CalculateMemPoolAncestors(const CTxMemPoolEntry& entry,
                                    const Limits& limits,
                                    bool fSearchForParents = true) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     /**
-     * Same as CalculateMemPoolAncestors, but always returns a (non-optional) setEntries.
+     * Same as CalculateMemPoolAncestors, but always returns a (non-optional) vecEntries.
      * Should only be used when it is assumed CalculateMemPoolAncestors would not fail. If
-     * CalculateMemPoolAncestors does unexpectedly fail, an empty setEntries is returned and the
+     * CalculateMemPoolAncestors does unexpectedly fail, an empty vecEntries is returned and the
      * error is logged to BCLog::MEMPOOL with level BCLog::Level::Error. In debug builds, failure
      * of CalculateMemPoolAncestors will lead to shutdown due to assertion failure.
      *
      * @param[in]   calling_fn_name     Name of calling function so we can properly log the call site
      *
-     * @return a setEntries corresponding to the result of CalculateMemPoolAncestors or an empty
-     *         setEntries if it failed
+     * @return a vecEntries corresponding to the result of CalculateMemPoolAncestors or an empty
+     *         vecEntries if it failed
      *
      * @see CTXMemPool::CalculateMemPoolAncestors()
      */
-    setEntries AssumeCalculateMemPoolAncestors(
+    vecEntries AssumeCalculateMemPoolAncestors(
         std::string_view calling_fn_name,
         const CTxMemPoolEntry &entry,
         const Limits& limits,
@@ -601,10 +712,30 @@ public:
                             const Limits& limits,
                             std::string &errString) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /**
+     * Check that adding entries with the given in-mempool ancestors would not grow their
+     * cluster past limits.cluster_count, which bounds the work of keeping it linearized.
+     * The conflicts are not counted, as they are removed along with their descendants.
+     * @param[in]   ancestors       In-mempool ancestors of the entries
+     * @param[in]   conflicts       In-mempool transactions that the entries replace
+     * @param[in]   entry_count     How many entries to include in the limit
+     * @param[in]   limits          Maximum number of transactions in a cluster
+     *
+     * @return an error string if the limit was hit
+     */
+    std::optional<std::string> CheckClusterLimit(const vecEntries& ancestors,
+                                                 const setEntries& conflicts,
+                                                 size_t entry_count,
+                                                 const Limits& limits) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Populate setDescendants with all in-mempool descendants of hash.
      *  Assumes that setDescendants includes all in-mempool descendants of anything
      *  already in it.  */
     void CalculateDescendants(txiter it, setEntries& setDescendants) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Append it and all its in-mempool descendants to descendants, skipping
+     *  entries that were already visited in the current epoch. Calls within
+     *  one epoch thus collect the union of the descendants without duplicates. */
+    void CalculateDescendants(txiter it, vecEntries& descendants) const EXCLUSIVE_LOCKS_REQUIRED(cs, m_epoch);
 
     /** The minimum fee to get into the mempool, which may itself not be enough
      *  for larger-sized transactions.
@@ -647,8 +778,7 @@ public:
 
     unsigned long size() const
     {
-        LOCK(cs);
-        return mapTx.size();
+        return m_read_index.Size();
     }
 
     uint64_t GetTotalTxSize() const EXCLUSIVE_LOCKS_REQUIRED(cs)
@@ -665,11 +795,7 @@ public:
 
     bool exists(const GenTxid& gtxid) const
     {
-        LOCK(cs);
-        if (gtxid.IsWtxid()) {
-            return (mapTx.get<index_by_wtxid>().count(gtxid.GetHash()) != 0);
-        }
-        return (mapTx.count(gtxid.GetHash()) != 0);
+        return m_read_index.Find(gtxid).has_value();
     }
 
     CTransactionRef get(const uint256& hash) const;
@@ -683,6 +809,9 @@ public:
 
     size_t DynamicMemoryUsage() const;
 
+    /** Returns the clusters of the mempool, linearized. */
+    const std::unordered_map<uint64_t, Cluster>& GetClusters() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Adds a transaction to the unbroadcast set */
     void AddUnbroadcastTx(const uint256& txid)
     {
@@ -714,7 +843,8 @@ public:
         return m_sequence_number++;
     }
 
-    uint64_t GetSequence() const EXCLUSIVE_LOCKS_REQUIRED(cs) {
+    /** Callers that need the sequence to match the contents of the mempool must hold cs. */
+    uint64_t GetSequence() const {
         return m_sequence_number;
     }
 
@@ -748,15 +878,15 @@ private:
      *     removeRecursive them.
      */
     void UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendants,
-                              const std::set<uint256>& setExclude, std::set<uint256>& descendants_to_remove) EXCLUSIVE_LOCKS_REQUIRED(cs);
+                              const std::set<uint256>& setExclude, std::set<uint256>& descendants_to_remove) EXCLUSIVE_LOCKS_REQUIRED(cs) LOCKS_EXCLUDED(m_epoch);
     /** Update ancestors of hash to add/remove it as a descendant transaction. */
-    void UpdateAncestorsOf(bool add, txiter hash, setEntries &setAncestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void UpdateAncestorsOf(bool add, txiter hash, const vecEntries& ancestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** Set ancestor state for an entry */
-    void UpdateEntryForAncestors(txiter it, const setEntries &setAncestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void UpdateEntryForAncestors(txiter it, const vecEntries& ancestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** For each transaction being removed, update ancestors and any direct children.
       * If updateDescendants is true, then also update in-mempool descendants'
       * ancestor state. */
-    void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void UpdateForRemoveFromMempool(const vecEntries& entriesToRemove, bool updateDescendants) EXCLUSIVE_LOCKS_REQUIRED(cs) LOCKS_EXCLUDED(m_epoch);
     /** Sever link between specified transaction and direct children. */
     void UpdateChildrenForRemoval(txiter entry) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
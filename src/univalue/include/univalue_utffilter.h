@@ -45,6 +45,14 @@ public:
                 push_back_u(codepoint);
         }
     }
+    // Write a run of 7-bit ASCII chars, as if each was passed to push_back
+    void append_ascii(const char* chars, size_t len)
+    {
+        if (len == 0) return;
+        if (state) // ASCII in the middle of a multi-byte sequence, invalid
+            is_valid = false;
+        str.append(chars, len);
+    }
     // Write codepoint directly, possibly collating surrogate pairs
     void push_back_u(unsigned int codepoint_)
     {
@@ -9,8 +9,13 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*
  * According to stackexchange, the original json test suite wanted
  * to limit depth to 22.  Widely-deployed PHP bails at depth 512,
@@ -51,6 +56,39 @@ static const char *hatoui(const char *first, const char *last,
     return first;
 }
 
+/**
+ * Length of the run of chars at the start of [raw, end) that can be copied
+ * into a string token as they are: 7-bit ASCII other than control chars, '"'
+ * and '\\'. Hex strings, which make up most of large requests, consist of a
+ * single run.
+ */
+static size_t plainStringRun(const char* raw, const char* end)
+{
+    const char* p = raw;
+#if defined(__SSE2__)
+    // Compare 16 chars at a time. As signed chars, bytes from 0x80 up are
+    // negative, so one "less than 0x20" test catches both control chars and
+    // non-ASCII bytes.
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i special = _mm_or_si128(_mm_cmplt_epi8(chars, space),
+                                             _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)));
+        const int mask = _mm_movemask_epi8(special);
+        if (mask != 0) return (p - raw) + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end) {
+        const unsigned char ch = static_cast<unsigned char>(*p);
+        if (ch < 0x20 || ch >= 0x80 || ch == '"' || ch == '\\') break;
+        p++;
+    }
+    return p - raw;
+}
+
 enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
                             const char *raw, const char *end)
 {
@@ -123,8 +161,6 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
     case '8':
     case '9': {
         // part 1: int
-        std::string numStr;
-
         const char *first = raw;
 
         const char *firstDigit = first;
@@ -133,49 +169,42 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
         if ((*firstDigit == '0') && json_isdigit(firstDigit[1]))
             return JTOK_ERR;
 
-        numStr += *raw;                       // copy first char
-        raw++;
+        raw++;                                // skip first char
 
         if ((*first == '-') && (raw < end) && (!json_isdigit(*raw)))
             return JTOK_ERR;
 
-        while (raw < end && json_isdigit(*raw)) {  // copy digits
-            numStr += *raw;
+        while (raw < end && json_isdigit(*raw)) {  // skip digits
             raw++;
         }
 
         // part 2: frac
         if (raw < end && *raw == '.') {
-            numStr += *raw;                   // copy .
-            raw++;
+            raw++;                            // skip .
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) { // skip digits
                 raw++;
             }
         }
 
         // part 3: exp
         if (raw < end && (*raw == 'e' || *raw == 'E')) {
-            numStr += *raw;                   // copy E
-            raw++;
+            raw++;                            // skip E
 
-            if (raw < end && (*raw == '-' || *raw == '+')) { // copy +/-
-                numStr += *raw;
+            if (raw < end && (*raw == '-' || *raw == '+')) { // skip +/-
                 raw++;
             }
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) { // skip digits
                 raw++;
             }
         }
 
-        tokenVal = numStr;
+        tokenVal.assign(first, raw);          // copy the number at once
         consumed = (raw - rawStart);
         return JTOK_NUMBER;
         }
@@ -187,6 +216,10 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
         JSONUTF8StringFilter writer(valStr);
 
         while (true) {
+            const size_t run = plainStringRun(raw, end);
+            writer.append_ascii(raw, run);    // copy plain chars at once
+            raw += run;
+
             if (raw >= end || (unsigned char)*raw < 0x20)
                 return JTOK_ERR;
 
@@ -237,7 +270,7 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
 
         if (!writer.finalize())
             return JTOK_ERR;
-        tokenVal = valStr;
+        tokenVal = std::move(valStr);
         consumed = (raw - rawStart);
         return JTOK_STRING;
         }
@@ -415,14 +448,14 @@ bool UniValue::read(const char *raw, size_t size)
             }
 
         case JTOK_NUMBER: {
-            UniValue tmpVal(VNUM, tokenVal);
+            UniValue tmpVal(VNUM, std::move(tokenVal));
             if (!stack.size()) {
-                *this = tmpVal;
+                *this = std::move(tmpVal);
                 break;
             }
 
             UniValue *top = stack.back();
-            top->values.push_back(tmpVal);
+            top->values.push_back(std::move(tmpVal));
 
             setExpect(NOT_VALUE);
             break;
@@ -431,17 +464,17 @@ bool UniValue::read(const char *raw, size_t size)
         case JTOK_STRING: {
             if (expect(OBJ_NAME)) {
                 UniValue *top = stack.back();
-                top->keys.push_back(tokenVal);
+                top->keys.push_back(std::move(tokenVal));
                 clearExpect(OBJ_NAME);
                 setExpect(COLON);
             } else {
-                UniValue tmpVal(VSTR, tokenVal);
+                UniValue tmpVal(VSTR, std::move(tokenVal));
                 if (!stack.size()) {
-                    *this = tmpVal;
+                    *this = std::move(tmpVal);
                     break;
                 }
                 UniValue *top = stack.back();
-                top->values.push_back(tmpVal);
+                top->values.push_back(std::move(tmpVal));
             }
 
             setExpect(NOT_VALUE);
@@ -428,6 +428,31 @@ void univalue_readwrite()
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+void univalue_readwrite_strings()
+{
+    // The parser copies plain runs of string chars at once; check the chars
+    // that end a run at every offset around the 16-char blocks it scans.
+    for (size_t len = 0; len < 40; ++len) {
+        const std::string prefix(len, 'a');
+        UniValue v;
+
+        BOOST_CHECK(v.read("[\"" + prefix + "\\n" + prefix + "\"]"));
+        BOOST_CHECK_EQUAL(v[0].getValStr(), prefix + "\n" + prefix);
+        BOOST_CHECK(v.read("[\"" + prefix + "\\u00e9\"]"));
+        BOOST_CHECK_EQUAL(v[0].getValStr(), prefix + "\xc3\xa9");
+        BOOST_CHECK(v.read("[\"" + prefix + "\xc3\xa9" + prefix + "\"]"));
+        BOOST_CHECK_EQUAL(v[0].getValStr(), prefix + "\xc3\xa9" + prefix);
+        BOOST_CHECK_EQUAL(v.write(), "[\"" + prefix + "\xc3\xa9" + prefix + "\"]");
+        BOOST_CHECK(v.read("{\"" + prefix + "\":\"" + prefix + "\x7f\"}"));
+        BOOST_CHECK_EQUAL(v[prefix].getValStr(), prefix + "\x7f");
+
+        BOOST_CHECK(!v.read("[\"" + prefix + "\t\"]"));
+        BOOST_CHECK(!v.read("[\"" + prefix + "\xff\"]"));
+        BOOST_CHECK(!v.read("[\"" + prefix + "\xc3" + prefix + "x\"]"));
+        BOOST_CHECK(!v.read("[\"" + prefix));
+    }
+}
+
 int main(int argc, char* argv[])
 {
     univalue_constructor();
@@ -437,5 +462,6 @@ int main(int argc, char* argv[])
     univalue_array();
     univalue_object();
     univalue_readwrite();
+    univalue_readwrite_strings();
     return 0;
 }
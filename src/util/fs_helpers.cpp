@@ -37,7 +37,9 @@
 #endif // __linux__
 
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #else
 #include <io.h> /* For _get_osfhandle, _chsize */
@@ -276,6 +278,36 @@ bool RenameOver(fs::path src, fs::path dest)
 #endif
 }
 
+std::unique_ptr<const MappedFile> MappedFile::Open(const fs::path& path)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    const int fd{open(fs::PathToString(path).c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd == -1) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* data{mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0)};
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    std::unique_ptr<MappedFile> file{new MappedFile()};
+    file->m_data = data;
+    file->m_size = st.st_size;
+    return file;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef WIN32
+    if (m_data) munmap(m_data, m_size);
+#endif
+}
+
 /**
  * Ignores exceptions thrown by create_directories if the requested directory exists.
  * Specifically handles case where path p exists, but it wasn't possible for the user to
@@ -6,12 +6,14 @@
 #ifndef MYTHERRA_UTIL_FS_HELPERS_H
 #define MYTHERRA_UTIL_FS_HELPERS_H
 
+#include <span.h>
 #include <util/fs.h>
 
 #include <cstdint>
 #include <cstdio>
 #include <iosfwd>
 #include <limits>
+#include <memory>
 
 /**
  * Ensure file contents are fully committed to disk, using a platform-specific
@@ -53,6 +55,32 @@ std::streampos GetFileSize(const char* path, std::streamsize max = std::numeric_
  */
 void ReleaseDirectoryLocks();
 
+/**
+ * A read-only memory mapping of a whole file, for reading files that are not
+ * written to anymore without a syscall and a copy per read. The mapping stays
+ * valid after the file is deleted, but reading past the end of a file that was
+ * truncated after it was mapped is undefined.
+ */
+class MappedFile
+{
+private:
+    void* m_data{nullptr};
+    size_t m_size{0};
+
+    MappedFile() = default;
+
+public:
+    /** Map the file at path. Returns nullptr if it can not be mapped, including
+     *  on platforms without mmap support, so callers need a fallback. */
+    static std::unique_ptr<const MappedFile> Open(const fs::path& path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    Span<const uint8_t> Data() const { return {static_cast<const uint8_t*>(m_data), m_size}; }
+};
+
 bool TryCreateDirectories(const fs::path& p);
 fs::path GetDefaultDataDir();
 
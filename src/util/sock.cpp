@@ -11,6 +11,7 @@
 #include <util/threadinterrupt.h>
 #include <util/time.h>
 
+#include <array>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -24,6 +25,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 static inline bool IOErrorIsPermanent(int err)
 {
     return err != WSAEAGAIN && err != WSAEINTR && err != WSAEWOULDBLOCK && err != WSAEINPROGRESS;
@@ -416,6 +421,101 @@ void Sock::Close()
     m_socket = INVALID_SOCKET;
 }
 
+std::unique_ptr<SockWaitSet> SockWaitSet::Create()
+{
+#ifdef USE_EPOLL
+    const int fd{epoll_create1(EPOLL_CLOEXEC)};
+    if (fd == -1) {
+        LogPrintf("Cannot create epoll instance: %s\n", SysErrorString(errno));
+        return nullptr;
+    }
+    return std::unique_ptr<SockWaitSet>{new SockWaitSet{fd}};
+#else
+    return nullptr;
+#endif
+}
+
+SockWaitSet::~SockWaitSet()
+{
+#ifdef USE_EPOLL
+    close(m_fd);
+#endif
+}
+
+bool SockWaitSet::Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested)
+{
+#ifdef USE_EPOLL
+    const SOCKET s{sock->Get()};
+    const auto it{m_socks.find(s)};
+    if (it != m_socks.end() && it->second.sock == sock && it->second.requested == requested) {
+        return true;
+    }
+
+    epoll_event ev{};
+    if (requested & Sock::RECV) {
+        ev.events |= EPOLLIN;
+    }
+    if (requested & Sock::SEND) {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.fd = s;
+    if (epoll_ctl(m_fd, it == m_socks.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, s, &ev) != 0) {
+        return false;
+    }
+    m_socks.insert_or_assign(s, Entry{sock, requested});
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SockWaitSet::Remove(const std::shared_ptr<const Sock>& sock)
+{
+#ifdef USE_EPOLL
+    const auto it{m_socks.find(sock->Get())};
+    if (it == m_socks.end() || it->second.sock != sock) {
+        return;
+    }
+    epoll_ctl(m_fd, EPOLL_CTL_DEL, it->first, nullptr);
+    m_socks.erase(it);
+#endif
+}
+
+bool SockWaitSet::Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& events_per_sock) const
+{
+    events_per_sock.clear();
+#ifdef USE_EPOLL
+    // Any sockets that are ready but don't fit are reported by the next call.
+    std::array<epoll_event, 256> evs;
+    const int num_ready{epoll_wait(m_fd, evs.data(), evs.size(), count_milliseconds(timeout))};
+    if (num_ready == -1) {
+        return errno == EINTR;
+    }
+
+    for (int i{0}; i < num_ready; ++i) {
+        const auto it{m_socks.find(evs[i].data.fd)};
+        if (it == m_socks.end()) {
+            continue;
+        }
+        Sock::Events events{it->second.requested};
+        if (evs[i].events & EPOLLIN) {
+            events.occurred |= Sock::RECV;
+        }
+        if (evs[i].events & EPOLLOUT) {
+            events.occurred |= Sock::SEND;
+        }
+        if (evs[i].events & (EPOLLERR | EPOLLHUP)) {
+            events.occurred |= Sock::ERR;
+        }
+        events_per_sock.emplace(it->second.sock, events);
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
 #ifdef WIN32
 std::string NetworkErrorString(int err)
 {
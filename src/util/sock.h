@@ -279,6 +279,71 @@ private:
     void Close();
 };
 
+/**
+ * A set of sockets that is waited on over and over again, like the connections of a server.
+ * Unlike `Sock::WaitMany()`, which hands all sockets to the kernel on every call, the sockets
+ * are registered once with a persistent epoll(7) instance, re-registered only when the events
+ * requested for them change, and a wait returns just the sockets that are ready. So the cost
+ * of a wait does not grow with the number of idle sockets in the set.
+ */
+class SockWaitSet
+{
+public:
+    /**
+     * Create an empty set.
+     * @return the new set, or nullptr if not supported on this platform (it needs epoll(7)).
+     */
+    static std::unique_ptr<SockWaitSet> Create();
+
+    ~SockWaitSet();
+
+    SockWaitSet(const SockWaitSet&) = delete;
+    SockWaitSet& operator=(const SockWaitSet&) = delete;
+
+    /**
+     * Add a socket to the set, or change the events requested for it.
+     * A reference to the socket is kept until it is removed, so that its file descriptor
+     * can not be reused by another socket in the meantime.
+     * @param[in] sock Socket to wait on.
+     * @param[in] requested Wait for those events, bitwise-or of `Sock::RECV` and `Sock::SEND`.
+     * @return false if the socket could not be registered
+     */
+    [[nodiscard]] bool Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested);
+
+    /**
+     * Remove a socket from the set, if it is in it.
+     */
+    void Remove(const std::shared_ptr<const Sock>& sock);
+
+    /**
+     * Number of sockets in the set.
+     */
+    size_t Size() const { return m_socks.size(); }
+
+    /**
+     * Wait for readiness of any of the sockets in the set.
+     * @param[in] timeout Wait this long for at least one of the requested events to occur.
+     * @param[out] events_per_sock Set to the sockets on which events occurred, with their
+     * requested and occurred events. Empty on timeout.
+     * @return true on success (or timeout), false otherwise
+     */
+    [[nodiscard]] bool Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& events_per_sock) const;
+
+private:
+    explicit SockWaitSet(int fd) : m_fd{fd} {}
+
+    struct Entry {
+        std::shared_ptr<const Sock> sock;
+        Sock::Event requested;
+    };
+
+    /** The epoll(7) file descriptor. */
+    const int m_fd;
+
+    /** Sockets in the set, by their file descriptor. */
+    std::unordered_map<SOCKET, Entry> m_socks;
+};
+
 /** Return readable error string for a network error code */
 std::string NetworkErrorString(int err);
 
@@ -862,6 +862,9 @@ void SetSyscallSandboxPolicy(SyscallSandboxPolicy syscall_policy)
         seccomp_policy_builder.AllowFileSystem();
         seccomp_policy_builder.AllowNetwork();
         break;
+    case SyscallSandboxPolicy::BLOCK_TEMPLATE: // Thread: blocktemplate
+        seccomp_policy_builder.AllowFileSystem();
+        break;
     case SyscallSandboxPolicy::MESSAGE_HANDLER: // Thread: msghand
         seccomp_policy_builder.AllowFileSystem();
         break;
@@ -895,6 +898,12 @@ void SetSyscallSandboxPolicy(SyscallSandboxPolicy syscall_policy)
     case SyscallSandboxPolicy::TX_INDEX: // Thread: txindex
         seccomp_policy_builder.AllowFileSystem();
         break;
+    case SyscallSandboxPolicy::VALIDATION_COINS_FLUSH: // Thread: coinsflush
+        seccomp_policy_builder.AllowFileSystem();
+        break;
+    case SyscallSandboxPolicy::VALIDATION_COINS_PREFETCH: // Thread: coinsfetch.<N>
+        seccomp_policy_builder.AllowFileSystem();
+        break;
     case SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK: // Thread: scriptch.<N>
         break;
     case SyscallSandboxPolicy::SHUTOFF: // Thread: main thread (state: shutoff)
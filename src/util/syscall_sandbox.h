@@ -13,6 +13,7 @@ enum class SyscallSandboxPolicy {
     INITIALIZATION_MAP_PORT,
 
     // 2. Steady state (non-initialization, non-shutdown)
+    BLOCK_TEMPLATE,
     MESSAGE_HANDLER,
     NET,
     NET_ADD_CONNECTION,
@@ -22,6 +23,8 @@ enum class SyscallSandboxPolicy {
     SCHEDULER,
     TOR_CONTROL,
     TX_INDEX,
+    VALIDATION_COINS_FLUSH,
+    VALIDATION_COINS_PREFETCH,
     VALIDATION_SCRIPT_CHECK,
 
     // 3. Shutdown
@@ -65,6 +65,7 @@
 #include <numeric>
 #include <optional>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 using kernel::CCoinsStats;
@@ -75,7 +76,6 @@ using kernel::LoadMempool;
 using fsbridge::FopenFn;
 using node::BlockManager;
 using node::BlockMap;
-using node::CBlockIndexHeightOnlyComparator;
 using node::CBlockIndexWorkComparator;
 using node::fReindex;
 using node::ReadBlockFromDisk;
@@ -133,9 +133,15 @@ const CBlockIndex* Chainstate::FindForkInGlobalIndex(const CBlockLocator& locato
 bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
                        const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
                        bool cacheFullScriptStore, PrecomputedTransactionData& txdata,
-                       std::vector<CScriptCheck>* pvChecks = nullptr)
+                       std::vector<CScriptCheck>* pvChecks = nullptr,
+                       SchnorrBatchVerifier* schnorr_batch = nullptr)
                        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+static bool CheckInputScriptsInParallel(const CTransaction& tx, TxValidationState& state,
+                                        const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
+                                        bool cacheFullScriptStore, PrecomputedTransactionData& txdata)
+                                        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 bool CheckFinalTxAtTip(const CBlockIndex& active_chain_tip, const CTransaction& tx)
 {
     AssertLockHeld(cs_main);
@@ -422,7 +428,7 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
     }
 
     // Call CheckInputScripts() to cache signature and script validity against current tip consensus rules.
-    return CheckInputScripts(tx, state, view, flags, /* cacheSigStore= */ true, /* cacheFullScriptStore= */ true, txdata);
+    return CheckInputScriptsInParallel(tx, state, view, flags, /* cacheSigStore= */ true, /* cacheFullScriptStore= */ true, txdata);
 }
 
 namespace {
@@ -576,7 +582,7 @@ private:
          * those it directly conflicts with and their descendants. */
         CTxMemPool::setEntries m_all_conflicting;
         /** All mempool ancestors of this transaction. */
-        CTxMemPool::setEntries m_ancestors;
+        CTxMemPool::vecEntries m_ancestors;
         /** Mempool entry constructed for this transaction. Constructed in PreChecks() but not
          * inserted into the mempool until Finalize(). */
         std::unique_ptr<CTxMemPoolEntry> m_entry;
@@ -906,6 +912,7 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
             .ancestor_size_vbytes = m_limits.ancestor_size_vbytes,
             .descendant_count = m_limits.descendant_count + 1,
             .descendant_size_vbytes = m_limits.descendant_size_vbytes + EXTRA_DESCENDANT_TX_SIZE_LIMIT,
+            .cluster_count = m_limits.cluster_count,
         };
         const auto error_message{util::ErrorString(ancestors).original};
         if (ws.m_vsize > EXTRA_DESCENDANT_TX_SIZE_LIMIT) {
@@ -915,7 +922,11 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
         if (!ancestors) return state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "too-long-mempool-chain", error_message);
     }
 
-    ws.m_ancestors = *ancestors;
+    ws.m_ancestors = std::move(*ancestors);
+
+    if (const auto err_string{m_pool.CheckClusterLimit(ws.m_ancestors, ws.m_iters_conflicting, /*entry_count=*/1, m_limits)}) {
+        return state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "too-large-cluster", *err_string);
+    }
 
     // A transaction that spends outputs that would be replaced by it is invalid. Now
     // that we have the set of all ancestors we can detect this
@@ -1006,7 +1017,7 @@ bool MemPoolAccept::PolicyScriptChecks(const ATMPArgs& args, Workspace& ws)
 
     // Check input scripts and signatures.
     // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-    if (!CheckInputScripts(tx, state, m_view, scriptVerifyFlags, true, false, ws.m_precomputed_txdata)) {
+    if (!CheckInputScriptsInParallel(tx, state, m_view, scriptVerifyFlags, true, false, ws.m_precomputed_txdata)) {
         // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
         // need to turn both off, and compare against just turning off CLEANSTACK
         // to see if the failure is specifically due to witness validation.
@@ -1731,6 +1742,9 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
 bool CScriptCheck::operator()() {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
+    if (m_schnorr_batch) {
+        return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, BatchingCachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata, *m_schnorr_batch), &error);
+    }
     return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
 }
 
@@ -1756,6 +1770,15 @@ bool InitScriptExecutionCache(size_t max_size_bytes)
     return true;
 }
 
+/** Key of a transaction's script execution under the given flags in g_scriptExecutionCache. */
+static uint256 ScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags)
+{
+    uint256 hashCacheEntry;
+    CSHA256 hasher = g_scriptExecutionCacheHasher;
+    hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    return hashCacheEntry;
+}
+
 /**
  * Check whether all of this transaction's input scripts succeed.
  *
@@ -1778,7 +1801,8 @@ bool InitScriptExecutionCache(size_t max_size_bytes)
 bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
                        const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
                        bool cacheFullScriptStore, PrecomputedTransactionData& txdata,
-                       std::vector<CScriptCheck>* pvChecks)
+                       std::vector<CScriptCheck>* pvChecks,
+                       SchnorrBatchVerifier* schnorr_batch)
 {
     if (tx.IsCoinBase()) return true;
 
@@ -1791,9 +1815,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     // correct (ie that the transaction hash which is in tx's prevouts
     // properly commits to the scriptPubKey in the inputs view of that
     // transaction).
-    uint256 hashCacheEntry;
-    CSHA256 hasher = g_scriptExecutionCacheHasher;
-    hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    const uint256 hashCacheEntry{ScriptExecutionCacheEntry(tx, flags)};
     AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
     if (g_scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
         return true;
@@ -1822,7 +1844,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
         // spent being checked as a part of CScriptCheck.
 
         // Verify signature
-        CScriptCheck check(txdata.m_spent_outputs[i], tx, i, flags, cacheSigStore, &txdata);
+        CScriptCheck check(txdata.m_spent_outputs[i], tx, i, flags, cacheSigStore, &txdata, schnorr_batch);
         if (pvChecks) {
             pvChecks->emplace_back(std::move(check));
         } else if (!check()) {
@@ -1853,7 +1875,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
         }
     }
 
-    if (cacheFullScriptStore && !pvChecks) {
+    if (cacheFullScriptStore && !pvChecks && !schnorr_batch) {
         // We executed all of the provided scripts, and were told to
         // cache the result. Do so now.
         g_scriptExecutionCache.insert(hashCacheEntry);
@@ -1988,6 +2010,135 @@ void StopScriptCheckWorkerThreads()
     scriptcheckqueue.StopWorkerThreads();
 }
 
+/** Transactions with fewer inputs have their scripts checked on the calling thread during mempool acceptance. */
+static constexpr size_t MIN_PARALLEL_MEMPOOL_SCRIPT_CHECKS{4};
+
+/**
+ * CheckInputScripts for mempool acceptance. The script checks of
+ * transactions with many inputs are run on the script check worker threads,
+ * so that the time cs_main is held for them shrinks with the number of
+ * threads. Failures are reported by checking the inputs again on this
+ * thread, which yields the same state as CheckInputScripts.
+ */
+static bool CheckInputScriptsInParallel(const CTransaction& tx, TxValidationState& state,
+                                        const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
+                                        bool cacheFullScriptStore, PrecomputedTransactionData& txdata)
+{
+    AssertLockHeld(cs_main);
+    if (tx.vin.size() < MIN_PARALLEL_MEMPOOL_SCRIPT_CHECKS || !scriptcheckqueue.HasThreads()) {
+        return CheckInputScripts(tx, state, inputs, flags, cacheSigStore, cacheFullScriptStore, txdata);
+    }
+
+    std::vector<CScriptCheck> checks;
+    // Only collects the checks, which are left empty on a script execution cache hit.
+    if (!CheckInputScripts(tx, state, inputs, flags, cacheSigStore, cacheFullScriptStore, txdata, &checks)) return false;
+    if (checks.empty()) return true;
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(std::move(checks));
+    if (control.Wait()) {
+        if (cacheFullScriptStore) g_scriptExecutionCache.insert(ScriptExecutionCacheEntry(tx, flags));
+        return true;
+    }
+    return CheckInputScripts(tx, state, inputs, flags, cacheSigStore, cacheFullScriptStore, txdata);
+}
+
+/**
+ * Closure representing one UTXO lookup done ahead of ConnectBlock.
+ * The lookup goes straight to the coins database, which is safe to read
+ * from several threads. The result is stored in a slot owned by the caller,
+ * which inserts it into the (single-threaded) coins cache afterwards.
+ */
+class CCoinsPrefetch
+{
+private:
+    const CCoinsView* m_db;
+    COutPoint m_outpoint;
+    std::optional<Coin>* m_result;
+
+public:
+    CCoinsPrefetch(const CCoinsView& db, const COutPoint& outpoint, std::optional<Coin>& result) :
+        m_db(&db), m_outpoint(outpoint), m_result(&result) { }
+
+    bool operator()()
+    {
+        try {
+            Coin coin;
+            if (m_db->GetCoin(m_outpoint, coin)) *m_result = std::move(coin);
+            return true;
+        } catch (const std::runtime_error& e) {
+            // Leave it to the regular lookup path to report the read error.
+            return false;
+        }
+    }
+};
+
+static CCheckQueue<CCoinsPrefetch> coinsprefetchqueue(16, "coinsfetch", SyscallSandboxPolicy::VALIDATION_COINS_PREFETCH);
+
+void StartCoinsPrefetchWorkerThreads(int threads_num)
+{
+    coinsprefetchqueue.StartWorkerThreads(threads_num);
+}
+
+void StopCoinsPrefetchWorkerThreads()
+{
+    coinsprefetchqueue.StopWorkerThreads();
+}
+
+/**
+ * Warm the coins cache with all inputs of a block that are neither cached
+ * already nor created within the block itself, reading them from the coins
+ * database on the prefetch worker threads. Returns the number of coins added.
+ *
+ * Purely an optimization: missing or failed lookups are simply left to
+ * ConnectBlock, which fetches them through the cache as usual.
+ */
+static size_t PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& db) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (!coinsprefetchqueue.HasThreads()) return 0;
+
+    std::unordered_set<uint256, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+
+    std::vector<COutPoint> outpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (block_txids.count(txin.prevout.hash) || cache.HaveCoinInCache(txin.prevout)) continue;
+            outpoints.push_back(txin.prevout);
+        }
+    }
+    if (outpoints.empty()) return 0;
+
+    // The database is written to by flushes, which require cs_main, and by the
+    // background write of a flush. Until that write is committed, the database
+    // view serves its coins from memory, so the coins read here cannot go stale
+    // before they are inserted.
+    std::vector<std::optional<Coin>> results(outpoints.size());
+    {
+        std::vector<CCoinsPrefetch> checks;
+        checks.reserve(outpoints.size());
+        for (size_t i = 0; i < outpoints.size(); ++i) {
+            checks.emplace_back(db, outpoints[i], results[i]);
+        }
+        CCheckQueueControl<CCoinsPrefetch> control(&coinsprefetchqueue);
+        control.Add(std::move(checks));
+        control.Wait();
+    }
+
+    size_t added{0};
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        if (!results[i]) continue;
+        cache.AddPrefetchedCoin(outpoints[i], std::move(*results[i]));
+        ++added;
+    }
+    return added;
+}
+
 /**
  * Threshold condition checker that triggers when unknown versionbits are seen on the network.
  */
@@ -2267,6 +2418,13 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // in multiple threads). Preallocate the vector size so a new allocation
     // doesn't invalidate pointers into the vector, and keep txsdata in scope
     // for as long as `control`.
+    //
+    // Schnorr signatures of the block are verified as one batch after all
+    // scripts have run, so the batch must outlive `control` as well. This is
+    // only done when actually connecting the block, as nothing may be cached
+    // as valid before the batch is verified.
+    SchnorrBatchVerifier schnorr_batch;
+    const bool use_schnorr_batch{fScriptChecks && !fJustCheck && m_chainman.m_options.schnorr_batch_verify};
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && parallel_script_checks ? &scriptcheckqueue : nullptr);
     std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
 
@@ -2326,7 +2484,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             TxValidationState tx_state;
-            if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txsdata[i], parallel_script_checks ? &vChecks : nullptr)) {
+            if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txsdata[i], parallel_script_checks ? &vChecks : nullptr, use_schnorr_batch ? &schnorr_batch : nullptr)) {
                 // Any transaction validation failure in ConnectBlock is a block consensus failure
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS,
                               tx_state.GetRejectReason(), tx_state.GetDebugMessage());
@@ -2360,6 +2518,15 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         LogPrintf("ERROR: %s: CheckQueue failed\n", __func__);
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "block-validation-failed");
     }
+    if (use_schnorr_batch) {
+        const auto time_batch_start{SteadyClock::now()};
+        if (!schnorr_batch.Verify()) {
+            LogPrintf("ERROR: %s: Schnorr signature batch verification failed\n", __func__);
+            return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "mandatory-script-verify-flag-failed (Invalid Schnorr signature)");
+        }
+        LogPrint(BCLog::BENCH, "    - Batch verify %u Schnorr signatures: %.2fms\n", (unsigned)schnorr_batch.Size(),
+                 Ticks<MillisecondsDouble>(SteadyClock::now() - time_batch_start));
+    }
     const auto time_4{SteadyClock::now()};
     time_verify += time_4 - time_2;
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1,
@@ -2423,7 +2590,8 @@ CoinsCacheSizeState Chainstate::GetCoinsCacheSizeState(
 {
     AssertLockHeld(::cs_main);
     const int64_t nMempoolUsage = m_mempool ? m_mempool->DynamicMemoryUsage() : 0;
-    int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
+    // Coins that are still being written in the background are held in memory too.
+    int64_t cacheSize = CoinsTip().DynamicMemoryUsage() + CoinsDB().PendingMemoryUsage();
     int64_t nTotalSpace =
         max_coins_cache_size_bytes + std::max<int64_t>(int64_t(max_mempool_size_bytes) - nMempoolUsage, 0);
 
@@ -2559,11 +2727,28 @@ bool Chainstate::FlushStateToDisk(
             if (!CheckDiskSpace(gArgs.GetDataDirNet(), 48 * 2 * 2 * CoinsTip().GetCacheSize())) {
                 return AbortNode(state, "Disk space is too low!", _("Disk space is too low!"));
             }
-            // Flush the chainstate (which may refer to block index entries).
-            if (!CoinsTip().Flush())
-                return AbortNode(state, "Failed to write to coin database");
-            m_last_flush = nNow;
+            const auto flush_start{SteadyClock::now()};
+            if (m_chainman.m_options.coins_view.background_flush && mode != FlushStateMode::ALWAYS && !fFlushForPrune) {
+                // Hand the modified coins to a background write and keep the
+                // unmodified ones cached. Only a cache that is getting full
+                // gives up half of its space.
+                if (!CoinsDB().WaitForBackgroundWrite()) {
+                    return AbortNode(state, "Failed to write to coin database");
+                }
+                auto write{std::make_unique<PendingCoinsWrite>()};
+                write->best_block = CoinsTip().GetBestBlock();
+                const size_t max_usage{cache_state >= CoinsCacheSizeState::LARGE ? m_coinstip_cache_size_bytes / 2 : std::numeric_limits<size_t>::max()};
+                CoinsTip().MoveDirtyCoins(write->coins, max_usage);
+                CoinsDB().BatchWriteInBackground(std::move(write), /*on_written=*/{});
+            } else {
+                // Flush the chainstate (which may refer to block index entries).
+                if (!CoinsTip().Flush())
+                    return AbortNode(state, "Failed to write to coin database");
+            }
             full_flush_completed = true;
+            m_last_flush = nNow;
+            m_last_coins_flush_stall_time = std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - flush_start);
+            m_coins_flush_stall_time += m_last_coins_flush_stall_time;
             TRACE5(utxocache, flush,
                    int64_t{Ticks<std::chrono::microseconds>(SteadyClock::now() - nNow)},
                    (uint32_t)mode,
@@ -2573,6 +2758,9 @@ bool Chainstate::FlushStateToDisk(
         }
     }
     if (full_flush_completed) {
+        // Queued under cs_main, after the BlockConnected of the tip. The
+        // coins of a background flush may not be committed yet, indexes wait
+        // for them with CCoinsViewDB::WaitForCommitted().
         // Update best block in wallet (so we can detect restored wallets).
         GetMainSignals().ChainStateFlushed(m_chain.GetLocator());
     }
@@ -2656,6 +2844,7 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
     }
 
     // New best block
+    m_chainman.m_cached_active_tip = pindexNew;
     if (m_mempool) {
         m_mempool->AddTransactionsUpdated(1);
     }
@@ -2761,6 +2950,7 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
 }
 
 static SteadyClock::duration time_read_from_disk_total{};
+static SteadyClock::duration time_prefetch_total{};
 static SteadyClock::duration time_connect_total{};
 static SteadyClock::duration time_flush{};
 static SteadyClock::duration time_chainstate{};
@@ -2840,6 +3030,16 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
              Ticks<MillisecondsDouble>(time_2 - time_1),
              Ticks<SecondsDouble>(time_read_from_disk_total),
              Ticks<MillisecondsDouble>(time_read_from_disk_total) / num_blocks_total);
+    if (coinsprefetchqueue.HasThreads()) {
+        const size_t prefetched{PrefetchBlockInputs(blockConnecting, CoinsTip(), CoinsDB())};
+        const auto time_prefetch{SteadyClock::now()};
+        time_prefetch_total += time_prefetch - time_2;
+        LogPrint(BCLog::BENCH, "  - Prefetch %u inputs: %.2fms [%.2fs (%.2fms/blk)]\n",
+                 prefetched,
+                 Ticks<MillisecondsDouble>(time_prefetch - time_2),
+                 Ticks<SecondsDouble>(time_prefetch_total),
+                 Ticks<MillisecondsDouble>(time_prefetch_total) / num_blocks_total);
+    }
     {
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
@@ -4135,6 +4335,7 @@ bool Chainstate::LoadChainTip()
     }
     m_chain.SetTip(*pindex);
     PruneBlockIndexCandidates();
+    if (this == &m_chainman.ActiveChainstate()) m_chainman.m_cached_active_tip = pindex;
 
     tip = m_chain.Tip();
     LogPrintf("Loaded best chain: hashBestChain=%s height=%d date=%s progress=%f\n",
@@ -4420,9 +4621,7 @@ bool ChainstateManager::LoadBlockIndex()
 
         m_blockman.ScanAndUnlinkAlreadyPrunedFiles();
 
-        std::vector<CBlockIndex*> vSortedByHeight{m_blockman.GetAllBlockIndices()};
-        std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
-                  CBlockIndexHeightOnlyComparator());
+        std::vector<CBlockIndex*> vSortedByHeight{m_blockman.GetAllBlockIndicesByHeight()};
 
         // Find start of assumed-valid region.
         int first_assumed_valid_height = std::numeric_limits<int>::max();
@@ -4993,6 +5192,7 @@ Chainstate& ChainstateManager::InitializeChainstate(CTxMemPool* mempool)
 
     m_ibd_chainstate = std::make_unique<Chainstate>(mempool, m_blockman, *this);
     m_active_chainstate = m_ibd_chainstate.get();
+    m_cached_active_chainstate = m_active_chainstate;
     return *m_active_chainstate;
 }
 
@@ -5144,6 +5344,8 @@ bool ChainstateManager::ActivateSnapshot(
         assert(chaintip_loaded);
 
         m_active_chainstate = m_snapshot_chainstate.get();
+        m_cached_active_tip = m_active_chainstate->m_chain.Tip();
+        m_cached_active_chainstate = m_active_chainstate;
 
         LogPrintf("[snapshot] successfully activated snapshot %s\n", base_blockhash.ToString());
         LogPrintf("[snapshot] (%.2f MB)\n",
@@ -5438,6 +5640,8 @@ SnapshotCompletionResult ChainstateManager::MaybeCompleteSnapshotValidation(
         LogPrintf("[snapshot] deleting snapshot, reverting to validated chain, and stopping node\n");
 
         m_active_chainstate = m_ibd_chainstate.get();
+        m_cached_active_tip = m_active_chainstate->m_chain.Tip();
+        m_cached_active_chainstate = m_active_chainstate;
         m_snapshot_chainstate->m_disabled = true;
         assert(!this->IsUsable(m_snapshot_chainstate.get()));
         assert(this->IsUsable(m_ibd_chainstate.get()));
@@ -5577,6 +5781,8 @@ void ChainstateManager::ResetChainstates()
     m_ibd_chainstate.reset();
     m_snapshot_chainstate.reset();
     m_active_chainstate = nullptr;
+    m_cached_active_tip = nullptr;
+    m_cached_active_chainstate = nullptr;
 }
 
 /**
@@ -5634,6 +5840,7 @@ Chainstate& ChainstateManager::ActivateExistingSnapshot(CTxMemPool* mempool, uin
         std::make_unique<Chainstate>(mempool, m_blockman, *this, base_blockhash);
     LogPrintf("[snapshot] switching active chainstate to %s\n", m_snapshot_chainstate->ToString());
     m_active_chainstate = m_snapshot_chainstate.get();
+    m_cached_active_chainstate = m_active_chainstate;
     return *m_snapshot_chainstate;
 }
 
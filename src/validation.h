@@ -54,6 +54,7 @@ struct DisconnectedBlockTransactions;
 struct PrecomputedTransactionData;
 struct LockPoints;
 struct AssumeutxoData;
+class SchnorrBatchVerifier;
 namespace node {
 class SnapshotMetadata;
 } // namespace node
@@ -65,6 +66,10 @@ struct Params;
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of dedicated coins prefetch threads allowed */
+static const int MAX_COINS_PREFETCH_THREADS = 16;
+/** -prefetchthreads default (number of threads warming the coins cache before ConnectBlock, 0 = disabled) */
+static const int DEFAULT_COINS_PREFETCH_THREADS = 0;
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of ActiveChain().Tip() will not be pruned. */
@@ -100,6 +105,10 @@ extern const std::vector<std::string> CHECKLEVEL_DOC;
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
+/** Run instances of coins prefetch worker threads */
+void StartCoinsPrefetchWorkerThreads(int threads_num);
+/** Stop all of the coins prefetch worker threads */
+void StopCoinsPrefetchWorkerThreads();
 
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
 
@@ -316,10 +325,12 @@ private:
     bool cacheStore;
     ScriptError error{SCRIPT_ERR_UNKNOWN_ERROR};
     PrecomputedTransactionData *txdata;
+    //! If set, Schnorr signatures are not verified right away but added to this batch.
+    SchnorrBatchVerifier* m_schnorr_batch;
 
 public:
-    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
-        m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), txdata(txdataIn) { }
+    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn, SchnorrBatchVerifier* schnorr_batch = nullptr) :
+        m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), txdata(txdataIn), m_schnorr_batch(schnorr_batch) { }
 
     CScriptCheck(const CScriptCheck&) = delete;
     CScriptCheck& operator=(const CScriptCheck&) = delete;
@@ -664,6 +675,11 @@ public:
     //! if we pruned.
     void PruneAndFlush();
 
+    //! Total time that writing the coins cache to disk blocked validation.
+    std::chrono::microseconds m_coins_flush_stall_time GUARDED_BY(::cs_main){0};
+    //! Time that the last write of the coins cache to disk blocked validation.
+    std::chrono::microseconds m_last_coins_flush_stall_time GUARDED_BY(::cs_main){0};
+
     /**
      * Find the best known block, and make it the tip of the block chain. The
      * result is either failure or an activated best chain. pblock is either
@@ -904,6 +920,11 @@ private:
     //! that call.
     Chainstate* m_active_chainstate GUARDED_BY(::cs_main) {nullptr};
 
+    //! The tip of m_active_chainstate, updated while holding cs_main along with it.
+    std::atomic<const CBlockIndex*> m_cached_active_tip{nullptr};
+    //! m_active_chainstate, updated while holding cs_main along with it.
+    std::atomic<const Chainstate*> m_cached_active_chainstate{nullptr};
+
     CBlockIndex* m_best_invalid GUARDED_BY(::cs_main){nullptr};
 
     //! Internal helper for ActivateSnapshot().
@@ -1049,6 +1070,15 @@ public:
     CChain& ActiveChain() const EXCLUSIVE_LOCKS_REQUIRED(GetMutex()) { return ActiveChainstate().m_chain; }
     int ActiveHeight() const EXCLUSIVE_LOCKS_REQUIRED(GetMutex()) { return ActiveChain().Height(); }
     CBlockIndex* ActiveTip() const EXCLUSIVE_LOCKS_REQUIRED(GetMutex()) { return ActiveChain().Tip(); }
+    //! ActiveTip(), for callers that don't hold cs_main. May be outdated by the time it is used.
+    const CBlockIndex* CachedActiveTip() const { return m_cached_active_tip.load(); }
+    //! Whether the active chainstate is in initial block download. Only takes
+    //! cs_main while it is, so callers that don't hold cs_main can check it.
+    bool IsInitialBlockDownload() const
+    {
+        const Chainstate* chainstate{m_cached_active_chainstate.load()};
+        return !chainstate || chainstate->IsInitialBlockDownload();
+    }
 
     node::BlockMap& BlockIndex() EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
     {
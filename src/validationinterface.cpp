@@ -11,48 +11,288 @@
 #include <logging.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
-#include <scheduler.h>
-
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/syscall_sandbox.h>
+#include <util/thread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <list>
+#include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 std::string RemovalReasonToString(const MemPoolRemovalReason& r) noexcept;
 
+/** Maximum number of notifications a subscriber queue delivers per task, one callback at a time. */
+static constexpr size_t MAX_NOTIFICATIONS_PER_RUN{64};
+
+/**
+ * Threads delivering the notifications of the subscriber queues.
+ *
+ * They are separate from the node's CScheduler, so notifications don't wait
+ * behind its background tasks. Callbacks may thus run at the same time as the
+ * scheduler tasks of the same subscriber, and with more than one thread, at
+ * the same time as the callbacks of other subscribers.
+ */
+class NotificationThreads
+{
+public:
+    explicit NotificationThreads(int num_threads)
+    {
+        for (int i = 1; i <= num_threads; ++i) {
+            m_threads.emplace_back(util::TraceThread, strprintf("valnotify.%d", i), [this] { ThreadLoop(); });
+        }
+    }
+
+    ~NotificationThreads() { Stop(); }
+
+    //! Run task on one of the threads. Dropped once the threads are stopped.
+    void Add(std::function<void()> task) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            if (m_stop) return;
+            m_tasks.emplace_back(std::move(task));
+        }
+        m_cv.notify_one();
+    }
+
+    //! Stop the threads as soon as their current task is done.
+    void Stop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cv.notify_all();
+        for (std::thread& thread : m_threads) {
+            if (thread.joinable()) thread.join();
+        }
+        m_threads.clear();
+        WITH_LOCK(m_mutex, m_tasks.clear());
+    }
+
+    bool IsRunning() const { return !m_threads.empty(); }
+
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void ThreadLoop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        SetSyscallSandboxPolicy(SyscallSandboxPolicy::SCHEDULER);
+        while (true) {
+            std::function<void()> task;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_tasks.empty(); });
+                if (m_stop) return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
 /**
- * MainSignalsImpl manages a list of shared_ptr<CValidationInterface> callbacks.
+ * SubscriberQueue holds the notifications that are waiting to be delivered to
+ * one subscriber.
+ *
+ * Notifications of a queue are delivered in the order they were added and
+ * never concurrently, but different queues are serviced independently by
+ * whichever notification threads are free, so a slow subscriber only delays
+ * its own notifications. Each task handed to the threads delivers up to
+ * MAX_NOTIFICATIONS_PER_RUN queued notifications in a loop, so that a burst of
+ * mempool notifications doesn't cost a task per notification. The subscriber
+ * still gets one callback per notification.
+ */
+class SubscriberQueue : public std::enable_shared_from_this<SubscriberQueue>
+{
+public:
+    //! A notification receives the subscriber, or nullptr once the subscriber
+    //! has been unregistered.
+    using Notification = std::function<void(CValidationInterface*)>;
+
+    SubscriberQueue(NotificationThreads& threads, std::shared_ptr<CValidationInterface> callbacks)
+        : m_threads{threads}, m_callbacks{std::move(callbacks)} {}
+
+    //! Set while the subscriber is registered. Once cleared, queued
+    //! notifications are still run but no longer see the subscriber.
+    std::atomic<bool> m_registered{true};
+
+    //! Unregister the subscriber. on_drained is called once the queue has
+    //! nothing left to run, unless it is idle already.
+    void Retire(std::function<void()> on_drained) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_registered = false;
+        m_on_drained = std::move(on_drained);
+    }
+
+    //! The registered subscriber. Only read while registered, and released by
+    //! the queue once it drained after the subscriber was unregistered.
+    const std::shared_ptr<CValidationInterface>& Callbacks() const { return m_callbacks; }
+
+    void Add(Notification notification) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        bool schedule;
+        {
+            LOCK(m_mutex);
+            m_pending.emplace_back(std::move(notification));
+            m_peak_pending = std::max(m_peak_pending, m_pending.size());
+            schedule = !m_running && !m_scheduled;
+            m_scheduled |= schedule;
+        }
+        if (schedule) m_threads.Add([self = shared_from_this()] { self->ProcessQueue(); });
+    }
+
+    //! Deliver up to MAX_NOTIFICATIONS_PER_RUN notifications on the calling thread.
+    void ProcessQueue() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::list<Notification> batch;
+        {
+            LOCK(m_mutex);
+            m_scheduled = false;
+            if (m_running || m_pending.empty()) return;
+            m_running = true;
+            batch.splice(batch.end(), m_pending, m_pending.begin(),
+                         m_pending.size() > MAX_NOTIFICATIONS_PER_RUN ? std::next(m_pending.begin(), MAX_NOTIFICATIONS_PER_RUN) : m_pending.end());
+        }
+
+        // RAII the clearing of m_running and the rescheduling of the queue to
+        // ensure both happen even if a notification throws. Notifications of
+        // the batch that did not run go back to the front of the queue.
+        struct RAIIRunning {
+            SubscriberQueue& queue;
+            std::list<Notification>& batch;
+            ~RAIIRunning()
+            {
+                bool schedule;
+                std::function<void()> on_drained;
+                {
+                    LOCK(queue.m_mutex);
+                    queue.m_pending.splice(queue.m_pending.begin(), batch);
+                    queue.m_running = false;
+                    if (!queue.m_registered && queue.m_pending.empty()) {
+                        queue.m_callbacks.reset();
+                        on_drained = std::move(queue.m_on_drained);
+                        queue.m_on_drained = nullptr;
+                    }
+                    schedule = !queue.m_pending.empty() && !queue.m_scheduled;
+                    queue.m_scheduled |= schedule;
+                }
+                if (schedule) queue.m_threads.Add([self = queue.shared_from_this()] { self->ProcessQueue(); });
+                if (on_drained) on_drained();
+            }
+        } raii_running{*this, batch};
+
+        while (!batch.empty()) {
+            const Notification notification{std::move(batch.front())};
+            batch.pop_front();
+            notification(m_registered ? m_callbacks.get() : nullptr);
+            ++m_delivered;
+        }
+    }
+
+    //! Deliver all notifications on the calling thread. Must be called after
+    //! the notification threads were stopped.
+    void EmptyQueue() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        assert(!m_threads.IsRunning());
+        while (WITH_LOCK(m_mutex, return !m_pending.empty())) {
+            ProcessQueue();
+        }
+    }
+
+    //! Whether there is nothing to deliver and no notification is running.
+    bool IsIdle() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return !m_running && m_pending.empty();
+    }
+
+    size_t Pending() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_pending.size();
+    }
+
+    size_t PeakPending() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_peak_pending;
+    }
+
+    uint64_t Delivered() const { return m_delivered; }
+
+private:
+    NotificationThreads& m_threads;
+    mutable Mutex m_mutex;
+    std::shared_ptr<CValidationInterface> m_callbacks;
+    std::list<Notification> m_pending GUARDED_BY(m_mutex);
+    size_t m_peak_pending GUARDED_BY(m_mutex){0};
+    //! Whether a batch is being delivered.
+    bool m_running GUARDED_BY(m_mutex){false};
+    //! Whether a ProcessQueue() task is waiting for a notification thread.
+    bool m_scheduled GUARDED_BY(m_mutex){false};
+    //! Called once an unregistered queue has drained.
+    std::function<void()> m_on_drained GUARDED_BY(m_mutex);
+    std::atomic<uint64_t> m_delivered{0};
+};
+
+/**
+ * MainSignalsImpl manages a list of subscriber queues.
  *
  * A std::unordered_map is used to track what callbacks are currently
- * registered, and a std::list is used to store the callbacks that are
- * currently registered as well as any callbacks that are just unregistered
- * and about to be deleted when they are done executing.
+ * registered, and a std::list is used to store the queues of the callbacks
+ * that are currently registered as well as of any callbacks that are just
+ * unregistered and still have notifications running or queued.
  */
 class MainSignalsImpl
 {
 private:
+    NotificationThreads m_threads;
     Mutex m_mutex;
-    //! List entries consist of a callback pointer and reference count. The
-    //! count is equal to the number of current executions of that entry, plus 1
-    //! if it's registered. It cannot be 0 because that would imply it is
-    //! unregistered and also not being executed (so shouldn't exist).
-    struct ListEntry { std::shared_ptr<CValidationInterface> callbacks; int count = 1; };
-    std::list<ListEntry> m_list GUARDED_BY(m_mutex);
-    std::unordered_map<CValidationInterface*, std::list<ListEntry>::iterator> m_map GUARDED_BY(m_mutex);
+    std::list<std::shared_ptr<SubscriberQueue>> m_list GUARDED_BY(m_mutex);
+    std::unordered_map<CValidationInterface*, std::list<std::shared_ptr<SubscriberQueue>>::iterator> m_map GUARDED_BY(m_mutex);
+    //! Queue without a subscriber, so that functions passed to
+    //! CallFunctionInValidationInterfaceQueue run when there are no subscribers.
+    const std::shared_ptr<SubscriberQueue> m_function_queue;
+
+    //! Stop tracking an unregistered queue once it has nothing left to run.
+    void Retire(std::list<std::shared_ptr<SubscriberQueue>>::iterator it) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        (*it)->Retire([this, queue = it->get()] { Remove(queue); });
+        if ((*it)->IsIdle()) m_list.erase(it);
+    }
+
+    //! Stop tracking a queue, if it is still tracked.
+    void Remove(const SubscriberQueue* queue) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const auto it{std::find_if(m_list.begin(), m_list.end(), [&](const auto& q) { return q.get() == queue; })};
+        if (it != m_list.end()) m_list.erase(it);
+    }
 
 public:
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
-    SingleThreadedSchedulerClient m_schedulerClient;
+    explicit MainSignalsImpl(int num_threads)
+        : m_threads{num_threads}, m_function_queue{std::make_shared<SubscriberQueue>(m_threads, nullptr)} {}
 
-    explicit MainSignalsImpl(CScheduler& scheduler LIFETIMEBOUND) : m_schedulerClient(scheduler) {}
+    //! The threads may still run notifications that refer to this object.
+    ~MainSignalsImpl() { m_threads.Stop(); }
 
     void Register(std::shared_ptr<CValidationInterface> callbacks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         LOCK(m_mutex);
         auto inserted = m_map.emplace(callbacks.get(), m_list.end());
-        if (inserted.second) inserted.first->second = m_list.emplace(m_list.end());
-        inserted.first->second->callbacks = std::move(callbacks);
+        if (inserted.second) inserted.first->second = m_list.emplace(m_list.end(), std::make_shared<SubscriberQueue>(m_threads, std::move(callbacks)));
     }
 
     void Unregister(CValidationInterface* callbacks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
@@ -60,47 +300,117 @@ public:
         LOCK(m_mutex);
         auto it = m_map.find(callbacks);
         if (it != m_map.end()) {
-            if (!--it->second->count) m_list.erase(it->second);
+            Retire(it->second);
             m_map.erase(it);
         }
     }
 
     //! Clear unregisters every previously registered callback, erasing every
-    //! map entry. After this call, the list may still contain callbacks that
-    //! are currently executing, but it will be cleared when they are done
-    //! executing.
+    //! map entry. After this call, the list may still contain queues that
+    //! have notifications running or queued, but their callbacks will be
+    //! released when they are done.
     void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         LOCK(m_mutex);
         for (const auto& entry : m_map) {
-            if (!--entry.second->count) m_list.erase(entry.second);
+            Retire(entry.second);
         }
         m_map.clear();
     }
 
+    //! Call f on every registered subscriber, on the calling thread.
     template<typename F> void Iterate(F&& f) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        WAIT_LOCK(m_mutex, lock);
-        for (auto it = m_list.begin(); it != m_list.end();) {
-            ++it->count;
-            {
-                REVERSE_LOCK(lock);
-                f(*it->callbacks);
+        std::vector<std::shared_ptr<CValidationInterface>> subscribers;
+        {
+            LOCK(m_mutex);
+            subscribers.reserve(m_map.size());
+            for (const auto& queue : m_list) {
+                if (queue->m_registered) subscribers.push_back(queue->Callbacks());
             }
-            it = --it->count ? std::next(it) : m_list.erase(it);
+        }
+        for (const auto& callbacks : subscribers) {
+            f(*callbacks);
         }
     }
+
+    //! Queue event for every registered subscriber. Queuing happens under
+    //! m_mutex, so all subscribers see events in the same order.
+    template<typename F> void Enqueue(const F& event) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        for (const auto& queue : m_list) {
+            if (!queue->m_registered) continue;
+            queue->Add([event](CValidationInterface* callbacks) {
+                if (callbacks) event(*callbacks);
+            });
+        }
+    }
+
+    //! Run func once every notification queued before it has been delivered,
+    //! including the notifications still running for unregistered callbacks.
+    void AddFunction(std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        for (auto it = m_list.begin(); it != m_list.end();) {
+            it = !(*it)->m_registered && (*it)->IsIdle() ? m_list.erase(it) : std::next(it);
+        }
+        // Every queue counts down when it reaches func, the last one runs it.
+        auto remaining{std::make_shared<std::atomic<size_t>>(m_list.size() + 1)};
+        auto shared_func{std::make_shared<std::function<void()>>(std::move(func))};
+        const auto arrive{[remaining, shared_func](CValidationInterface*) {
+            if (--*remaining == 0) (*shared_func)();
+        }};
+        for (const auto& queue : m_list) {
+            queue->Add(arrive);
+        }
+        m_function_queue->Add(arrive);
+    }
+
+    void StopThreads() { m_threads.Stop(); }
+
+    //! Deliver all queued notifications on the calling thread.
+    void EmptyQueues() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const auto queues{WITH_LOCK(m_mutex, return m_list)};
+        for (const auto& queue : queues) {
+            queue->EmptyQueue();
+        }
+        m_function_queue->EmptyQueue();
+    }
+
+    ValidationQueueInfo GetQueueInfo() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        ValidationQueueInfo info;
+        info.subscribers = WITH_LOCK(m_mutex, return m_map.size());
+        const auto queues{WITH_LOCK(m_mutex, return m_list)};
+        for (const auto& queue : queues) {
+            const size_t pending{queue->Pending()};
+            info.pending += pending;
+            info.max_pending = std::max(info.max_pending, pending);
+            info.peak_pending = std::max(info.peak_pending, queue->PeakPending());
+            info.delivered += queue->Delivered();
+        }
+        return info;
+    }
 };
 
 static CMainSignals g_signals;
 
-void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler)
+void CMainSignals::StartBackgroundThreads(int num_threads)
 {
     assert(!m_internals);
-    m_internals = std::make_unique<MainSignalsImpl>(scheduler);
+    m_internals = std::make_unique<MainSignalsImpl>(num_threads);
+}
+
+void CMainSignals::StopBackgroundThreads()
+{
+    if (m_internals) {
+        m_internals->StopThreads();
+    }
 }
 
-void CMainSignals::UnregisterBackgroundSignalScheduler()
+void CMainSignals::UnregisterBackgroundThreads()
 {
     m_internals.reset(nullptr);
 }
@@ -108,14 +418,20 @@ void CMainSignals::UnregisterBackgroundSignalScheduler()
 void CMainSignals::FlushBackgroundCallbacks()
 {
     if (m_internals) {
-        m_internals->m_schedulerClient.EmptyQueue();
+        m_internals->EmptyQueues();
     }
 }
 
 size_t CMainSignals::CallbacksPending()
 {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    return m_internals->GetQueueInfo().max_pending;
+}
+
+ValidationQueueInfo CMainSignals::GetQueueInfo()
+{
+    if (!m_internals) return {};
+    return m_internals->GetQueueInfo();
 }
 
 CMainSignals& GetMainSignals()
@@ -159,7 +475,7 @@ void UnregisterAllValidationInterfaces()
 
 void CallFunctionInValidationInterfaceQueue(std::function<void()> func)
 {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->AddFunction(std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue()
@@ -176,15 +492,12 @@ void SyncWithValidationInterfaceQueue()
 // Use a macro instead of a function for conditional logging to prevent
 // evaluating arguments when logging is not enabled.
 //
-// NOTE: The lambda captures all local variables by value.
-#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)           \
-    do {                                                       \
-        auto local_name = (name);                              \
-        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);  \
-        m_internals->m_schedulerClient.AddToProcessQueue([=] { \
-            LOG_EVENT(fmt, local_name, __VA_ARGS__);           \
-            event();                                           \
-        });                                                    \
+// The event is logged once when it is queued, not for every subscriber it is
+// delivered to.
+#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)                       \
+    do {                                                                   \
+        LOG_EVENT("Enqueuing " fmt, (name), __VA_ARGS__);                  \
+        m_internals->Enqueue(event);                                       \
     } while (0)
 
 #define LOG_EVENT(fmt, ...) \
@@ -195,8 +508,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    auto event = [pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+    auto event = [pindexNew, pindexFork, fInitialDownload](CValidationInterface& callbacks) {
+        callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: new block hash=%s fork block hash=%s (in IBD=%s)", __func__,
                           pindexNew->GetBlockHash().ToString(),
@@ -205,8 +518,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) {
-    auto event = [tx, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionAddedToMempool(tx, mempool_sequence); });
+    auto event = [tx, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionAddedToMempool(tx, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s", __func__,
                           tx->GetHash().ToString(),
@@ -214,8 +527,8 @@ void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t
 }
 
 void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) {
-    auto event = [tx, reason, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence); });
+    auto event = [tx, reason, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s reason=%s", __func__,
                           tx->GetHash().ToString(),
@@ -224,8 +537,8 @@ void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemP
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex) {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockConnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockConnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
@@ -234,8 +547,8 @@ void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, c
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockDisconnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockDisconnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
@@ -243,8 +556,8 @@ void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    auto event = [locator, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.ChainStateFlushed(locator); });
+    auto event = [locator](CValidationInterface& callbacks) {
+        callbacks.ChainStateFlushed(locator);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s", __func__,
                           locator.IsNull() ? "null" : locator.vHave.front().ToString());
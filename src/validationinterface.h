@@ -10,15 +10,24 @@
 #include <primitives/transaction.h> // CTransaction(Ref)
 #include <sync.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 
+/**
+ * Default number of threads delivering validation notifications. With one
+ * thread, the callbacks of different subscribers don't run concurrently.
+ */
+static constexpr int DEFAULT_NOTIFICATION_THREADS{1};
+/** Maximum number of threads delivering validation notifications */
+static constexpr int MAX_NOTIFICATION_THREADS{16};
+
 class BlockValidationState;
 class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
 class CValidationInterface;
-class CScheduler;
 enum class MemPoolRemovalReason;
 
 /** Register subscriber */
@@ -71,7 +80,8 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers, and callbacks of different
+ * subscribers may run at the same time on different notification threads.
  */
 class CValidationInterface {
 protected:
@@ -175,6 +185,20 @@ protected:
     friend class ValidationInterfaceTest;
 };
 
+/** Depth of the queues of notifications waiting to be delivered to subscribers. */
+struct ValidationQueueInfo {
+    //! Number of registered subscribers
+    size_t subscribers{0};
+    //! Notifications waiting in all subscriber queues
+    size_t pending{0};
+    //! Notifications waiting in the deepest subscriber queue
+    size_t max_pending{0};
+    //! Largest number of notifications that ever waited in a subscriber queue
+    size_t peak_pending{0};
+    //! Notifications delivered by the current subscriber queues
+    uint64_t delivered{0};
+};
+
 class MainSignalsImpl;
 class CMainSignals {
 private:
@@ -186,14 +210,18 @@ private:
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
 
 public:
-    /** Register a CScheduler to give callbacks which should run in the background (may only be called once) */
-    void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
-    /** Unregister a CScheduler to give callbacks which should run in the background - these callbacks will now be dropped! */
-    void UnregisterBackgroundSignalScheduler();
-    /** Call any remaining callbacks on the calling thread */
+    /** Start the threads that run callbacks in the background (may only be called once) */
+    void StartBackgroundThreads(int num_threads);
+    /** Stop the background threads once their current callbacks are done. The remaining callbacks wait for FlushBackgroundCallbacks */
+    void StopBackgroundThreads();
+    /** Release the background threads - callbacks will now be dropped! */
+    void UnregisterBackgroundThreads();
+    /** Call any remaining callbacks on the calling thread. The background threads must be stopped */
     void FlushBackgroundCallbacks();
 
+    /** Number of notifications waiting for the subscriber that is furthest behind */
     size_t CallbacksPending();
+    ValidationQueueInfo GetQueueInfo();
 
 
     void UpdatedBlockTip(const CBlockIndex *, const CBlockIndex *, bool fInitialDownload);
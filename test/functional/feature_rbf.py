@@ -33,6 +33,7 @@ class ReplaceByFeeTest(MytherraTestFramework):
                 "-limitancestorsize=101",
                 "-limitdescendantcount=200",
                 "-limitdescendantsize=101",
+                "-limitclustercount=1000",
             ],
             # second node has default mempool parameters
             [